@@ -0,0 +1,81 @@
+#include "Benchmark.h"
+
+#include <Animation.h>
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// A root with chains of 8 joints hanging off it, skinned to every node
+static void BuildSkeleton(Model& model, int jointCount) {
+	for (int i = 0; i < jointCount; ++i) {
+		int parent = i == 0 ? -1 : i % 8 == 1 ? 0 : i - 1;
+		Model::Transform local;
+		local.mPosition = Vector3(0.0f, 0.1f, 0.0f);
+		model.AppendNode("Joint" + std::to_string(i), parent, local);
+	}
+	model.UpdateWorldMatrices();
+	auto& skin = model.GetSkin();
+	for (int i = 0; i < jointCount; ++i) {
+		skin.mJointNodes.push_back(i);
+		skin.mInverseBindMatrices.push_back(model.GetNodeWorlds()[i].Invert());
+	}
+}
+
+// Every joint swings at its own phase; positions and scales stay
+// constant, so the clip stores a single key for those channels
+static void BuildClip(const Model& model, AnimationClip& clip, int frameCount) {
+	int nodeCount = model.GetNodeCount();
+	std::vector<int> nodes(nodeCount);
+	std::vector<Model::Transform> samples;
+	for (int n = 0; n < nodeCount; ++n) nodes[n] = n;
+	AnimationClip::Settings settings;
+	for (int f = 0; f < frameCount; ++f) {
+		float time = f / settings.mSampleRate;
+		for (int n = 0; n < nodeCount; ++n) {
+			auto local = model.GetNodeLocals()[n];
+			local.mRotation = Quaternion::CreateFromYawPitchRoll(0.5f * std::sin(time * 3.0f + n), 0.3f * std::sin(time * 2.0f + n * 0.5f), 0.0f);
+			samples.push_back(local);
+		}
+	}
+	clip.Build(nodes, samples, frameCount, settings);
+}
+
+// Evaluate many characters playing (and half of them blending) one clip
+static void RunCharacters(const Model& model, const AnimationClip& clip, int characterCount) {
+	int jointCount = model.GetJointCount();
+	// Every character is at a different time, and every other one blends
+	// in the same clip half a cycle apart (the costlier path)
+	std::vector<AnimationSampler::Instance> instances(characterCount);
+	float duration = clip.GetDuration();
+	for (int i = 0; i < characterCount; ++i) {
+		auto& instance = instances[i];
+		instance.mClip = &clip;
+		instance.mTime = duration * (float)i / std::max(characterCount, 1);
+		if ((i & 1) != 0) {
+			instance.mBlendClip = &clip;
+			instance.mBlendTime = std::fmod(instance.mTime + duration * 0.5f, std::max(duration, 1e-6f));
+			instance.mBlendWeight = 0.5f;
+		}
+		instance.mMatrixOffset = i * jointCount;
+	}
+	GraphicsBuffer<Matrix> skinningMatrices(characterCount * jointCount);
+	auto seconds = Benchmark::TimeFastest(3, [&] {
+		AnimationSampler::Evaluate(model, instances, skinningMatrices);
+	});
+
+	char name[64];
+	std::snprintf(name, sizeof(name), "Animation %d characters, %d joints", characterCount, jointCount);
+	Benchmark::Report(name, seconds, Benchmark::Throughput(characterCount, seconds), "chars",
+		"clip %zu bytes", clip.GetDataSize());
+}
+
+void RunAnimationBenchmarks() {
+	Model model;
+	BuildSkeleton(model, 64);
+	AnimationClip clip("Swing");
+	BuildClip(model, clip, 60);
+	RunCharacters(model, clip, 100);
+	RunCharacters(model, clip, 2000);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+// Timing shared by every benchmark in this tool
+namespace Benchmark {
+	// Seconds taken by the fastest of `iterations` calls to `run`
+	// `setup` is called (untimed) before each of them
+	template<class Setup, class Run>
+	double TimeFastest(int iterations, Setup&& setup, Run&& run) {
+		double best = std::numeric_limits<double>::max();
+		for (int i = 0; i < std::max(iterations, 1); ++i) {
+			setup();
+			auto begin = std::chrono::steady_clock::now();
+			run();
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+		}
+		return best;
+	}
+	template<class Run>
+	double TimeFastest(int iterations, Run&& run) {
+		return TimeFastest(iterations, [] { }, run);
+	}
+	// Millions of items processed per second
+	inline double Throughput(double items, double seconds) {
+		return items / std::max(seconds, 1e-9) / 1.0e6;
+	}
+	// Print one line: name, fastest time, throughput and (printf style) notes
+	void Report(const char* name, double seconds, double throughput, const char* unit, const char* notes = "", ...);
+}
+
+// Each area adds its benchmarks here; main runs them in order
+void RunSparseIndicesBenchmarks();
+void RunMaterialBenchmarks();
+void RunBufferConversionBenchmarks();
+void RunWeldBenchmarks();
+void RunAnimationBenchmarks();
+void RunTextureCompressionBenchmarks();
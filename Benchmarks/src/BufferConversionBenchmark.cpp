@@ -0,0 +1,64 @@
+#include "Benchmark.h"
+
+#include <Buffer.h>
+#include <BufferConversion.h>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Round trip `count` tightly packed items through `format`, with the
+// bulk kernels and then one BufferView Set/Get per item (for comparison)
+static void RunRoundTrip(const char* formatName, BufferFormat format, int count) {
+	auto type = BufferFormatType::GetType(format);
+	int components = type.GetComponentCount();
+	int stride = type.GetByteSize();
+	std::vector<float> source((size_t)count * components), decoded(source.size());
+	std::vector<uint8_t> encoded((size_t)count * stride);
+	// Stay within the range the format can represent
+	bool positive = !type.IsSigned() || type.size == BufferFormatType::Size1010102;
+	float scale = type.IsInt() ? 100.0f : 1.0f;
+	for (size_t i = 0; i < source.size(); ++i) {
+		float value = (float)((i * 7919) % 2001) / 2000.0f;
+		source[i] = (positive ? value : value * 2.0f - 1.0f) * scale;
+	}
+
+	bool supported = true;
+	auto seconds = Benchmark::TimeFastest(3, [&] {
+		supported &= BufferConversion::WriteFloats(format, encoded.data(), stride, source.data(), components, count);
+		supported &= BufferConversion::ReadFloats(format, encoded.data(), stride, decoded.data(), components, count);
+	});
+	if (!supported) throw "No conversion for this format";
+	float maxError = 0.0f;
+	for (size_t i = 0; i < source.size(); ++i)
+		maxError = std::max(maxError, std::abs(decoded[i] - source[i]));
+
+	BufferLayout::Element element("Bench", format, stride, encoded.data());
+	BufferView view(&element);
+	auto perItemSeconds = Benchmark::TimeFastest(3, [&] {
+		for (int i = 0; i < count; ++i) {
+			Vector4 value;
+			std::copy(&source[(size_t)i * components], &source[(size_t)i * components] + components, &value.x);
+			view.Set(i, value);
+		}
+		for (int i = 0; i < count; ++i) {
+			auto value = view.Get<Vector4>(i);
+			std::copy(&value.x, &value.x + components, &decoded[(size_t)i * components]);
+		}
+	});
+
+	char name[64];
+	std::snprintf(name, sizeof(name), "BufferConversion %s x%d", formatName, count);
+	Benchmark::Report(name, seconds, Benchmark::Throughput(count, seconds), "items",
+		"x%.2f over per item BufferView, max error %g", perItemSeconds / std::max(seconds, 1e-9), maxError);
+}
+
+void RunBufferConversionBenchmarks() {
+	const int count = 1 << 20;
+	RunRoundTrip("R8G8B8A8_UNORM", FORMAT_R8G8B8A8_UNORM, count);
+	RunRoundTrip("R8G8B8A8_SNORM", FORMAT_R8G8B8A8_SNORM, count);
+	RunRoundTrip("R16G16_FLOAT", FORMAT_R16G16_FLOAT, count);
+	RunRoundTrip("R16G16B16A16_FLOAT", FORMAT_R16G16B16A16_FLOAT, count);
+	RunRoundTrip("R11G11B10_FLOAT", FORMAT_R11G11B10_FLOAT, count);
+	RunRoundTrip("R32G32B32_FLOAT", FORMAT_R32G32B32_FLOAT, count);
+}
@@ -0,0 +1,71 @@
+#include "Benchmark.h"
+
+#include <Material.h>
+#include <MaterialEvaluator.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static Vector4 ValueOf(int i) { return Vector4((float)i, 1.0f, 2.0f, 3.0f); }
+
+// Collect a two material stack of plain Vector4 values and computed
+// values (each summing two plain ones), then check the evaluated output
+static void RunCollect(int valueCount, int computedCount) {
+	// Plain values are split across the stack, computed values live on the base
+	Material top, base;
+	std::vector<Identifier> names;
+	for (int i = 0; i < valueCount; ++i) {
+		names.push_back(Identifier("Bench" + std::to_string(i)));
+		(i < valueCount / 2 ? top : base).SetUniform(names.back(), ValueOf(i));
+	}
+	for (int i = 0; i < computedCount; ++i) {
+		Identifier a = names[i % valueCount], b = names[(i + 1) % valueCount];
+		names.push_back(Identifier("BenchComputed" + std::to_string(i)));
+		base.SetComputedUniform<Vector4>(names.back(), [=](auto& context) {
+			return context.GetUniform<Vector4>(a) + context.GetUniform<Vector4>(b);
+		});
+	}
+	const Material* stack[] = { &top, &base, };
+
+	MaterialCollector collector;
+	MaterialEvaluator evaluator;
+	auto seconds = Benchmark::TimeFastest(3, [&] {
+		MaterialCollectorContext context(stack, collector);
+		for (auto name : names) context.GetUniformSource(name, context);
+		collector.FinalizeAndClearOutputOffsets();
+		collector.RepairOutputOffsets(false);
+		collector.BuildEvaluator(evaluator);
+	});
+
+	// Collect again (untimed) with each value at a known offset, as a
+	// constant buffer layout would place them, and check the output
+	{
+		MaterialCollectorContext context(stack, collector);
+		for (auto name : names) context.GetUniformSource(name, context);
+	}
+	collector.FinalizeAndClearOutputOffsets();
+	for (int i = 0; i < (int)names.size(); ++i) collector.SetItemOutputOffset(names[i], i * (int)sizeof(Vector4));
+	collector.RepairOutputOffsets(false);
+	collector.BuildEvaluator(evaluator);
+	std::vector<uint8_t> data(evaluator.mDataSize);
+	evaluator.Evaluate(data);
+	int mismatches = 0;
+	for (int i = 0; i < (int)names.size(); ++i) {
+		auto expected = i < valueCount ? ValueOf(i)
+			: ValueOf((i - valueCount) % valueCount) + ValueOf((i - valueCount + 1) % valueCount);
+		if (((const Vector4*)data.data())[i] != expected) ++mismatches;
+	}
+
+	char name[64];
+	std::snprintf(name, sizeof(name), "MaterialCollector %d values, %d computed", valueCount, computedCount);
+	Benchmark::Report(name, seconds, Benchmark::Throughput((double)names.size(), seconds), "values",
+		"%d mismatches", mismatches);
+}
+
+void RunMaterialBenchmarks() {
+	RunCollect(16, 4);
+	RunCollect(64, 16);
+	// More than 255 values in one stack
+	RunCollect(256, 64);
+}
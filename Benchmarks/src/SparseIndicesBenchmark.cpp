@@ -0,0 +1,53 @@
+#include "Benchmark.h"
+
+#include <Containers.h>
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Random mix of Allocate (1 to maxCount items) and Return over
+// a capacity of free indices; deterministic for a given seed
+static void RunAllocations(int capacity, int operations, int maxCount, uint32_t seed) {
+	SparseIndices indices;
+	std::vector<RangeInt> live;
+	int failed = 0;
+	auto seconds = Benchmark::TimeFastest(3,
+		[&] {
+			indices = SparseIndices();
+			indices.Return(0, capacity);
+			live.clear();
+			failed = 0;
+		},
+		[&] {
+			std::mt19937 rand(seed);
+			for (int op = 0; op < operations; ++op) {
+				// Favour small allocations, as most sparse array users make
+				if (live.empty() || (rand() & 1) != 0) {
+					int count = 1 + (int)(rand() % (uint32_t)maxCount) * (int)(rand() % (uint32_t)maxCount) / maxCount;
+					auto range = indices.Allocate(count);
+					if (range.start >= 0) { live.push_back(range); continue; }
+					++failed;
+					if (live.empty()) continue;
+				}
+				auto item = live.begin() + rand() % (uint32_t)live.size();
+				indices.Return(*item);
+				*item = live.back();
+				live.pop_back();
+			}
+		});
+	// Fragmentation: 1 - largest free range / free total, at the end
+	int freeTotal = capacity;
+	for (auto& range : live) freeTotal -= range.length;
+	float fragmentation = freeTotal > 0 ? 1.0f - (float)indices.GetLargestFreeRange() / freeTotal : 0.0f;
+	char name[64];
+	std::snprintf(name, sizeof(name), "SparseIndices %d ops, up to %d", operations, maxCount);
+	Benchmark::Report(name, seconds, Benchmark::Throughput(operations, seconds), "ops",
+		"fragmentation %.3f, %d failed", fragmentation, failed);
+}
+
+void RunSparseIndicesBenchmarks() {
+	RunAllocations(1 << 16, 1000000, 16, 1);
+	RunAllocations(1 << 16, 1000000, 64, 1);
+	RunAllocations(1 << 20, 1000000, 1024, 1);
+}
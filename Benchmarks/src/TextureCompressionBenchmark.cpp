@@ -0,0 +1,75 @@
+#include "Benchmark.h"
+
+#include <Texture.h>
+#include <TextureCompression.h>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Gradients and soft waves with some per-pixel noise, and
+// blocky alpha, so that every endpoint fit has work to do
+static std::vector<uint8_t> GenerateImage(Int2 size) {
+	std::vector<uint8_t> pixels((size_t)size.x * size.y * 4);
+	for (int y = 0; y < size.y; ++y) {
+		for (int x = 0; x < size.x; ++x) {
+			auto* pixel = &pixels[((size_t)y * size.x + x) * 4];
+			uint32_t hash = (uint32_t)(y * size.x + x) * 2654435761u;
+			int noise = (int)((hash >> 24) & 15) - 8;
+			float wave = std::sin(x * 0.05f) * std::cos(y * 0.07f);
+			pixel[0] = (uint8_t)std::clamp(x * 255 / size.x + noise, 0, 255);
+			pixel[1] = (uint8_t)std::clamp(y * 255 / size.y - noise, 0, 255);
+			pixel[2] = (uint8_t)std::clamp((int)(128.0f + 120.0f * wave) + noise, 0, 255);
+			pixel[3] = ((x / 32 + y / 32) & 1) != 0 ? 255 : 64;
+		}
+	}
+	return pixels;
+}
+
+// Time the encode of one image and measure its error
+static void RunEncode(const char* label, const std::vector<uint8_t>& pixels, Int2 size,
+	BufferFormat fmt, const TextureCompression::Settings& settings)
+{
+	std::vector<uint8_t> compressed(Texture::GetRawImageSize(Int3(size, 1), fmt));
+	auto seconds = Benchmark::TimeFastest(3, [&] {
+		TextureCompression::CompressImage(fmt, pixels, size, size.x * 4, compressed, settings);
+	});
+
+	std::vector<uint8_t> decoded(pixels.size());
+	TextureCompression::DecompressImage(fmt, compressed, size, decoded, size.x * 4);
+	// Only compare the channels the format stores; BC1 stores
+	// pixels with alpha below 128 as transparent black, so skip them
+	int channels = fmt == FORMAT_BC4_UNORM ? 1 : fmt == FORMAT_BC5_UNORM ? 2 : fmt == FORMAT_BC1_UNORM ? 3 : 4;
+	double error = 0.0;
+	size_t samples = 0;
+	for (size_t p = 0; p < decoded.size(); p += 4) {
+		if (fmt == FORMAT_BC1_UNORM && pixels[p + 3] < 128) continue;
+		for (int c = 0; c < channels; ++c) {
+			double d = (double)decoded[p + c] - pixels[p + c];
+			error += d * d;
+		}
+		samples += channels;
+	}
+	double mse = error / (double)std::max(samples, (size_t)1);
+	double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<double>::infinity();
+
+	char name[64];
+	std::snprintf(name, sizeof(name), "Compress %s %dx%d", label, size.x, size.y);
+	Benchmark::Report(name, seconds, Benchmark::Throughput((double)size.x * size.y, seconds), "px",
+		"PSNR %.2f dB", psnr);
+}
+
+void RunTextureCompressionBenchmarks() {
+	Int2 size(1024, 1024);
+	auto pixels = GenerateImage(size);
+	TextureCompression::Settings fast, normal, high;
+	fast.mQuality = TextureCompression::Quality::Fast;
+	high.mQuality = TextureCompression::Quality::High;
+	RunEncode("BC1", pixels, size, FORMAT_BC1_UNORM, normal);
+	RunEncode("BC3", pixels, size, FORMAT_BC3_UNORM, normal);
+	RunEncode("BC4", pixels, size, FORMAT_BC4_UNORM, normal);
+	RunEncode("BC5", pixels, size, FORMAT_BC5_UNORM, normal);
+	RunEncode("BC7 fast", pixels, size, FORMAT_BC7_UNORM, fast);
+	RunEncode("BC7", pixels, size, FORMAT_BC7_UNORM, normal);
+	RunEncode("BC7 high", pixels, size, FORMAT_BC7_UNORM, high);
+}
@@ -0,0 +1,74 @@
+#include "Benchmark.h"
+
+#include <Mesh.h>
+#include <MeshOptimizer.h>
+
+#include <cstdio>
+#include <vector>
+
+// A unit grid of quads which each have their own 4 corners (as importers
+// produce), so most vertices are shared with neighbouring quads.
+// `jitter` offsets every vertex slightly so that only a weld with
+// an epsilon can merge them
+static void FillGrid(Mesh& mesh, int size, float jitter) {
+	std::vector<Vector3> positions, normals;
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			for (int c = 0; c < 4; ++c) {
+				uint32_t hash = (uint32_t)positions.size() * 2654435761u;
+				float offset = jitter * ((float)(hash >> 16) / 65535.0f - 0.5f);
+				positions.push_back(Vector3((float)(x + (c & 1)) / size + offset, 0.0f, (float)(y + (c >> 1)) / size - offset));
+				normals.push_back(Vector3(0.0f, 1.0f, 0.0f));
+			}
+		}
+	}
+	mesh.SetVertexCount((int)positions.size());
+	mesh.GetPositionsV().Set(std::span<const Vector3>(positions));
+	mesh.GetNormalsV(true).Set(std::span<const Vector3>(normals));
+}
+
+// Time the vertex weld over a mesh, and measure what it merged
+static void RunWeld(const char* label, const Mesh& mesh, const MeshOptimizer::WeldSettings& settings) {
+	auto& vbuffer = mesh.GetVertexBuffer();
+	int count = vbuffer.mCount;
+	std::vector<int> remap(count);
+	int uniqueCount = 0;
+	auto seconds = Benchmark::TimeFastest(3, [&] {
+		uniqueCount = MeshOptimizer::GenerateVertexRemap(vbuffer, remap, settings);
+	});
+
+	// Distance each vertex moves to the (first) vertex it is merged into
+	float maxPositionError = 0.0f;
+	for (auto& element : vbuffer.GetElements()) {
+		if (element.mBindName != "POSITION" || element.mData == nullptr) continue;
+		std::vector<Vector4> positions(count);
+		BufferView(&element).Get(std::span<Vector4>(positions));
+		std::vector<int> kept(uniqueCount, -1);
+		for (int v = 0; v < count; ++v) {
+			auto& first = kept[remap[v]];
+			if (first < 0) { first = v; continue; }
+			auto delta = positions[v] - positions[first];
+			maxPositionError = std::max(maxPositionError, Vector3(delta.x, delta.y, delta.z).Length());
+		}
+	}
+
+	char name[64];
+	std::snprintf(name, sizeof(name), "Weld %s x%d", label, count);
+	Benchmark::Report(name, seconds, Benchmark::Throughput(count, seconds), "verts",
+		"unique %.3f, max position error %g", count > 0 ? (float)uniqueCount / count : 1.0f, maxPositionError);
+}
+
+void RunWeldBenchmarks() {
+	const int size = 512;
+	MeshOptimizer::WeldSettings exact;
+	MeshOptimizer::WeldSettings tolerant;
+	tolerant.mPositionEpsilon = 1.0e-3f;
+	tolerant.mNormalEpsilon = 1.0e-3f;
+
+	Mesh mesh("WeldBenchmark");
+	FillGrid(mesh, size, 0.0f);
+	RunWeld("exact", mesh, exact);
+	FillGrid(mesh, size, 1.0e-5f);
+	RunWeld("exact, jittered", mesh, exact);
+	RunWeld("epsilon, jittered", mesh, tolerant);
+}
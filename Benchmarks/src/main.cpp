@@ -0,0 +1,30 @@
+#include "Benchmark.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+void Benchmark::Report(const char* name, double seconds, double throughput, const char* unit, const char* notes, ...) {
+	std::printf("%-44s %10.3f ms %10.2f M%s/s  ", name, seconds * 1.0e3, throughput, unit);
+	va_list args;
+	va_start(args, notes);
+	std::vprintf(notes, args);
+	va_end(args);
+	std::printf("\n");
+}
+
+int main() {
+	// Engine code throws string literals
+	try {
+		RunSparseIndicesBenchmarks();
+		RunMaterialBenchmarks();
+		RunBufferConversionBenchmarks();
+		RunWeldBenchmarks();
+		RunAnimationBenchmarks();
+		RunTextureCompressionBenchmarks();
+	}
+	catch (const char* error) {
+		std::printf("Benchmark failed: %s\n", error);
+		return 1;
+	}
+	return 0;
+}
@@ -1,6 +1,8 @@
 #define NOPREDECLARE
 
 #include <Texture.h>
+#include <TextureCompression.h>
+#include <MipGenerator.h>
 #include <NativePlatform.h>
 #include <ResourceLoader.h>
 #include <Lighting.h>
@@ -149,6 +151,24 @@ CSSpan CSTexture::GetTextureData(NativeTexture* tex, int mip, int slice) {
 void CSTexture::MarkChanged(NativeTexture* tex) {
 	tex->MarkChanged();
 }
+void CSTexture::Compress(NativeTexture* tex, BufferFormat fmt, int quality) {
+	TextureCompression::Settings settings;
+	settings.mQuality = (TextureCompression::Quality)quality;
+	TextureCompression::Compress(*tex, fmt, settings);
+}
+void CSTexture::GenerateMips(NativeTexture* tex, int filter, Bool srgb, float alphaCutoff) {
+	MipGenerator::Settings settings;
+	settings.mFilter = (MipGenerator::Filter)filter;
+	settings.mSRGB = srgb;
+	settings.mAlphaCutoff = alphaCutoff;
+	MipGenerator::GenerateMips(*tex, settings);
+}
+Bool CSTexture::GetCompressionSupported(BufferFormat fmt) {
+	return TextureCompression::IsSupported(fmt);
+}
+Bool CSTexture::GetMipsSupported(BufferFormat fmt) {
+	return MipGenerator::IsSupported(fmt);
+}
 NativeTexture* CSTexture::_Create(CSString name) {
 	return new NativeTexture(ToWString(name));
 }
@@ -366,8 +386,8 @@ const NativePipeline* CSGraphics::RequireRaytracePSO(NativeGraphics* graphics
 }
 
 void* CSGraphics::RequireFrameData(NativeGraphics* graphics, int byteSize) {
-	// TODO: Alignment?
-	return graphics->mCmdBuffer.RequireFrameData<uint8_t>(byteSize).data();
+	// Aligned for SIMD types written from C#
+	return graphics->mCmdBuffer.RequireFrameData<uint8_t>(byteSize, 16).data();
 }
 void* CSGraphics::RequireConstantBuffer(NativeGraphics* graphics, CSSpan span, size_t hash) {
 	return graphics->mCmdBuffer.RequireConstantBuffer(std::span<uint8_t>((uint8_t*)span.mData, span.mSize), hash);
@@ -659,6 +679,9 @@ void Platform::Dispose(NativePlatform* platform) {
 void Platform::InitializeGraphics(NativePlatform* platform) {
 	platform->Initialize();
 }
+void Platform::InitializeHeadless(NativePlatform* platform) {
+	platform->InitializeHeadless();
+}
 int Platform::GetCoreCount() {
 	std::vector<uint8_t> bufferPtr;
 	DWORD bufferBytes = 0;
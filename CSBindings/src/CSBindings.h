@@ -97,6 +97,7 @@ struct DLLCLASS CSBufferLayout {
 	uint8_t mUsage;
 	int mOffset;
 	int mCount;
+	const void* mChangeLog;
 };
 struct DLLCLASS CSRenderTargetBinding {
 	NativeRenderTarget* mTarget;
@@ -135,6 +136,12 @@ public:
 	static Bool GetAllowUnorderedAccess(NativeTexture* tex);
 	static CSSpan GetTextureData(NativeTexture* tex, int mip, int slice);
 	static void MarkChanged(NativeTexture* tex);
+	// Encode an RGBA8 texture in place (quality is TextureCompression::Quality)
+	static void Compress(NativeTexture* tex, BufferFormat fmt, int quality);
+	// Generate the full mip chain (filter is MipGenerator::Filter)
+	static void GenerateMips(NativeTexture* tex, int filter, Bool srgb, float alphaCutoff);
+	static Bool GetCompressionSupported(BufferFormat fmt);
+	static Bool GetMipsSupported(BufferFormat fmt);
 	static NativeTexture* _Create(CSString name);
 	static void Swap(NativeTexture* from, NativeTexture* to);
 	static void Dispose(NativeTexture* tex);
@@ -445,6 +452,7 @@ public:
 		: mPlatform(platform) { }
 
 	static void InitializeGraphics(NativePlatform* platform);
+	static void InitializeHeadless(NativePlatform* platform);
 
 	static int GetCoreCount();
 
@@ -135,7 +135,8 @@ namespace Weesals.Editor.Assets {
         unsafe public CSTexture LoadAsset(ResourceKey key) {
             return LoadAsset(key, BufferFormat.FORMAT_BC1_UNORM);
         }
-        unsafe public CSTexture LoadAsset(ResourceKey key, BufferFormat format) {
+        // srgb: the image is colour data, and is filtered in linear space
+        unsafe public CSTexture LoadAsset(ResourceKey key, BufferFormat format, bool srgb = false) {
             var path = key.SourcePath;
             CSTexture texture = default;
             using (var entry = ResourceCacheManager.TryLoad(key)) {
@@ -160,7 +161,7 @@ namespace Weesals.Editor.Assets {
                         if (hasTrans && format == BufferFormat.FORMAT_BC1_UNORM) {
                             format = BufferFormat.FORMAT_BC3_UNORM;
                         }
-                        texture.GenerateMips();
+                        texture.GenerateMips(srgb: srgb);
                         texture.CompressTexture(format);
                     }
                 }
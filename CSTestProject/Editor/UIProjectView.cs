@@ -196,7 +196,7 @@ namespace Weesals.Editor {
                             list.AppendChild(modes);
                             var container = new SizedContainer() { PreferredSize = new(float.MaxValue), };
                             container.MaximumSize.Y = 200f;
-                            img = new Image(Resources.LoadTexture(fileView.Filename)) {
+                            img = new Image(Resources.LoadTexture(fileView.Filename, srgb: true)) {
                                 AspectMode = Image.AspectModes.PreserveAspectContain,
                             };
                             container.AppendChild(img);
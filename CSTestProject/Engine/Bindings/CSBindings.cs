@@ -188,6 +188,10 @@ namespace Weesals.Engine {
         public bool GetAllowUnorderedAccess() { return GetAllowUnorderedAccess(mTexture); }
         public MemoryBlock<byte> GetTextureData(int mip = 0, int slice = 0) { var data = GetTextureData(mTexture, mip, slice); return new MemoryBlock<byte>((byte*)data.mData, data.mSize); }
         public void MarkChanged() { MarkChanged(mTexture); }
+        public void GenerateMipsNative(int filter = 0, bool srgb = false, float alphaCutoff = 0.0f) { GenerateMips(mTexture, filter, srgb, alphaCutoff); }
+        public void Compress(BufferFormat fmt, int quality) { Compress(mTexture, fmt, quality); }
+        public static bool GetNativeMipsSupported(BufferFormat fmt) { return GetMipsSupported(fmt); }
+        public static bool GetNativeCompressionSupported(BufferFormat fmt) { return GetCompressionSupported(fmt); }
         public void Swap(CSTexture other) { Swap(mTexture, other.mTexture); }
         public void Dispose() { Dispose(mTexture); mTexture = null; }
 
@@ -682,6 +686,7 @@ namespace Weesals.Engine {
     public partial struct Platform {
         unsafe public void Dispose() { Dispose(mPlatform); mPlatform = null; }
         unsafe public void InitializeGraphics() { InitializeGraphics(mPlatform); }
+        unsafe public void InitializeHeadless() { InitializeHeadless(mPlatform); }
         unsafe public CSWindow CreateWindow(string name) {
             fixed (char* namePtr = name)
                 return new CSWindow(CreateWindow(mPlatform, new CSString(namePtr, name.Length)));
@@ -23,9 +23,11 @@ namespace Weesals.Engine {
             platform.Dispose();
         }
 
-        public void InitializeGraphics() {
+        // Headless uses a null device which never touches the GPU
+        public void InitializeGraphics(bool headless = false) {
             using (var marker = new ProfilerMarker("Init Graphics").Auto()) {
-                platform.InitializeGraphics();
+                if (headless) platform.InitializeHeadless();
+                else platform.InitializeGraphics();
                 graphics = platform.CreateGraphics();
             }
         }
@@ -299,6 +299,12 @@ namespace Weesals.Engine.Importers {
                 globalTransform = Matrix4x4.CreateScale(scale / 100.0f) *
                     Matrix4x4.CreateWorld(Vector3.Zero, fwdAxis, upAxis);
 
+                // Textures bound as albedo are colour, the rest (normals, etc.) are data
+                var colorTextures = new HashSet<ulong>();
+                foreach (var connection in fbxScene.Connections) {
+                    if ("DiffuseColor"u8.SequenceEqual(parser.GetSpan(connection.ToProperty))) colorTextures.Add(connection.From);
+                }
+
                 var fbxObjects = fbxScene.FindNode("Objects");
                 foreach (var fbxObj in fbxObjects.Children) {
                     var id = fbxObj.Properties.Count == 0 ? 0 : fbxScene.RequireId(parser.Data, fbxObj.Properties[0]);
@@ -326,7 +332,7 @@ namespace Weesals.Engine.Importers {
                         CSTexture tex = default;
                         foreach (var fbxTexChild in fbxObj.Children) {
                             if (fbxTexChild.Id == "FileName" || fbxTexChild.Id == "RelativeFilename")
-                                tex = Resources.LoadTexture(Path.Combine(rootPath, Path.GetFileName(fbxTexChild.Properties[0].AsString(parser.Data))));
+                                tex = Resources.LoadTexture(Path.Combine(rootPath, Path.GetFileName(fbxTexChild.Properties[0].AsString(parser.Data))), srgb: colorTextures.Contains(id));
                             if (tex.IsValid) break;
                             //if (fbxTexChild.Id == "Media") tex.Media = fbxTexChild.Properties[0].Value;
                         }
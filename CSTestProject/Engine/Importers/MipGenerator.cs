@@ -39,12 +39,20 @@ namespace Weesals.Engine {
                 Math.Max(Math.Max((uint)size.X, (uint)size.Y), (uint)size.Z));
         }
 
-        public static void GenerateMips(this CSTexture tex) {
+        // srgb: colour data stored as sRGB in a UNORM texture (implied for _SRGB formats)
+        // normalizeAlpha: keep alpha test coverage the same in every mip
+        public static void GenerateMips(this CSTexture tex, bool normalizeAlpha = false, bool srgb = false) {
             using var marker = ProfileMarker_GenerateMips.Auto();
             if (tex.GetIsCompressed()) {
                 Debug.WriteLine("Cannot mip a compressed texture. Generate mips before compression");
                 return;
             }
+            // Native generator filters in linear space
+            if (CSTexture.GetNativeMipsSupported(tex.GetFormat())) {
+                tex.GenerateMipsNative(0, srgb, normalizeAlpha ? 0.5f : 0.0f);
+                return;
+            }
+            if (normalizeAlpha) { GenerateMipsNormalizedAlpha(tex); return; }
 
             var size = tex.GetSize3D();
             int mips = CalculateMipCount(tex);
@@ -150,13 +158,8 @@ namespace Weesals.Engine {
             }
         }
 
-        public static void GenerateMips(this CSTexture tex, bool normalizeAlpha) {
-            if (!normalizeAlpha) { GenerateMips(tex); return; }
+        private static void GenerateMipsNormalizedAlpha(CSTexture tex) {
             using var marker = ProfileMarker_GenerateMipsSlow.Auto();
-            if (tex.GetIsCompressed()) {
-                Debug.WriteLine("Cannot mip a compressed texture. Generate mips before compression");
-                return;
-            }
 
             var size = tex.GetSize3D();
             int mips = CalculateMipCount(tex);
@@ -129,7 +129,16 @@ namespace Weesals.Engine {
         unsafe public static bool GetIsCompressed(this CSTexture other) {
             return BufferFormatType.GetMeta(other.Format).GetSize() == BufferFormatType.Sizes.Other;
         }
-        unsafe public static void CompressTexture(this CSTexture other, BufferFormat compressedFormat = BufferFormat.FORMAT_BC1_UNORM) {
+        // quality: 0 = Fast, 1 = Normal, 2 = High (only used by the native encoder)
+        unsafe public static void CompressTexture(this CSTexture other, BufferFormat compressedFormat = BufferFormat.FORMAT_BC1_UNORM, int quality = 1) {
+            // Prefer the native encoder; the ispc library is only available on Windows
+            var format = other.Format;
+            if ((format == BufferFormat.FORMAT_R8G8B8A8_UNORM || format == BufferFormat.FORMAT_R8G8B8A8_UNORM_SRGB)
+                && CSTexture.GetNativeCompressionSupported(compressedFormat)) {
+                using var marker = ProfileMarker_CompressTexture.Auto();
+                other.Compress(compressedFormat, quality);
+                return;
+            }
             var compressed = CreateCompressed(other, compressedFormat);
             compressed.Swap(other);
             compressed.Dispose();
@@ -253,7 +253,7 @@ namespace Weesals.Engine {
                                 if (jField.Value == "Additive") RenderState.BlendMode = BlendMode.MakeAdditive();
                                 if (jField.Value == "Premultiplied") RenderState.BlendMode = BlendMode.MakePremultiplied();
                             } else if (jField.Key == "Texture") {
-                                RenderState.BaseMaterial.SetTexture("Texture", Resources.LoadTexture(jField.Value.ToString()));
+                                RenderState.BaseMaterial.SetTexture("Texture", Resources.LoadTexture(jField.Value.ToString(), srgb: true));
                             } else if (jField.Key == "RenderTag") {
                                 RenderState.Tag |= scene.TagManager.RequireTag((string)jField.Value);
                             } else if (jField.Key == "ShaderTemplate") {
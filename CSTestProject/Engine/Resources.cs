@@ -333,16 +333,18 @@ namespace Weesals.Engine {
             return font;
         }
 
-        public static CSTexture LoadTexture(string path, BufferFormat format = BufferFormat.FORMAT_BC1_UNORM) {
+        // srgb: the image is colour (albedo, UI), rather than data (normals, masks, noise)
+        public static CSTexture LoadTexture(string path, BufferFormat format = BufferFormat.FORMAT_BC1_UNORM, bool srgb = false) {
             path = AssetDatabase.SanitizePath(path);
-            var pathHash = ResourceKey.GeneratePathHash(path) + (ulong)format;
+            var configHash = (ulong)format | (srgb ? 1ul << 32 : 0);
+            var pathHash = ResourceKey.GeneratePathHash(path) + configHash;
             var item = loadedTextures.RequireItem(pathHash);
             if (item.Loaded) return item.Resource;
             lock (item) {
                 if (item.Loaded) return item.Resource;
-                item.ConfigHash = (ulong)format;
-                var key = ResourceKey.CreateFileKey(path, $"tex@{format}");
-                item.SetResource(textureImporter.LoadAsset(key, format));
+                item.ConfigHash = configHash;
+                var key = ResourceKey.CreateFileKey(path, srgb ? $"tex@{format}@srgb" : $"tex@{format}");
+                item.SetResource(textureImporter.LoadAsset(key, format, srgb));
                 RegisterLoadedAsset(key, textureImporter, pathHash);
                 return item.Resource;
             }
@@ -204,6 +204,9 @@ namespace Weesals.Engine
         public int mOffset;
 
         public int mCount;
+
+        [NativeTypeName("const void *")]
+        public void* mChangeLog;
     }
 
     public unsafe partial struct CSRenderTargetBinding
@@ -279,6 +282,18 @@ namespace Weesals.Engine
         [DllImport("CSBindings", CallingConvention = CallingConvention.Cdecl, EntryPoint = "?MarkChanged@CSTexture@@SAXPEAVTexture@@@Z", ExactSpelling = true)]
         public static extern void MarkChanged(NativeTexture* tex);
 
+        [DllImport("CSBindings", CallingConvention = CallingConvention.Cdecl, EntryPoint = "?Compress@CSTexture@@SAXPEAVTexture@@W4BufferFormat@@H@Z", ExactSpelling = true)]
+        public static extern void Compress(NativeTexture* tex, [NativeTypeName("BufferFormat")] Weesals.Engine.BufferFormat fmt, int quality);
+
+        [DllImport("CSBindings", CallingConvention = CallingConvention.Cdecl, EntryPoint = "?GenerateMips@CSTexture@@SAXPEAVTexture@@HUBool@@M@Z", ExactSpelling = true)]
+        public static extern void GenerateMips(NativeTexture* tex, int filter, Bool srgb, float alphaCutoff);
+
+        [DllImport("CSBindings", CallingConvention = CallingConvention.Cdecl, EntryPoint = "?GetCompressionSupported@CSTexture@@SA?AUBool@@W4BufferFormat@@@Z", ExactSpelling = true)]
+        public static extern Bool GetCompressionSupported([NativeTypeName("BufferFormat")] Weesals.Engine.BufferFormat fmt);
+
+        [DllImport("CSBindings", CallingConvention = CallingConvention.Cdecl, EntryPoint = "?GetMipsSupported@CSTexture@@SA?AUBool@@W4BufferFormat@@@Z", ExactSpelling = true)]
+        public static extern Bool GetMipsSupported([NativeTypeName("BufferFormat")] Weesals.Engine.BufferFormat fmt);
+
         [DllImport("CSBindings", CallingConvention = CallingConvention.Cdecl, EntryPoint = "?_Create@CSTexture@@SAPEAVTexture@@UCSString@@@Z", ExactSpelling = true)]
         public static extern NativeTexture* _Create(CSString name);
 
@@ -1034,6 +1049,9 @@ namespace Weesals.Engine
         [DllImport("CSBindings", CallingConvention = CallingConvention.Cdecl, EntryPoint = "?InitializeGraphics@Platform@@SAXPEAVNativePlatform@@@Z", ExactSpelling = true)]
         public static extern void InitializeGraphics(NativePlatform* platform);
 
+        [DllImport("CSBindings", CallingConvention = CallingConvention.Cdecl, EntryPoint = "?InitializeHeadless@Platform@@SAXPEAVNativePlatform@@@Z", ExactSpelling = true)]
+        public static extern void InitializeHeadless(NativePlatform* platform);
+
         [DllImport("CSBindings", CallingConvention = CallingConvention.Cdecl, EntryPoint = "?GetCoreCount@Platform@@SAHXZ", ExactSpelling = true)]
         public static extern int GetCoreCount();
 
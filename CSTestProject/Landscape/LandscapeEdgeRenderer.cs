@@ -30,7 +30,7 @@ namespace Weesals.Landscape {
 
             EdgeMaterial = new("./Assets/landscapeEdge.hlsl", landscape.LandMaterial);
             EdgeMaterial.SetMacro("EDGE", "1");
-            EdgeMaterial.SetTexture("EdgeTex", Resources.LoadTexture("./Assets/T_WorldsEdge.jpg"));
+            EdgeMaterial.SetTexture("EdgeTex", Resources.LoadTexture("./Assets/T_WorldsEdge.jpg", srgb: true));
             EdgeMaterial.SetRasterMode(RasterMode.MakeNoCull());
             EdgeMaterial.SetBlendMode(BlendMode.MakeOpaque());
             EdgeMaterial.SetDepthMode(DepthMode.MakeDefault());
@@ -93,7 +93,7 @@ namespace Weesals.Landscape {
                     }
                 }
                 baseTextures.MarkChanged();
-                baseTextures.GenerateMips();
+                baseTextures.GenerateMips(srgb: true);
                 baseTextures.CompressTexture(BufferFormat.FORMAT_BC3_UNORM);
                 Resources.TryPutTexture(BaseMapsKey, baseTextures);
             }
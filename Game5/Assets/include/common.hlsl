@@ -30,4 +30,16 @@ float IGN(float2 pos, float seed = 0.0, bool newWeight = false) {
     return frac(52.9829189f * frac(dot(float2(0.06711056f, 0.00583715f), pos)));
 }
 
+// Decode vertex streams compacted by MeshQuantizer
+float3 DequantizePosition(float3 position, float4 scale, float4 offset) {
+    return position * scale.xyz + offset.xyz;
+}
+float3 OctDecode(float2 e) {
+    float3 n = float3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 #endif
@@ -0,0 +1,201 @@
+#include "Animation.h"
+
+#include <algorithm>
+#include <execution>
+#include <cmath>
+#include <immintrin.h>
+
+namespace {
+	const float RotationScale = 32767.0f;
+
+	__m128 LoadVector(const Vector3& v) { return _mm_setr_ps(v.x, v.y, v.z, 0.0f); }
+	void StoreVector(Vector3& v, __m128 value) {
+		alignas(16) float f[4];
+		_mm_store_ps(f, value);
+		v = Vector3(f[0], f[1], f[2]);
+	}
+	__m128 LoadQuaternion(const Quaternion& q) { return _mm_loadu_ps(&q.x); }
+	void StoreQuaternion(Quaternion& q, __m128 value) { _mm_storeu_ps(&q.x, value); }
+
+	AnimationClip::RotationKey EncodeRotation(__m128 q) {
+		__m128i v = _mm_cvtps_epi32(_mm_mul_ps(q, _mm_set1_ps(RotationScale)));
+		v = _mm_packs_epi32(v, v);
+		AnimationClip::RotationKey key;
+		_mm_storel_epi64((__m128i*)&key, v);
+		return key;
+	}
+	__m128 DecodeRotation(const AnimationClip::RotationKey& key) {
+		__m128i v = _mm_loadl_epi64((const __m128i*)&key);
+		// Sign extend 16 to 32 bits
+		v = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+		return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.0f / RotationScale));
+	}
+
+	// Dot product in every lane
+	__m128 Dot4(__m128 a, __m128 b) {
+		__m128 m = _mm_mul_ps(a, b);
+		m = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+	}
+	__m128 Lerp(__m128 a, __m128 b, __m128 t) {
+		return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+	}
+	// Normalized lerp along the shorter arc
+	__m128 NLerp(__m128 a, __m128 b, __m128 t) {
+		__m128 sign = _mm_and_ps(Dot4(a, b), _mm_set1_ps(-0.0f));
+		__m128 q = Lerp(a, _mm_xor_ps(b, sign), t);
+		return _mm_div_ps(q, _mm_sqrt_ps(Dot4(q, q)));
+	}
+	float MaxAbsDifference(__m128 a, __m128 b) {
+		__m128 d = _mm_andnot_ps(_mm_set1_ps(-0.0f), _mm_sub_ps(a, b));
+		d = _mm_max_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)));
+		d = _mm_max_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(d);
+	}
+
+	struct KeyPair {
+		int mKey0, mKey1;
+		__m128 mT;
+	};
+	KeyPair FindKeys(const AnimationClip::Channel& channel, float frame) {
+		float keyFrame = std::ldexp(frame, -channel.mStepShift);
+		int key0 = std::min((int)keyFrame, channel.mCount - 1);
+		int key1 = std::min(key0 + 1, channel.mCount - 1);
+		return { (int)channel.mOffset + key0, (int)channel.mOffset + key1, _mm_set1_ps(keyFrame - key0), };
+	}
+	__m128 SampleVector(const AnimationClip::Channel& channel, std::span<const Vector3> keys, float frame) {
+		auto pair = FindKeys(channel, frame);
+		return Lerp(LoadVector(keys[pair.mKey0]), LoadVector(keys[pair.mKey1]), pair.mT);
+	}
+	__m128 SampleRotation(const AnimationClip::Channel& channel, std::span<const AnimationClip::RotationKey> keys, float frame) {
+		auto pair = FindKeys(channel, frame);
+		return NLerp(DecodeRotation(keys[pair.mKey0]), DecodeRotation(keys[pair.mKey1]), pair.mT);
+	}
+
+	// Choose the fewest uniformly spaced keys that reproduce `values`
+	// within tolerance, and append them to `keys`
+	template<class Key, class Encode, class Sample>
+	AnimationClip::Channel ReduceChannel(std::span<const __m128> values, float tolerance,
+		std::vector<Key>& keys, Encode encode, Sample sample)
+	{
+		int frameCount = (int)values.size();
+		int maxShift = 0;
+		while (maxShift < 15 && (1 << (maxShift + 1)) < frameCount) ++maxShift;
+		AnimationClip::Channel channel;
+		channel.mOffset = (uint32_t)keys.size();
+		// Try a constant, then progressively shorter steps
+		for (int shift = maxShift + 1; shift >= 0; --shift) {
+			bool constant = shift > maxShift;
+			int step = 1 << std::min(shift, maxShift);
+			int count = constant ? 1 : (frameCount - 1 + step - 1) / step + 1;
+			assert(count <= 0xffff);
+			keys.resize(channel.mOffset);
+			for (int k = 0; k < count; ++k) keys.push_back(encode(values[std::min(k * step, frameCount - 1)]));
+			channel.mCount = (uint16_t)count;
+			channel.mStepShift = (uint8_t)(constant ? 0 : shift);
+			if (shift == 0) break;
+			float error = 0.0f;
+			for (int f = 0; f < frameCount && error <= tolerance; ++f) {
+				error = std::max(error, MaxAbsDifference(sample(channel, keys, (float)f), values[f]));
+			}
+			if (error <= tolerance) break;
+		}
+		return channel;
+	}
+}
+
+void AnimationClip::Build(std::span<const int> nodes, std::span<const Model::Transform> samples, int frameCount, const Settings& settings) {
+	assert(frameCount >= 1 && samples.size() == nodes.size() * frameCount);
+	mSampleRate = settings.mSampleRate;
+	mFrameCount = frameCount;
+	mTracks.clear();
+	mVectorKeys.clear();
+	mRotationKeys.clear();
+
+	auto EncodeVector = [](__m128 v) { Vector3 key; StoreVector(key, v); return key; };
+	std::vector<__m128> values(frameCount);
+	for (int t = 0; t < (int)nodes.size(); ++t) {
+		Track track = { nodes[t], };
+		auto GetSample = [&](int f) -> const Model::Transform& { return samples[f * nodes.size() + t]; };
+
+		for (int f = 0; f < frameCount; ++f) values[f] = LoadVector(GetSample(f).mPosition);
+		track.mPosition = ReduceChannel(std::span<const __m128>(values), settings.mPositionTolerance, mVectorKeys, EncodeVector, SampleVector);
+
+		for (int f = 0; f < frameCount; ++f) values[f] = LoadVector(GetSample(f).mScale);
+		track.mScale = ReduceChannel(std::span<const __m128>(values), settings.mScaleTolerance, mVectorKeys, EncodeVector, SampleVector);
+
+		// Normalize, and keep consecutive rotations in the same hemisphere
+		for (int f = 0; f < frameCount; ++f) {
+			__m128 q = LoadQuaternion(GetSample(f).mRotation);
+			q = _mm_div_ps(q, _mm_sqrt_ps(Dot4(q, q)));
+			if (f > 0) q = _mm_xor_ps(q, _mm_and_ps(Dot4(q, values[f - 1]), _mm_set1_ps(-0.0f)));
+			values[f] = q;
+		}
+		track.mRotation = ReduceChannel(std::span<const __m128>(values), settings.mRotationTolerance, mRotationKeys, EncodeRotation, SampleRotation);
+
+		mTracks.push_back(track);
+	}
+}
+
+void AnimationClip::Sample(float time, std::span<Model::Transform> pose) const {
+	float frame = std::clamp(time * mSampleRate, 0.0f, (float)std::max(mFrameCount - 1, 0));
+	for (auto& track : mTracks) {
+		auto& local = pose[track.mNode];
+		StoreVector(local.mPosition, SampleVector(track.mPosition, mVectorKeys, frame));
+		StoreQuaternion(local.mRotation, SampleRotation(track.mRotation, mRotationKeys, frame));
+		StoreVector(local.mScale, SampleVector(track.mScale, mVectorKeys, frame));
+	}
+}
+
+void AnimationSampler::Blend(std::span<const Model::Transform> from, std::span<const Model::Transform> to, float weight, std::span<Model::Transform> result) {
+	__m128 t = _mm_set1_ps(weight);
+	for (int n = 0; n < (int)result.size(); ++n) {
+		auto& a = from[n], &b = to[n];
+		auto& out = result[n];
+		StoreVector(out.mPosition, Lerp(LoadVector(a.mPosition), LoadVector(b.mPosition), t));
+		StoreQuaternion(out.mRotation, NLerp(LoadQuaternion(a.mRotation), LoadQuaternion(b.mRotation), t));
+		StoreVector(out.mScale, Lerp(LoadVector(a.mScale), LoadVector(b.mScale), t));
+	}
+}
+
+void AnimationSampler::ComputeSkinningMatrices(const Model& model, std::span<const Model::Transform> pose, std::span<Matrix> worlds, std::span<Matrix> result) {
+	Model::ComputeWorldMatrices(model.GetNodeParents(), pose, worlds);
+	auto& skin = model.GetSkin();
+	for (int j = 0; j < (int)skin.mJointNodes.size(); ++j) {
+		result[j] = skin.mInverseBindMatrices[j] * worlds[skin.mJointNodes[j]];
+	}
+}
+
+void AnimationSampler::Evaluate(const Model& model, std::span<const Instance> instances, GraphicsBuffer<Matrix>& skinningMatrices) {
+	if (instances.empty()) return;
+	int nodeCount = model.GetNodeCount();
+	int jointCount = model.GetJointCount();
+	// Grow the buffer to fit every instance (which forces a full upload)
+	int required = 0;
+	for (auto& instance : instances) {
+		if (instance.mMatrixOffset < 0) throw "Skinning matrix offset is negative";
+		required = std::max(required, instance.mMatrixOffset + jointCount);
+	}
+	if (required > skinningMatrices.GetCount()) skinningMatrices.SetCount(required);
+	// Only the written range is marked, so only it needs to be uploaded
+	auto [first, last] = std::minmax_element(instances.begin(), instances.end(),
+		[](const Instance& a, const Instance& b) { return a.mMatrixOffset < b.mMatrixOffset; });
+	int writeStart = first->mMatrixOffset;
+	auto written = skinningMatrices.GetValues(RangeInt(writeStart, last->mMatrixOffset + jointCount - writeStart));
+	std::for_each(std::execution::par, instances.begin(), instances.end(), [&](const Instance& instance) {
+		// Reused by every instance evaluated on this thread
+		thread_local std::vector<Model::Transform> pose, blendPose;
+		thread_local std::vector<Matrix> worlds;
+		auto bindPose = model.GetNodeLocals();
+		pose.assign(bindPose.begin(), bindPose.end());
+		worlds.resize(nodeCount);
+		if (instance.mClip != nullptr) instance.mClip->Sample(instance.mTime, pose);
+		if (instance.mBlendClip != nullptr && instance.mBlendWeight > 0.0f) {
+			blendPose.assign(bindPose.begin(), bindPose.end());
+			instance.mBlendClip->Sample(instance.mBlendTime, blendPose);
+			Blend(pose, blendPose, instance.mBlendWeight, pose);
+		}
+		assert(instance.mMatrixOffset + jointCount <= skinningMatrices.GetCount());
+		ComputeSkinningMatrices(model, pose, worlds, written.subspan(instance.mMatrixOffset - writeStart, jointCount));
+	});
+}
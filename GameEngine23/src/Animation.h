@@ -0,0 +1,91 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "MathTypes.h"
+#include "Model.h"
+#include "GraphicsBuffer.h"
+
+// Node animation stored as uniformly sampled keys. Each channel keeps
+// only every (1 << mStepShift)th frame, or a single key, if that stays
+// within tolerance. Rotations are stored as 16-bit normalized quaternions
+class AnimationClip
+{
+public:
+	struct Settings {
+		float mSampleRate = 30.0f;
+		// Largest reconstruction error allowed when dropping keys
+		float mPositionTolerance = 0.0005f;		// Model units
+		float mRotationTolerance = 0.0005f;		// Per quaternion component
+		float mScaleTolerance = 0.0005f;
+	};
+	struct RotationKey {
+		int16_t x, y, z, w;
+	};
+	struct Channel {
+		uint32_t mOffset = 0;		// First key, in mVectorKeys or mRotationKeys
+		uint16_t mCount = 0;		// 1 for constant channels
+		uint8_t mStepShift = 0;
+	};
+	struct Track {
+		int mNode;
+		Channel mPosition;
+		Channel mRotation;
+		Channel mScale;
+	};
+
+private:
+	std::string mName;
+	float mSampleRate = 30.0f;
+	int mFrameCount = 0;
+	std::vector<Track> mTracks;
+	std::vector<Vector3> mVectorKeys;
+	std::vector<RotationKey> mRotationKeys;
+
+public:
+	AnimationClip(const std::string& name) : mName(name) { }
+
+	const std::string& GetName() const { return mName; }
+	float GetSampleRate() const { return mSampleRate; }
+	float GetDuration() const { return mFrameCount > 1 ? (mFrameCount - 1) / mSampleRate : 0.0f; }
+	std::span<const Track> GetTracks() const { return mTracks; }
+	// Bytes used by tracks and keys
+	size_t GetDataSize() const {
+		return mTracks.size() * sizeof(Track) + mVectorKeys.size() * sizeof(Vector3) + mRotationKeys.size() * sizeof(RotationKey);
+	}
+
+	// Compress local transforms sampled at settings.mSampleRate, stored
+	// as samples[frame * nodes.size() + track]
+	void Build(std::span<const int> nodes, std::span<const Model::Transform> samples, int frameCount, const Settings& settings);
+	// Write the local transform of each animated node at `time` (seconds,
+	// clamped to the clip); other nodes are not modified
+	void Sample(float time, std::span<Model::Transform> pose) const;
+};
+
+// Evaluates poses and skinning matrices for characters sharing a Model
+class AnimationSampler
+{
+public:
+	struct Instance {
+		const AnimationClip* mClip;
+		float mTime;
+		// Optional second clip, weighted by mBlendWeight
+		const AnimationClip* mBlendClip = nullptr;
+		float mBlendTime = 0.0f;
+		float mBlendWeight = 0.0f;
+		// Where this instance's matrices start in the skinning buffer
+		int mMatrixOffset = 0;
+	};
+
+	// Lerp positions and scales, nlerp rotations
+	static void Blend(std::span<const Model::Transform> from, std::span<const Model::Transform> to, float weight, std::span<Model::Transform> result);
+	// Skinning matrix (inverse bind * joint world) for each joint of the skin
+	static void ComputeSkinningMatrices(const Model& model, std::span<const Model::Transform> pose, std::span<Matrix> worlds, std::span<Matrix> result);
+	// Sample, blend and skin each instance (in parallel), writing
+	// model.GetJointCount() matrices per instance. The buffer grows if
+	// an instance would write past its end; negative offsets throw
+	static void Evaluate(const Model& model, std::span<const Instance> instances, GraphicsBuffer<Matrix>& skinningMatrices);
+};
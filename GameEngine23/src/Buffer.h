@@ -2,7 +2,9 @@
 
 #include "MathTypes.h"
 #include "Resources.h"
+#include "BufferConversion.h"
 #include <span>
+#include <vector>
 #include <algorithm>
 #include <cassert>
 
@@ -139,6 +141,9 @@ struct BufferFormatType {
 		case Size32: return GetComponentCount() * 4;
 		case Size16: return GetComponentCount() * 2;
 		case Size8: return GetComponentCount() * 1;
+		// Packed formats have a fixed size
+		case Size1010102: case Size9995: return 4;
+		case Size5651: case Size444: return 2;
 		default: break;
 		}
 		return -1;
@@ -307,6 +312,98 @@ struct BufferFormatType {
 	}
 };
 
+// A sorted set of ranges, overlapping or adjacent ranges are merged
+class GraphicsBufferDelta
+{
+	std::vector<RangeInt> mCopyRegions;
+
+public:
+	void AppendRegion(RangeInt destRegion) {
+		if (destRegion.length <= 0) return;
+		auto it = std::partition_point(mCopyRegions.begin(), mCopyRegions.end(), [&](auto& item) {
+			return item.end() < destRegion.start;
+			});
+		if (it != mCopyRegions.end() && it->start <= destRegion.end()) {
+			*it = RangeInt::FromBeginEnd(
+				std::min(it->start, destRegion.start),
+				std::max(it->end(), destRegion.end())
+			);
+			auto nxt = it + 1;
+			for (; nxt != mCopyRegions.end(); ++nxt) {
+				if (nxt->start > it->end()) break;
+			}
+			if (nxt != it + 1) {
+				it->end(std::max(it->end(), (nxt - 1)->end()));
+				mCopyRegions.erase(it + 1, nxt);
+			}
+			return;
+		}
+		mCopyRegions.insert(it, destRegion);
+	}
+	std::span<RangeInt> GetRegions() { return mCopyRegions; }
+	std::span<const RangeInt> GetRegions() const { return mCopyRegions; }
+	int GetTotalLength() const {
+		int length = 0;
+		for (auto& region : mCopyRegions) length += region.length;
+		return length;
+	}
+	void Clear() { mCopyRegions.clear(); }
+};
+
+// Records which item ranges changed at each revision, so that a
+// consumer that last synced at an older revision can copy only those
+class BufferChangeLog
+{
+	struct Change {
+		int mRevision;
+		RangeInt mRange;
+	};
+	std::vector<Change> mChanges;
+	int mBaseRevision = 0;	// Changes up to this revision were not recorded
+	int mLastRevision = 0;	// Revision of the most recent recorded change
+public:
+	// Beyond this, the oldest half of the changes are forgotten
+	static const int MaxChanges = 1024;
+	// Copy everything if more than this fraction of items changed
+	static constexpr float FullCopyThreshold = 0.5f;
+
+	void Append(int revision, RangeInt range) {
+		// Merging into a newer change only ever copies more for older consumers
+		if (!mChanges.empty()) {
+			auto& last = mChanges.back();
+			if (range.start <= last.mRange.end() && range.end() >= last.mRange.start) {
+				last.mRange = RangeInt::FromBeginEnd(std::min(last.mRange.start, range.start), std::max(last.mRange.end(), range.end()));
+				last.mRevision = mLastRevision = revision;
+				return;
+			}
+		}
+		if (mChanges.size() >= MaxChanges) {
+			auto half = mChanges.begin() + MaxChanges / 2;
+			mBaseRevision = (half - 1)->mRevision;
+			mChanges.erase(mChanges.begin(), half);
+		}
+		mChanges.push_back({ revision, range });
+		mLastRevision = revision;
+	}
+	// Everything changed (ie. resized), consumers must copy in full
+	void Reset(int revision) {
+		mChanges.clear();
+		mBaseRevision = mLastRevision = revision;
+	}
+	// Collect the items changed after `revision`. Returns false if
+	// the history is incomplete or a full copy would be cheaper
+	bool GetChangesSince(int revision, int currentRevision, int itemCount, GraphicsBufferDelta& delta) const {
+		delta.Clear();
+		// Revision was bumped without recording what changed
+		if (currentRevision != mLastRevision) return false;
+		if (revision < mBaseRevision || revision > currentRevision) return false;
+		for (auto it = mChanges.rbegin(); it != mChanges.rend() && it->mRevision > revision; ++it) {
+			delta.AppendRegion(RangeInt::FromBeginEnd(it->mRange.start, std::min(it->mRange.end(), itemCount)));
+		}
+		return delta.GetTotalLength() <= itemCount * FullCopyThreshold;
+	}
+};
+
 struct BufferLayout {
 	enum Usage : uint8_t { Vertex, Index, Instance, Uniform, };
 	struct Element {
@@ -337,6 +434,8 @@ struct BufferLayout {
 	Usage mUsage = Usage::Vertex;
 	int mOffset = 0;	// Offset in count when binding a view to this buffer
 	int mCount = 0;		// How many elements to make current
+	// Owned by a BufferLayoutPersistent, null if changes are not recorded
+	const BufferChangeLog* mChangeLog = nullptr;
 	BufferLayout() : mIdentifier(0), mSize(0), mUsage(Usage::Vertex) { }
 	BufferLayout(size_t identifier, int size, Usage usage, int count)
 		: mIdentifier(identifier), mSize(size), mUsage(usage), mCount(count) { }
@@ -344,6 +443,11 @@ struct BufferLayout {
 	std::span<const Element> GetElements() const { return std::span<const Element>((const Element*)mElements, mElementCount); }
 	bool IsValid() const { return mElementCount != 0; }
 	bool GetAllowUnorderedAccess() const { return (mIdentifier & (1ull << 63)) != 0; }
+	// Get the item ranges written since `revision`, or false for a full upload
+	bool GetChangesSince(int revision, GraphicsBufferDelta& delta) const {
+		delta.Clear();
+		return mChangeLog != nullptr && mChangeLog->GetChangesSince(revision, mRevision, mCount, delta);
+	}
 	int CalculateBufferStride() const {
 		int size = 0;
 		for (auto& el : GetElements()) size += el.GetItemByteSize();
@@ -359,13 +463,15 @@ struct BufferLayout {
 struct BufferLayoutPersistent : public BufferLayout {
 protected:
 	std::vector<Element> mElementsStore;
+	BufferChangeLog mChangeLogStore;
 public:
 	int mAllocCount = 0;
-	BufferLayoutPersistent() : BufferLayout() { }
+	BufferLayoutPersistent() : BufferLayout() { mChangeLog = &mChangeLogStore; }
 	BufferLayoutPersistent(size_t identifier, int size, Usage usage, int count, int reserve = 4)
 		: BufferLayout(identifier, size, usage, count)
 	{
 		mElementsStore.reserve(reserve);
+		mChangeLog = &mChangeLogStore;
 	}
 	BufferLayoutPersistent(const BufferLayoutPersistent& other) { *this = other; }
 	BufferLayoutPersistent(BufferLayoutPersistent&& other) noexcept { *this = std::move(other); }
@@ -373,14 +479,29 @@ public:
 		*(BufferLayout*)this = *(BufferLayout*)&other;
 		mElementsStore = other.mElementsStore;
 		mElements = mElementsStore.data();
+		mChangeLogStore = other.mChangeLogStore;
+		mChangeLog = &mChangeLogStore;
 		return *this;
 	}
 	BufferLayoutPersistent& operator =(BufferLayoutPersistent&& other) {
 		*(BufferLayout*)this = *(BufferLayout*)&other;
 		mElementsStore = std::move(other.mElementsStore);
 		mElements = mElementsStore.data();
+		mChangeLogStore = std::move(other.mChangeLogStore);
+		mChangeLog = &mChangeLogStore;
 		return *this;
 	}
+
+	// Items in this range have been written and need to be uploaded
+	void MarkChanged(RangeInt itemRange) {
+		++mRevision;
+		mChangeLogStore.Append(mRevision, itemRange);
+	}
+	// All data must be uploaded
+	void MarkChanged() {
+		++mRevision;
+		mChangeLogStore.Reset(mRevision);
+	}
 	int AppendElement(Element element) {
 		mElementsStore.push_back(element);
 		mElements = mElementsStore.data();
@@ -531,6 +652,10 @@ struct BufferView {
 		if (type.size == BufferFormatType::Size32 && type.type == BufferFormatType::Float) {
 			Vector4 value = { }; std::memcpy(&value, data, mItemSize); return value;
 		}
+		if (type.IsFloat()) {
+			Vector4 value = { };
+			if (BufferConversion::ReadFloats(mElement->mFormat, data, mElement->mBufferStride, &value.x, 4, 1)) return value;
+		}
 		if (type.IsIntOrNrm()) {
 			if (type.IsNormalized()) {
 				if (type.IsSigned()) return Getter::GetItoF4<true, true>(type.size, data, mItemSize);
@@ -563,7 +688,8 @@ struct BufferView {
 			return value;
 		}
 		if (type.IsFloat()) {
-			Getter::ConvertTypedGet<true, uint8_t, true, true, float>(&value.r, data, mItemSize);
+			auto fvalue = GetVec4(index);
+			ConvertGeneric::Convert<true, uint8_t, true, float>(&value.r, &fvalue.x, type.GetComponentCount());
 			return value;
 		}
 		throw "Not implemented";
@@ -587,7 +713,8 @@ struct BufferView {
 			return value;
 		}
 		if (type.IsFloat()) {
-			Getter::ConvertTypedGet<false, int, true, true, float>(&value.x, data, mItemSize);
+			auto fvalue = GetVec4(index);
+			ConvertGeneric::Convert<false, int, true, float>(&value.x, &fvalue.x, type.GetComponentCount());
 			return value;
 		}
 		throw "Not implemented";
@@ -618,6 +745,8 @@ struct BufferView {
 			}
 			return;
 		}
+		// Half and packed floats
+		if (type.IsFloat() && BufferConversion::WriteFloats(mElement->mFormat, data, mElement->mBufferStride, &value.x, 4, 1)) return;
 		throw "Not supported";
 	}
 	void Set(int index, Vector3 value) { Set(index, Vector4(value, 0.0f)); }
@@ -643,10 +772,7 @@ struct BufferView {
 			}
 			return;
 		}
-		if (type.IsFloat()) {
-			Getter::ConvertTypedSet<false, false, float, false>((float*)data, &value.x, mItemSize);
-			return;
-		}
+		if (type.IsFloat() && BufferConversion::WriteInts(mElement->mFormat, data, mElement->mBufferStride, &value.x, 4, 1)) return;
 		throw "Not supported";
 	}
 	void Set(int index, Int2 value) {
@@ -662,6 +788,7 @@ struct BufferView {
 		if (type.size == BufferFormatType::Size8) {
 			if (type.IsIntOrNrm()) { std::transform(&value.x, &value.x + mType.GetComponentCount(), (int8_t*)data, [=](auto v) { return (int8_t)v; }); return; }
 		}
+		if (type.IsFloat() && BufferConversion::WriteInts(mElement->mFormat, data, mElement->mBufferStride, &value.x, 2, 1)) return;
 		throw "Not supported";
 	}
 	void Set(int index, int32_t value) { Set(index, Int2(value, value)); }
@@ -669,34 +796,42 @@ struct BufferView {
 
 	void Set(std::span<const Vector4> values, int offset = 0) {
 		if (Float32FastPath(offset, values.data(), (int)values.size(), 4)) return;
+		if (ConvertFloats(offset, &values.data()->x, (int)values.size(), 4)) return;
 		for (int i = 0; i < values.size(); ++i) Set(offset + i, values[i]);
 	}
 	void Set(std::span<const Vector3> values, int offset = 0) {
 		if (Float32FastPath(offset, values.data(), (int)values.size(), 3)) return;
+		if (ConvertFloats(offset, &values.data()->x, (int)values.size(), 3)) return;
 		for (int i = 0; i < values.size(); ++i) Set(offset + i, values[i]);
 	}
 	void Set(std::span<const Vector2> values, int offset = 0) {
 		if (Float32FastPath(offset, values.data(), (int)values.size(), 2)) return;
+		if (ConvertFloats(offset, &values.data()->x, (int)values.size(), 2)) return;
 		for (int i = 0; i < values.size(); ++i) Set(offset + i, values[i]);
 	}
 	void Set(std::span<const float> values, int offset = 0) {
 		if (Float32FastPath(offset, values.data(), (int)values.size(), 1)) return;
+		if (ConvertFloats(offset, values.data(), (int)values.size(), 1)) return;
 		for (int i = 0; i < values.size(); ++i) Set(offset + i, values[i]);
 	}
 	void Set(std::span<const Int4> values, int offset = 0) {
 		if (Int32FastPath(offset, values.data(), (int)values.size(), 4)) return;
+		if (ConvertInts(offset, &values.data()->x, (int)values.size(), 4)) return;
 		for (int i = 0; i < values.size(); ++i) Set(offset + i, values[i]);
 	}
 	void Set(std::span<const Int2> values, int offset = 0) {
 		if (Int32FastPath(offset, values.data(), (int)values.size(), 2)) return;
+		if (ConvertInts(offset, &values.data()->x, (int)values.size(), 2)) return;
 		for (int i = 0; i < values.size(); ++i) Set(offset + i, values[i]);
 	}
 	void Set(std::span<const int32_t> values, int offset = 0) {
 		if (Int32FastPath(offset, values.data(), (int)values.size(), 1)) return;
+		if (ConvertInts(offset, values.data(), (int)values.size(), 1)) return;
 		for (int i = 0; i < values.size(); ++i) Set(offset + i, values[i]);
 	}
 	void Set(std::span<const uint32_t> values, int offset = 0) {
 		if (Int32FastPath(offset, values.data(), (int)values.size(), 1)) return;
+		if (ConvertInts(offset, (const int32_t*)values.data(), (int)values.size(), 1)) return;
 		for (int i = 0; i < values.size(); ++i) Set(offset + i, values[i]);
 	}
 	void Set(std::span<const ColorB4> values, int offset = 0) {
@@ -704,20 +839,28 @@ struct BufferView {
 		for (int i = 0; i < values.size(); ++i) Set(offset + i, values[i]);
 	}
 
+	void Get(std::span<Vector4> values, int offset = 0) const { GetFloats(offset, &values.data()->x, (int)values.size(), 4); }
+	void Get(std::span<Vector3> values, int offset = 0) const { GetFloats(offset, &values.data()->x, (int)values.size(), 3); }
+	void Get(std::span<Vector2> values, int offset = 0) const { GetFloats(offset, &values.data()->x, (int)values.size(), 2); }
+	void Get(std::span<float> values, int offset = 0) const { GetFloats(offset, values.data(), (int)values.size(), 1); }
+
 	template<class T>
 	bool DataFastPath(BufferFormatType type, int index, const void* data, int count, int chCount) {
-		if (type.GetComponentCount() == chCount) { memcpy((T*)mElement->mData + index * chCount, data, count * chCount * sizeof(T)); return true; }
-		int dstCnt = mType.GetComponentCount();
+		auto* dstData = (uint8_t*)mElement->mData + index * mElement->mBufferStride;
+		int dstCnt = type.GetComponentCount();
+		if (dstCnt == chCount && mElement->mBufferStride == chCount * sizeof(T)) {
+			memcpy(dstData, data, count * chCount * sizeof(T));
+			return true;
+		}
 		int cpyCnt = std::min(chCount, dstCnt);
-		T* dstData = (T*)mElement->mData;
-		T* srcData = (T*)data;
-		for (int i = 0; i < count; ++i) {
+		const T* srcData = (const T*)data;
+		for (int i = 0; i < count; ++i, dstData += mElement->mBufferStride, srcData += chCount) {
+			T* dst = (T*)dstData;
 			int c = 0;
-			for (; c < cpyCnt; ++c) *(dstData++) = *(srcData++);
-			for (; c < dstCnt; ++c) *(dstData++) = T();
-			srcData += chCount - cpyCnt;
+			for (; c < cpyCnt; ++c) dst[c] = srcData[c];
+			for (; c < dstCnt; ++c) dst[c] = T();
 		}
-		return false;
+		return true;
 	}
 	bool Float32FastPath(int index, const void* data, int count, int chCount) {
 		auto type = BufferFormatType::GetType(mElement->mFormat);
@@ -734,6 +877,23 @@ struct BufferView {
 		if (type.IsIntOrNrm() && type.size == BufferFormatType::Size8) return DataFastPath<uint8_t>(type, index, data, count, chCount);
 		return false;
 	}
+	// Bulk conversion, the kernel is selected once for the whole span
+	bool ConvertFloats(int index, const float* data, int count, int chCount) {
+		auto* dstData = (uint8_t*)mElement->mData + index * mElement->mBufferStride;
+		return BufferConversion::WriteFloats(mElement->mFormat, dstData, mElement->mBufferStride, data, chCount, count);
+	}
+	bool ConvertInts(int index, const int32_t* data, int count, int chCount) {
+		auto* dstData = (uint8_t*)mElement->mData + index * mElement->mBufferStride;
+		return BufferConversion::WriteInts(mElement->mFormat, dstData, mElement->mBufferStride, data, chCount, count);
+	}
+	void GetFloats(int index, float* data, int count, int chCount) const {
+		auto* srcData = (const uint8_t*)mElement->mData + index * mElement->mBufferStride;
+		if (BufferConversion::ReadFloats(mElement->mFormat, srcData, mElement->mBufferStride, data, chCount, count)) return;
+		for (int i = 0; i < count; ++i) {
+			auto value = GetVec4(index + i);
+			std::memcpy(data + i * chCount, &value, chCount * sizeof(float));
+		}
+	}
 };
 
 template<typename T> struct TypedIterator;
@@ -782,6 +942,10 @@ struct TypedBufferView {
 	void Set(std::span<const Int2> values, int offset = 0) { mView.Set(values, offset + mRange.start); }
 	void Set(std::span<const int> values, int offset = 0) { mView.Set(values, offset + mRange.start); }
 	void Set(std::span<const ColorB4> values, int offset = 0) { mView.Set(values, offset + mRange.start); }
+	void Get(std::span<Vector4> values, int offset = 0) const { mView.Get(values, offset + mRange.start); }
+	void Get(std::span<Vector3> values, int offset = 0) const { mView.Get(values, offset + mRange.start); }
+	void Get(std::span<Vector2> values, int offset = 0) const { mView.Get(values, offset + mRange.start); }
+	void Get(std::span<float> values, int offset = 0) const { mView.Get(values, offset + mRange.start); }
 	template<typename V>
 	void Set(int offset, const V value) { mView.Set(offset + mRange.start, value); }
 };
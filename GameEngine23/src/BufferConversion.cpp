@@ -0,0 +1,560 @@
+#include "BufferConversion.h"
+#include "Buffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SIMD_TARGET(x)
+#else
+#include <cpuid.h>
+#define SIMD_TARGET(x) __attribute__((target(x)))
+#endif
+
+namespace BufferConversion {
+
+	static void Cpuid(int info[4], int leaf) {
+#if defined(_MSC_VER)
+		__cpuidex(info, leaf, 0);
+#else
+		__cpuid_count(leaf, 0, info[0], info[1], info[2], info[3]);
+#endif
+	}
+	static uint64_t GetXCR0() {
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		uint32_t eax, edx;
+		__asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return eax | ((uint64_t)edx << 32);
+#endif
+	}
+	static CpuFeatures DetectCpuFeatures() {
+		CpuFeatures features = { };
+		int info[4];
+		Cpuid(info, 0);
+		int maxLeaf = info[0];
+		if (maxLeaf < 1) return features;
+		Cpuid(info, 1);
+		features.mSSE41 = (info[2] & (1 << 19)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		bool f16c = (info[2] & (1 << 29)) != 0;
+		// The OS must also save YMM registers for AVX to be usable
+		bool ymm = osxsave && (GetXCR0() & 0x6) == 0x6;
+		features.mF16C = avx && ymm && f16c;
+		if (maxLeaf >= 7) {
+			Cpuid(info, 7);
+			features.mAVX2 = avx && ymm && (info[1] & (1 << 5)) != 0;
+		}
+		return features;
+	}
+	const CpuFeatures& GetCpuFeatures() {
+		static const CpuFeatures features = DetectCpuFeatures();
+		return features;
+	}
+
+	// Pack a positive float into a float with 5 exponent bits and MantBits mantissa
+	// Round to nearest even, bit-exact with F16C for halfs
+	template<int MantBits>
+	static uint32_t PackSmallFloat(uint32_t f) {
+		constexpr int Shift = 23 - MantBits;
+		constexpr uint32_t Inf = 0x1fu << MantBits;
+		if (f >= 0x7f800000) {
+			if (f == 0x7f800000) return Inf;
+			return Inf | (1u << (MantBits - 1)) | ((f >> Shift) & ((1u << MantBits) - 1));
+		}
+		// Anything at or above halfway past the max finite value rounds to infinity
+		constexpr uint32_t Overflow = 0x47000000 | (((1u << MantBits) - 1) << Shift) | (1u << (Shift - 1));
+		if (f >= Overflow) return Inf;
+		uint32_t h, rem, halfway;
+		if (f < 0x38800000) {
+			// Subnormal (or zero)
+			if (f <= ((112u - MantBits) << 23)) return 0;
+			uint32_t exp = f >> 23;
+			uint32_t mant = (f & 0x7fffff) | 0x800000;
+			uint32_t shift = 136 - MantBits - exp;
+			h = mant >> shift;
+			rem = mant & ((1u << shift) - 1);
+			halfway = 1u << (shift - 1);
+		}
+		else {
+			// Rebias exponent from 127 to 15
+			h = (f - 0x38000000) >> Shift;
+			rem = f & ((1u << Shift) - 1);
+			halfway = 1u << (Shift - 1);
+		}
+		if (rem > halfway || (rem == halfway && (h & 1))) ++h;
+		return h;
+	}
+	template<int MantBits>
+	static uint32_t UnpackSmallFloat(uint32_t h) {
+		uint32_t exp = (h >> MantBits) & 0x1f;
+		uint32_t mant = h & ((1u << MantBits) - 1);
+		// NaNs are quietened, as F16C does
+		if (exp == 0x1f) return 0x7f800000 | (mant << (23 - MantBits)) | (mant != 0 ? 0x400000 : 0);
+		if (exp != 0) return ((exp + 112) << 23) | (mant << (23 - MantBits));
+		float v = (float)mant * (1.0f / (float)(1 << (14 + MantBits)));
+		uint32_t f;
+		std::memcpy(&f, &v, sizeof(f));
+		return f;
+	}
+	static uint16_t FloatToHalf(float value) {
+		uint32_t f;
+		std::memcpy(&f, &value, sizeof(f));
+		return (uint16_t)(((f >> 16) & 0x8000) | PackSmallFloat<10>(f & 0x7fffffff));
+	}
+	static float HalfToFloat(uint16_t h) {
+		uint32_t f = ((uint32_t)(h & 0x8000) << 16) | UnpackSmallFloat<10>(h);
+		float v;
+		std::memcpy(&v, &f, sizeof(v));
+		return v;
+	}
+	// R11G11B10 has no sign bit, negative values clamp to zero
+	static uint32_t FloatToUFloat(float value, int channel) {
+		uint32_t f;
+		std::memcpy(&f, &value, sizeof(f));
+		if ((f & 0x80000000) != 0) {
+			// Negative NaNs stay NaN, everything else clamps to zero
+			if ((f & 0x7fffffff) <= 0x7f800000) return 0;
+			f &= 0x7fffffff;
+		}
+		return channel == 2 ? PackSmallFloat<5>(f) : PackSmallFloat<6>(f);
+	}
+	static float UFloatToFloat(uint32_t bits, int channel) {
+		uint32_t f = channel == 2 ? UnpackSmallFloat<5>(bits) : UnpackSmallFloat<6>(bits);
+		float v;
+		std::memcpy(&v, &f, sizeof(v));
+		return v;
+	}
+
+	struct Half { uint16_t mBits; };
+
+	// Per-channel conversion, matching BufferView's Normalizer semantics:
+	// normalized types are scaled by their max value and truncated
+	template<class T, bool Normalized> struct Channel {
+		static T FromFloat(float v) {
+			if constexpr (Normalized) {
+				constexpr float Lo = std::is_signed_v<T> ? -1.0f : 0.0f;
+				// Clamped the same way as the SIMD paths (NaN becomes Lo)
+				v = v > Lo ? v : Lo;
+				v = v < 1.0f ? v : 1.0f;
+				return (T)((double)v * std::numeric_limits<T>::max());
+			}
+			else return (T)v;
+		}
+		static T FromInt(int32_t v) { return (T)v; }
+		static float ToFloat(T v) {
+			if constexpr (Normalized) return (float)v / std::numeric_limits<T>::max();
+			else return (float)v;
+		}
+	};
+	template<> struct Channel<float, false> {
+		static float FromFloat(float v) { return v; }
+		static float FromInt(int32_t v) { return (float)v; }
+		static float ToFloat(float v) { return v; }
+	};
+	template<> struct Channel<Half, false> {
+		static Half FromFloat(float v) { return Half{ FloatToHalf(v) }; }
+		static Half FromInt(int32_t v) { return Half{ FloatToHalf((float)v) }; }
+		static float ToFloat(Half v) { return HalfToFloat(v.mBits); }
+	};
+
+	struct ConvertJob {
+		uint8_t* mDest;
+		int mDestStride;
+		const uint8_t* mSrc;
+		int mSrcStride;
+		int mSrcComponents;
+		int mDestComponents;
+		int mCount;
+		ConvertJob Skip(int count) const {
+			auto job = *this;
+			job.mDest += count * mDestStride;
+			job.mSrc += count * mSrcStride;
+			job.mCount -= count;
+			return job;
+		}
+		// Tightly packed with matching components can be treated as a flat array
+		bool TryFlatten(int srcSize, int destSize) {
+			if (mSrcComponents != mDestComponents) return false;
+			if (mSrcStride != mSrcComponents * srcSize) return false;
+			if (mDestStride != mDestComponents * destSize) return false;
+			mCount *= mSrcComponents;
+			mSrcComponents = mDestComponents = 1;
+			mSrcStride = srcSize;
+			mDestStride = destSize;
+			return true;
+		}
+		// Number of leading items that can read `readSize` bytes without
+		// running past the end of the (32-bit component) source data
+		int GetSafeCount(int readSize) const {
+			if (mCount == 0) return 0;
+			int end = (mCount - 1) * mSrcStride + mSrcComponents * 4;
+			if (end < readSize) return 0;
+			return std::min(mCount, (end - readSize) / mSrcStride + 1);
+		}
+	};
+	typedef void (*KernelFn)(const ConvertJob& job);
+
+	// Scalar fallbacks, handle any component count/stride
+	template<class To, bool Normalized> struct WriteFloatScalar {
+		static void Run(const ConvertJob& job) {
+			int cmpCount = std::min(job.mSrcComponents, job.mDestComponents);
+			for (int i = 0; i < job.mCount; ++i) {
+				auto* src = (const float*)(job.mSrc + i * job.mSrcStride);
+				auto* dst = (To*)(job.mDest + i * job.mDestStride);
+				int c = 0;
+				for (; c < cmpCount; ++c) dst[c] = Channel<To, Normalized>::FromFloat(src[c]);
+				for (; c < job.mDestComponents; ++c) dst[c] = Channel<To, Normalized>::FromFloat(0.0f);
+			}
+		}
+	};
+	template<class To, bool Normalized> struct WriteIntScalar {
+		static void Run(const ConvertJob& job) {
+			int cmpCount = std::min(job.mSrcComponents, job.mDestComponents);
+			for (int i = 0; i < job.mCount; ++i) {
+				auto* src = (const int32_t*)(job.mSrc + i * job.mSrcStride);
+				auto* dst = (To*)(job.mDest + i * job.mDestStride);
+				int c = 0;
+				for (; c < cmpCount; ++c) dst[c] = Channel<To, Normalized>::FromInt(src[c]);
+				for (; c < job.mDestComponents; ++c) dst[c] = Channel<To, Normalized>::FromInt(0);
+			}
+		}
+	};
+	template<class From, bool Normalized> struct ReadFloatScalar {
+		static void Run(const ConvertJob& job) {
+			int cmpCount = std::min(job.mSrcComponents, job.mDestComponents);
+			for (int i = 0; i < job.mCount; ++i) {
+				auto* src = (const From*)(job.mSrc + i * job.mSrcStride);
+				auto* dst = (float*)(job.mDest + i * job.mDestStride);
+				int c = 0;
+				for (; c < cmpCount; ++c) dst[c] = Channel<From, Normalized>::ToFloat(src[c]);
+				for (; c < job.mDestComponents; ++c) dst[c] = 0.0f;
+			}
+		}
+	};
+
+	template<template<class, bool> class Kernel>
+	static KernelFn SelectScalar(BufferFormatType type) {
+		switch (type.size) {
+		case BufferFormatType::Size32:
+			switch (type.type) {
+			case BufferFormatType::Float: return &Kernel<float, false>::Run;
+			case BufferFormatType::SInt: return &Kernel<int32_t, false>::Run;
+			case BufferFormatType::UInt: return &Kernel<uint32_t, false>::Run;
+			case BufferFormatType::SNrm: return &Kernel<int32_t, true>::Run;
+			case BufferFormatType::UNrm: return &Kernel<uint32_t, true>::Run;
+			default: break;
+			} break;
+		case BufferFormatType::Size16:
+			switch (type.type) {
+			case BufferFormatType::Float: return &Kernel<Half, false>::Run;
+			case BufferFormatType::SInt: return &Kernel<int16_t, false>::Run;
+			case BufferFormatType::UInt: return &Kernel<uint16_t, false>::Run;
+			case BufferFormatType::SNrm: return &Kernel<int16_t, true>::Run;
+			case BufferFormatType::UNrm: return &Kernel<uint16_t, true>::Run;
+			default: break;
+			} break;
+		case BufferFormatType::Size8:
+			switch (type.type) {
+			case BufferFormatType::SInt: return &Kernel<int8_t, false>::Run;
+			case BufferFormatType::UInt: return &Kernel<uint8_t, false>::Run;
+			case BufferFormatType::SNrm: return &Kernel<int8_t, true>::Run;
+			case BufferFormatType::UNrm: return &Kernel<uint8_t, true>::Run;
+			default: break;
+			} break;
+		default: break;
+		}
+		return nullptr;
+	}
+
+	// float -> snorm8/unorm8
+	template<bool Signed> using Norm8 = std::conditional_t<Signed, int8_t, uint8_t>;
+	template<bool Signed>
+	SIMD_TARGET("sse2") static __m128i ScaleNorm8(__m128 v) {
+		v = _mm_max_ps(v, _mm_set1_ps(Signed ? -1.0f : 0.0f));
+		v = _mm_min_ps(v, _mm_set1_ps(1.0f));
+		return _mm_cvttps_epi32(_mm_mul_ps(v, _mm_set1_ps(Signed ? 127.0f : 255.0f)));
+	}
+	template<bool Signed>
+	SIMD_TARGET("sse2") static __m128i PackNorm8(__m128i a, __m128i b, __m128i c, __m128i d) {
+		__m128i ab = _mm_packs_epi32(a, b), cd = _mm_packs_epi32(c, d);
+		return Signed ? _mm_packs_epi16(ab, cd) : _mm_packus_epi16(ab, cd);
+	}
+	SIMD_TARGET("sse2") static __m128 GetComponentMask(int cmpCount) {
+		return _mm_castsi128_ps(_mm_setr_epi32(
+			cmpCount > 0 ? -1 : 0, cmpCount > 1 ? -1 : 0, cmpCount > 2 ? -1 : 0, cmpCount > 3 ? -1 : 0));
+	}
+	// Flat array of floats, 16 at a time
+	template<bool Signed>
+	SIMD_TARGET("sse2") static void WriteNorm8Flat_SSE(const ConvertJob& job) {
+		auto* src = (const float*)job.mSrc;
+		auto* dst = job.mDest;
+		int i = 0;
+		for (; i + 16 <= job.mCount; i += 16) {
+			__m128i p = PackNorm8<Signed>(
+				ScaleNorm8<Signed>(_mm_loadu_ps(src + i + 0)), ScaleNorm8<Signed>(_mm_loadu_ps(src + i + 4)),
+				ScaleNorm8<Signed>(_mm_loadu_ps(src + i + 8)), ScaleNorm8<Signed>(_mm_loadu_ps(src + i + 12)));
+			_mm_storeu_si128((__m128i*)(dst + i), p);
+		}
+		WriteFloatScalar<Norm8<Signed>, true>::Run(job.Skip(i));
+	}
+	// Up to 4 floats per item into 4 x 8-bit, 4 items at a time
+	template<bool Signed>
+	SIMD_TARGET("sse2") static void WriteNorm8x4_SSE(const ConvertJob& job) {
+		__m128 mask = GetComponentMask(job.mSrcComponents);
+		int safeCount = job.GetSafeCount(16);
+		int i = 0;
+		for (; i + 4 <= safeCount; i += 4) {
+			auto* src = job.mSrc + i * job.mSrcStride;
+			__m128i p = PackNorm8<Signed>(
+				ScaleNorm8<Signed>(_mm_and_ps(_mm_loadu_ps((const float*)(src + 0 * job.mSrcStride)), mask)),
+				ScaleNorm8<Signed>(_mm_and_ps(_mm_loadu_ps((const float*)(src + 1 * job.mSrcStride)), mask)),
+				ScaleNorm8<Signed>(_mm_and_ps(_mm_loadu_ps((const float*)(src + 2 * job.mSrcStride)), mask)),
+				ScaleNorm8<Signed>(_mm_and_ps(_mm_loadu_ps((const float*)(src + 3 * job.mSrcStride)), mask)));
+			auto* dst = job.mDest + i * job.mDestStride;
+			if (job.mDestStride == 4) {
+				_mm_storeu_si128((__m128i*)dst, p);
+				continue;
+			}
+			alignas(16) uint32_t items[4];
+			_mm_store_si128((__m128i*)items, p);
+			for (int n = 0; n < 4; ++n) std::memcpy(dst + n * job.mDestStride, &items[n], 4);
+		}
+		WriteFloatScalar<Norm8<Signed>, true>::Run(job.Skip(i));
+	}
+	// As above, 8 items at a time
+	template<bool Signed>
+	SIMD_TARGET("avx2") static void WriteNorm8x4_AVX2(const ConvertJob& job) {
+		__m256 mask = _mm256_set_m128(GetComponentMask(job.mSrcComponents), GetComponentMask(job.mSrcComponents));
+		__m256 lo = _mm256_set1_ps(Signed ? -1.0f : 0.0f), hi = _mm256_set1_ps(1.0f);
+		__m256 scale = _mm256_set1_ps(Signed ? 127.0f : 255.0f);
+		int safeCount = job.GetSafeCount(16);
+		int i = 0;
+		for (; i + 8 <= safeCount; i += 8) {
+			auto* src = job.mSrc + i * job.mSrcStride;
+			// Lane 0 holds items 0-3, lane 1 holds items 4-7, so in-lane packs produce ordered output
+			__m256i v[4];
+			for (int n = 0; n < 4; ++n) {
+				__m256 f = _mm256_set_m128(
+					_mm_loadu_ps((const float*)(src + (n + 4) * job.mSrcStride)),
+					_mm_loadu_ps((const float*)(src + n * job.mSrcStride)));
+				f = _mm256_min_ps(_mm256_max_ps(_mm256_and_ps(f, mask), lo), hi);
+				v[n] = _mm256_cvttps_epi32(_mm256_mul_ps(f, scale));
+			}
+			__m256i ab = _mm256_packs_epi32(v[0], v[1]), cd = _mm256_packs_epi32(v[2], v[3]);
+			__m256i p = Signed ? _mm256_packs_epi16(ab, cd) : _mm256_packus_epi16(ab, cd);
+			auto* dst = job.mDest + i * job.mDestStride;
+			if (job.mDestStride == 4) {
+				_mm256_storeu_si256((__m256i*)dst, p);
+				continue;
+			}
+			alignas(32) uint32_t items[8];
+			_mm256_store_si256((__m256i*)items, p);
+			for (int n = 0; n < 8; ++n) std::memcpy(dst + n * job.mDestStride, &items[n], 4);
+		}
+		WriteFloatScalar<Norm8<Signed>, true>::Run(job.Skip(i));
+	}
+
+	// float -> half
+	SIMD_TARGET("avx,f16c") static void WriteHalfFlat_F16C(const ConvertJob& job) {
+		auto* src = (const float*)job.mSrc;
+		auto* dst = (uint16_t*)job.mDest;
+		int i = 0;
+		for (; i + 8 <= job.mCount; i += 8) {
+			_mm_storeu_si128((__m128i*)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+		}
+		WriteFloatScalar<Half, false>::Run(job.Skip(i));
+	}
+	SIMD_TARGET("avx,f16c") static void WriteHalfItems_F16C(const ConvertJob& job) {
+		__m128 mask = GetComponentMask(job.mSrcComponents);
+		int safeCount = job.GetSafeCount(16);
+		int i = 0;
+		for (; i < safeCount; ++i) {
+			__m128 v = _mm_and_ps(_mm_loadu_ps((const float*)(job.mSrc + i * job.mSrcStride)), mask);
+			__m128i h = _mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT);
+			auto* dst = job.mDest + i * job.mDestStride;
+			if (job.mDestComponents == 4) _mm_storel_epi64((__m128i*)dst, h);
+			else {
+				alignas(16) uint16_t items[8];
+				_mm_store_si128((__m128i*)items, h);
+				std::memcpy(dst, items, job.mDestComponents * sizeof(uint16_t));
+			}
+		}
+		WriteFloatScalar<Half, false>::Run(job.Skip(i));
+	}
+
+	// int32 -> int16 (truncating, same as a C cast)
+	SIMD_TARGET("sse2") static __m128i TruncateInt16(__m128i v) {
+		return _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+	}
+	template<class To>
+	SIMD_TARGET("sse2") static void WriteInt16Flat_SSE(const ConvertJob& job) {
+		auto* src = (const __m128i*)job.mSrc;
+		auto* dst = (__m128i*)job.mDest;
+		int i = 0;
+		for (; i + 8 <= job.mCount; i += 8, src += 2, ++dst) {
+			__m128i a = TruncateInt16(_mm_loadu_si128(src + 0));
+			__m128i b = TruncateInt16(_mm_loadu_si128(src + 1));
+			_mm_storeu_si128(dst, _mm_packs_epi32(a, b));
+		}
+		WriteIntScalar<To, false>::Run(job.Skip(i));
+	}
+	template<class To>
+	SIMD_TARGET("avx2") static void WriteInt16Flat_AVX2(const ConvertJob& job) {
+		auto* src = (const __m256i*)job.mSrc;
+		auto* dst = (__m256i*)job.mDest;
+		int i = 0;
+		for (; i + 16 <= job.mCount; i += 16, src += 2, ++dst) {
+			__m256i a = _mm256_srai_epi32(_mm256_slli_epi32(_mm256_loadu_si256(src + 0), 16), 16);
+			__m256i b = _mm256_srai_epi32(_mm256_slli_epi32(_mm256_loadu_si256(src + 1), 16), 16);
+			// Packs works per 128-bit lane, reorder the 64-bit blocks afterwards
+			_mm256_storeu_si256(dst, _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8));
+		}
+		WriteIntScalar<To, false>::Run(job.Skip(i));
+	}
+
+	// snorm8/unorm8 -> float
+	template<bool Signed>
+	SIMD_TARGET("sse2") static void ReadNorm8Flat_SSE(const ConvertJob& job) {
+		const __m128 scale = _mm_set1_ps(Signed ? 127.0f : 255.0f);
+		const __m128i zero = _mm_setzero_si128();
+		auto* dst = (float*)job.mDest;
+		int i = 0;
+		for (; i + 16 <= job.mCount; i += 16) {
+			__m128i b = _mm_loadu_si128((const __m128i*)(job.mSrc + i));
+			__m128i w[2], d[4];
+			if (Signed) {
+				w[0] = _mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8);
+				w[1] = _mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8);
+				for (int n = 0; n < 2; ++n) {
+					d[n * 2 + 0] = _mm_srai_epi32(_mm_unpacklo_epi16(w[n], w[n]), 16);
+					d[n * 2 + 1] = _mm_srai_epi32(_mm_unpackhi_epi16(w[n], w[n]), 16);
+				}
+			}
+			else {
+				w[0] = _mm_unpacklo_epi8(b, zero);
+				w[1] = _mm_unpackhi_epi8(b, zero);
+				for (int n = 0; n < 2; ++n) {
+					d[n * 2 + 0] = _mm_unpacklo_epi16(w[n], zero);
+					d[n * 2 + 1] = _mm_unpackhi_epi16(w[n], zero);
+				}
+			}
+			// Divide (rather than multiply by reciprocal) to match the scalar path exactly
+			for (int n = 0; n < 4; ++n)
+				_mm_storeu_ps(dst + i + n * 4, _mm_div_ps(_mm_cvtepi32_ps(d[n]), scale));
+		}
+		ReadFloatScalar<Norm8<Signed>, true>::Run(job.Skip(i));
+	}
+
+	// half -> float
+	SIMD_TARGET("avx,f16c") static void ReadHalfFlat_F16C(const ConvertJob& job) {
+		auto* src = (const uint16_t*)job.mSrc;
+		auto* dst = (float*)job.mDest;
+		int i = 0;
+		for (; i + 8 <= job.mCount; i += 8) {
+			_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+		}
+		ReadFloatScalar<Half, false>::Run(job.Skip(i));
+	}
+
+	// float <-> R11G11B10, packed into a single 32-bit word
+	template<class From>
+	static void WriteR11G11B10(const ConvertJob& job) {
+		int cmpCount = std::min(job.mSrcComponents, 3);
+		for (int i = 0; i < job.mCount; ++i) {
+			auto* src = (const From*)(job.mSrc + i * job.mSrcStride);
+			uint32_t packed = 0;
+			for (int c = 0; c < cmpCount; ++c) packed |= FloatToUFloat((float)src[c], c) << (c * 11);
+			std::memcpy(job.mDest + i * job.mDestStride, &packed, sizeof(packed));
+		}
+	}
+	static void ReadR11G11B10(const ConvertJob& job) {
+		int cmpCount = std::min(job.mDestComponents, 3);
+		for (int i = 0; i < job.mCount; ++i) {
+			uint32_t packed;
+			std::memcpy(&packed, job.mSrc + i * job.mSrcStride, sizeof(packed));
+			auto* dst = (float*)(job.mDest + i * job.mDestStride);
+			int c = 0;
+			for (; c < cmpCount; ++c) dst[c] = UFloatToFloat((packed >> (c * 11)) & (c == 2 ? 0x3ff : 0x7ff), c);
+			for (; c < job.mDestComponents; ++c) dst[c] = 0.0f;
+		}
+	}
+
+	static KernelFn SelectFloatWriter(BufferFormatType type, ConvertJob& job) {
+		auto& cpu = GetCpuFeatures();
+		if (type.size == BufferFormatType::Size8 && type.IsNormalized()) {
+			bool sign = type.IsSigned();
+			if (job.TryFlatten(sizeof(float), 1))
+				return sign ? &WriteNorm8Flat_SSE<true> : &WriteNorm8Flat_SSE<false>;
+			if (job.mDestComponents == 4) {
+				if (cpu.mAVX2) return sign ? &WriteNorm8x4_AVX2<true> : &WriteNorm8x4_AVX2<false>;
+				return sign ? &WriteNorm8x4_SSE<true> : &WriteNorm8x4_SSE<false>;
+			}
+		}
+		if (type.size == BufferFormatType::Size16 && type.IsFloat() && cpu.mF16C) {
+			if (job.TryFlatten(sizeof(float), sizeof(uint16_t))) return &WriteHalfFlat_F16C;
+			return &WriteHalfItems_F16C;
+		}
+		if (type.size == BufferFormatType::Size1010102 && type.IsFloat()) return &WriteR11G11B10<float>;
+		return SelectScalar<WriteFloatScalar>(type);
+	}
+	static KernelFn SelectIntWriter(BufferFormatType type, ConvertJob& job) {
+		auto& cpu = GetCpuFeatures();
+		// Ints are written unscaled, even into normalized formats
+		if (type.size == BufferFormatType::Size16 && type.IsIntOrNrm()) {
+			if (job.TryFlatten(sizeof(int32_t), sizeof(int16_t))) {
+				if (type.IsSigned())
+					return cpu.mAVX2 ? &WriteInt16Flat_AVX2<int16_t> : &WriteInt16Flat_SSE<int16_t>;
+				return cpu.mAVX2 ? &WriteInt16Flat_AVX2<uint16_t> : &WriteInt16Flat_SSE<uint16_t>;
+			}
+		}
+		if (type.size == BufferFormatType::Size1010102 && type.IsFloat()) return &WriteR11G11B10<int32_t>;
+		return SelectScalar<WriteIntScalar>(type);
+	}
+	static KernelFn SelectFloatReader(BufferFormatType type, ConvertJob& job) {
+		auto& cpu = GetCpuFeatures();
+		if (type.size == BufferFormatType::Size8 && type.IsNormalized()) {
+			if (job.TryFlatten(1, sizeof(float)))
+				return type.IsSigned() ? &ReadNorm8Flat_SSE<true> : &ReadNorm8Flat_SSE<false>;
+		}
+		if (type.size == BufferFormatType::Size16 && type.IsFloat() && cpu.mF16C) {
+			if (job.TryFlatten(sizeof(uint16_t), sizeof(float))) return &ReadHalfFlat_F16C;
+		}
+		if (type.size == BufferFormatType::Size1010102 && type.IsFloat()) return &ReadR11G11B10;
+		return SelectScalar<ReadFloatScalar>(type);
+	}
+
+	bool WriteFloats(BufferFormat format, void* dest, int destStride, const float* src, int srcComponents, int count) {
+		auto type = BufferFormatType::GetType(format);
+		ConvertJob job{ (uint8_t*)dest, destStride, (const uint8_t*)src, srcComponents * (int)sizeof(float),
+			srcComponents, type.GetComponentCount(), count };
+		auto kernel = SelectFloatWriter(type, job);
+		if (kernel == nullptr) return false;
+		kernel(job);
+		return true;
+	}
+	bool WriteInts(BufferFormat format, void* dest, int destStride, const int32_t* src, int srcComponents, int count) {
+		auto type = BufferFormatType::GetType(format);
+		ConvertJob job{ (uint8_t*)dest, destStride, (const uint8_t*)src, srcComponents * (int)sizeof(int32_t),
+			srcComponents, type.GetComponentCount(), count };
+		auto kernel = SelectIntWriter(type, job);
+		if (kernel == nullptr) return false;
+		kernel(job);
+		return true;
+	}
+	bool ReadFloats(BufferFormat format, const void* src, int srcStride, float* dest, int dstComponents, int count) {
+		auto type = BufferFormatType::GetType(format);
+		ConvertJob job{ (uint8_t*)dest, dstComponents * (int)sizeof(float), (const uint8_t*)src, srcStride,
+			type.GetComponentCount(), dstComponents, count };
+		auto kernel = SelectFloatReader(type, job);
+		if (kernel == nullptr) return false;
+		kernel(job);
+		return true;
+	}
+}
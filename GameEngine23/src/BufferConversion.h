@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+enum BufferFormat : uint8_t;
+
+// Bulk conversion kernels for BufferView span Set/Get
+// The kernel is chosen once per call (rather than per element)
+// and is vectorised with SSE/AVX2 when the CPU supports it
+namespace BufferConversion {
+	struct CpuFeatures {
+		bool mSSE41;
+		bool mAVX2;
+		bool mF16C;
+	};
+	const CpuFeatures& GetCpuFeatures();
+
+	// Write `count` items of `srcComponents` floats into a buffer of `format`
+	// Missing destination components are zero filled
+	// Returns false if no conversion exists for this format
+	bool WriteFloats(BufferFormat format, void* dest, int destStride, const float* src, int srcComponents, int count);
+	// Same as WriteFloats but with integer source data (not normalized)
+	bool WriteInts(BufferFormat format, void* dest, int destStride, const int32_t* src, int srcComponents, int count);
+	// Read `count` items from a buffer of `format` into `dstComponents` floats per item
+	bool ReadFloats(BufferFormat format, const void* src, int srcStride, float* dest, int dstComponents, int count);
+}
@@ -0,0 +1,136 @@
+#include "BufferCopyPlan.h"
+
+#include <cstring>
+#include <utility>
+
+// Copy a full item of every stream per iteration. Sizes are compile-time
+// so each memcpy becomes a fixed set of wide loads/stores
+template<int... Sizes>
+struct InterleaveKernel {
+	static constexpr int Count = sizeof...(Sizes);
+	static constexpr int ItemSizes[] = { Sizes... };
+	static constexpr int Stride = (Sizes + ...);
+	static void Run(uint8_t* dest, const uint8_t* const* sources, const int* strides, int count) {
+		const uint8_t* src[Count];
+		int srcStride[Count];
+		for (int s = 0; s < Count; ++s) { src[s] = sources[s]; srcStride[s] = strides[s]; }
+		for (int i = 0; i < count; ++i, dest += Stride) {
+			int offset = 0;
+			[&]<size_t... I>(std::index_sequence<I...>) {
+				((std::memcpy(dest + offset, src[I], ItemSizes[I]), offset += ItemSizes[I], src[I] += srcStride[I]), ...);
+			}(std::make_index_sequence<Count>());
+		}
+	}
+};
+
+struct KernelEntry {
+	int mCount;
+	int mSizes[4];
+	BufferCopyPlan::Kernel mKernel;
+};
+template<int... Sizes>
+static constexpr KernelEntry MakeKernel() { return { sizeof...(Sizes), { Sizes... }, &InterleaveKernel<Sizes...>::Run }; }
+
+// Position (12 or half 8) followed by normals, uvs, colors in various encodings
+static const KernelEntry Kernels[] = {
+	MakeKernel<12, 12>(),
+	MakeKernel<12, 8>(),
+	MakeKernel<12, 4>(),
+	MakeKernel<12, 12, 8>(),
+	MakeKernel<12, 12, 4>(),
+	MakeKernel<12, 4, 4>(),
+	MakeKernel<12, 8, 4>(),
+	MakeKernel<12, 4, 8>(),
+	MakeKernel<12, 12, 8, 4>(),
+	MakeKernel<12, 4, 8, 4>(),
+	MakeKernel<8, 4, 4>(),
+	MakeKernel<8, 4>(),
+	MakeKernel<8, 8>(),
+};
+
+template<int Size>
+static void CopyStream(uint8_t* dest, int destStride, const uint8_t* src, int srcStride, int count) {
+	for (int i = 0; i < count; ++i, dest += destStride, src += srcStride) std::memcpy(dest, src, Size);
+}
+static void CopyStream(uint8_t* dest, int destStride, const uint8_t* src, int srcStride, int size, int count) {
+	switch (size) {
+	case 1: CopyStream<1>(dest, destStride, src, srcStride, count); break;
+	case 2: CopyStream<2>(dest, destStride, src, srcStride, count); break;
+	case 4: CopyStream<4>(dest, destStride, src, srcStride, count); break;
+	case 8: CopyStream<8>(dest, destStride, src, srcStride, count); break;
+	case 12: CopyStream<12>(dest, destStride, src, srcStride, count); break;
+	case 16: CopyStream<16>(dest, destStride, src, srcStride, count); break;
+	default:
+		for (int i = 0; i < count; ++i, dest += destStride, src += srcStride) std::memcpy(dest, src, size);
+		break;
+	}
+}
+
+void BufferCopyPlan::Build(const BufferLayout& binding, int itemSize) {
+	auto elements = binding.GetElements();
+	if (elements.size() > MaxStreams) throw "Too many buffer elements";
+	mStreamCount = 0;
+	mItemSize = itemSize;
+	mKernel = nullptr;
+	int offset = 0, packedSize = 0;
+	for (auto& element : elements) {
+		auto& stream = mStreams[mStreamCount++];
+		stream.mSize = element.GetItemByteSize();
+		stream.mDestOffset = offset = AlignElement(offset, stream.mSize);
+		stream.mSrcStride = element.mBufferStride;
+		offset += stream.mSize;
+		packedSize += stream.mSize;
+	}
+	// Kernels require tightly packed items (no alignment padding)
+	if (offset != itemSize || packedSize != itemSize) return;
+	for (auto& kernel : Kernels) {
+		if (kernel.mCount != mStreamCount) continue;
+		int s = 0;
+		for (; s < mStreamCount; ++s) if (kernel.mSizes[s] != mStreams[s].mSize) break;
+		if (s != mStreamCount) continue;
+		mKernel = kernel.mKernel;
+		break;
+	}
+}
+
+bool BufferCopyPlan::Matches(const BufferLayout& binding, int itemSize) const {
+	auto elements = binding.GetElements();
+	if (mItemSize != itemSize || mStreamCount != (int)elements.size()) return false;
+	for (int s = 0; s < mStreamCount; ++s) {
+		if (mStreams[s].mSize != elements[s].GetItemByteSize()) return false;
+		if (mStreams[s].mSrcStride != elements[s].mBufferStride) return false;
+	}
+	return true;
+}
+
+void BufferCopyPlan::Write(uint8_t* dest, const BufferLayout& binding, int byteOffset, int byteSize) const {
+	auto elements = binding.GetElements();
+	assert(Matches(binding, mItemSize));
+	// Single tightly packed stream is a straight copy
+	if (mStreamCount == 1 && mStreams[0].mSrcStride == mItemSize) {
+		std::memcpy(dest, (uint8_t*)elements[0].mData + byteOffset, byteSize);
+		return;
+	}
+	int first = byteOffset / mItemSize;
+	int count = byteSize / mItemSize;
+	const uint8_t* sources[MaxStreams];
+	int strides[MaxStreams];
+	bool hasNull = false;
+	for (int s = 0; s < mStreamCount; ++s) {
+		sources[s] = (const uint8_t*)elements[s].mData;
+		if (sources[s] == nullptr) { hasNull = true; continue; }
+		sources[s] += first * mStreams[s].mSrcStride;
+		strides[s] = mStreams[s].mSrcStride;
+	}
+	if (mKernel != nullptr && !hasNull) {
+		mKernel(dest, sources, strides, count);
+		return;
+	}
+	// Generic path, one stream at a time
+	if (hasNull) std::memset(dest, 0, byteSize);
+	for (int s = 0; s < mStreamCount; ++s) {
+		if (sources[s] == nullptr) continue;
+		auto& stream = mStreams[s];
+		CopyStream(dest + stream.mDestOffset, mItemSize, sources[s], stream.mSrcStride, stream.mSize, count);
+	}
+}
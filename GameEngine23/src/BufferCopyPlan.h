@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Buffer.h"
+
+// Interleaves the elements of a BufferLayout into a single
+// destination buffer (ie. for uploading separate vertex streams).
+// Built once per element layout and reused; common element size
+// combinations get a kernel with fixed-size copies
+struct BufferCopyPlan {
+	typedef void (*Kernel)(uint8_t* dest, const uint8_t* const* sources, const int* strides, int count);
+	static const int MaxStreams = 16;
+	struct Stream {
+		int mDestOffset;
+		int mSize;
+		int mSrcStride;
+	};
+
+	Stream mStreams[MaxStreams];
+	int mStreamCount = 0;
+	int mItemSize = 0;
+	// Specialised kernel, or nullptr if the generic path must be used
+	Kernel mKernel = nullptr;
+
+	BufferCopyPlan() { }
+	BufferCopyPlan(const BufferLayout& binding, int itemSize) { Build(binding, itemSize); }
+
+	// Compute element offsets (matching the input layout) and select a kernel
+	void Build(const BufferLayout& binding, int itemSize);
+	// Does this plan still describe the binding
+	bool Matches(const BufferLayout& binding, int itemSize) const;
+	// Rebuild only if the element layout has changed
+	const BufferCopyPlan& Require(const BufferLayout& binding, int itemSize) {
+		if (!Matches(binding, itemSize)) Build(binding, itemSize);
+		return *this;
+	}
+	// Write interleaved data for the destination byte range
+	void Write(uint8_t* dest, const BufferLayout& binding, int byteOffset, int byteSize) const;
+
+	// Offset of an element within an interleaved item
+	static int AlignElement(int offset, int size) { return size >= 4 ? (offset + 3) & ~3 : offset; }
+};
@@ -5,6 +5,15 @@
 #include <span>
 #include <vector>
 #include <algorithm>
+#include <iterator>
+#include <map>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <new>
+#include <type_traits>
 
 template<class T, int Size = 7>
 struct InplaceVector {
@@ -69,164 +78,498 @@ public:
 	std::span<T> span() { return std::span<T>(data(), mData.mSize); }
 };
 
+// Vector with inline storage for N items before spilling to the heap
+// Inline items share storage with the heap pointer, so the footprint
+// stays close to HybridVector while supporting large counts and
+// non-trivial types (growth is exception safe)
+template<class T, int N = 8>
+class SmallVector {
+	static inline constexpr size_t GetInlineBytes() { return std::max(sizeof(T) * N, sizeof(T*)); }
+	uint32_t mSize = 0;
+	uint32_t mCapacity = N;
+	union {
+		T* mPtr;
+		alignas(T) uint8_t mInline[GetInlineBytes()];
+	};
+	bool IsInline() const { return mCapacity == N; }
+	void Grow(uint32_t minCapacity) {
+		uint32_t newCap = std::max(minCapacity, std::max(mCapacity * 2, 4u));
+		T* newData = std::allocator<T>().allocate(newCap);
+		try {
+			if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>)
+				std::uninitialized_move(begin(), end(), newData);
+			else
+				std::uninitialized_copy(begin(), end(), newData);
+		}
+		catch (...) {
+			std::allocator<T>().deallocate(newData, newCap);
+			throw;
+		}
+		std::destroy(begin(), end());
+		Release();
+		mPtr = newData;
+		mCapacity = newCap;
+	}
+	void Release() {
+		if (!IsInline()) std::allocator<T>().deallocate(mPtr, mCapacity);
+		mCapacity = N;
+	}
+public:
+	SmallVector() { }
+	SmallVector(const SmallVector& other) { *this = other; }
+	SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) { *this = std::move(other); }
+	~SmallVector() { clear(); Release(); }
+	SmallVector& operator = (const SmallVector& other) {
+		if (this == &other) return *this;
+		clear();
+		reserve(other.mSize);
+		std::uninitialized_copy(other.begin(), other.end(), data());
+		mSize = other.mSize;
+		return *this;
+	}
+	SmallVector& operator = (SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+		if (this == &other) return *this;
+		clear();
+		if (!other.IsInline()) {
+			// Steal the heap allocation
+			Release();
+			mPtr = other.mPtr;
+			mCapacity = other.mCapacity;
+			mSize = other.mSize;
+			other.mCapacity = N;
+			other.mSize = 0;
+			return *this;
+		}
+		reserve(other.mSize);
+		std::uninitialized_move(other.begin(), other.end(), data());
+		mSize = other.mSize;
+		other.clear();
+		return *this;
+	}
+	uint32_t size() const { return mSize; }
+	uint32_t capacity() const { return mCapacity; }
+	bool empty() const { return mSize == 0; }
+	void clear() { std::destroy(begin(), end()); mSize = 0; }
+	void reserve(uint32_t capacity) { if (capacity > mCapacity) Grow(capacity); }
+	T* data() { return IsInline() ? (T*)mInline : mPtr; }
+	const T* data() const { return IsInline() ? (const T*)mInline : mPtr; }
+	T& operator[](size_t i) { assert(i < mSize); return data()[i]; }
+	const T& operator[](size_t i) const { assert(i < mSize); return data()[i]; }
+	T* begin() { return data(); }
+	T* end() { return data() + mSize; }
+	const T* begin() const { return data(); }
+	const T* end() const { return data() + mSize; }
+	T& front() { return *data(); }
+	T& back() { return end()[-1]; }
+	void push_back(const T& v) { emplace_back(v); }
+	void push_back(T&& v) { emplace_back(std::move(v)); }
+	template<class... Args>
+	T& emplace_back(Args&&... args) {
+		if (mSize == mCapacity) {
+			// Construct first in case args reference an existing item
+			T item(std::forward<Args>(args)...);
+			Grow(mSize + 1);
+			return *new (data() + mSize++) T(std::move(item));
+		}
+		return *new (data() + mSize++) T(std::forward<Args>(args)...);
+	}
+	T pop_back() {
+		T item(std::move(back()));
+		std::destroy_at(&back());
+		--mSize;
+		return item;
+	}
+	std::span<T> span() { return std::span<T>(data(), mSize); }
+};
+
 struct ExpandableMemoryArena {
     struct Page {
         int mSize;
         int mConsumed;
         void* mData;
+        // Frames since this page was last used
+        int mIdleFrames = 0;
         Page(int capacity)
             : mSize(capacity), mConsumed(0)
         {
             mData = malloc(capacity);
         }
-        Page(Page&& o) : mSize(o.mSize), mConsumed(o.mConsumed), mData(o.mData) { o.mData = nullptr; }
+        Page(Page&& o) : mSize(o.mSize), mConsumed(o.mConsumed), mData(o.mData), mIdleFrames(o.mIdleFrames) { o.mData = nullptr; }
+        Page& operator=(Page&& o) {
+            std::swap(mSize, o.mSize);
+            std::swap(mConsumed, o.mConsumed);
+            std::swap(mData, o.mData);
+            std::swap(mIdleFrames, o.mIdleFrames);
+            return *this;
+        }
         ~Page() {
             if (mData != nullptr) free(mData);
         }
-        void* AttemptConsume(int size) {
-            if (mConsumed + size > mSize) return nullptr;
-            void* data = (uint8_t*)mData + mConsumed;
-            mConsumed += size;
-            return data;
+        void* AttemptConsume(int size, int alignment) {
+            // Align the address (malloc only guarantees 16 bytes)
+            uintptr_t begin = (uintptr_t)mData + mConsumed;
+            int offset = (int)(((begin + alignment - 1) & ~(uintptr_t)(alignment - 1)) - (uintptr_t)mData);
+            if (offset + size > mSize) return nullptr;
+            mConsumed = offset + size;
+            return (uint8_t*)mData + offset;
+        }
+    };
+    // Pages that can be shared between arenas (and threads)
+    struct PagePool {
+        std::mutex mMutex;
+        std::vector<Page> mPages;
+        Page Acquire(int size) {
+            {
+                std::scoped_lock lock(mMutex);
+                for (auto it = mPages.begin(); it != mPages.end(); ++it) {
+                    if (it->mSize < size) continue;
+                    Page page(std::move(*it));
+                    mPages.erase(it);
+                    page.mConsumed = 0;
+                    page.mIdleFrames = 0;
+                    return page;
+                }
+            }
+            return Page(size);
+        }
+        void Release(std::vector<Page>& pages) {
+            std::scoped_lock lock(mMutex);
+            for (auto& page : pages) mPages.emplace_back(std::move(page));
+            pages.clear();
+        }
+        // Free pages which have not been acquired for a number of frames
+        void Decay(int maxIdleFrames) {
+            std::scoped_lock lock(mMutex);
+            if (maxIdleFrames < 0) return;
+            std::erase_if(mPages, [&](auto& page) { return ++page.mIdleFrames > maxIdleFrames; });
+        }
+        int SumReservedMemory() {
+            std::scoped_lock lock(mMutex);
+            int mem = 0;
+            for (auto& page : mPages) mem += page.mSize;
+            return mem;
         }
     };
     std::vector<Page> mPages;
     int mActivePage;
-    ExpandableMemoryArena() {
+    // If set, pages are drawn from and returned to this pool
+    PagePool* mPool;
+    // Unused pages are freed after this many frames (-1 to never free)
+    int mDecayFrames;
+    ExpandableMemoryArena(PagePool* pool = nullptr) {
         mActivePage = 0;
+        mPool = pool;
+        mDecayFrames = 60;
         mPages.reserve(4);
     }
     void Clear() {
         mActivePage = 0;
-        for (auto& page : mPages) page.mConsumed = 0;
+        if (mPool != nullptr) mPool->Release(mPages);
+        for (auto& page : mPages) {
+            page.mIdleFrames = page.mConsumed == 0 ? page.mIdleFrames + 1 : 0;
+            page.mConsumed = 0;
+        }
+        // Release pages left over from a spike
+        if (mDecayFrames >= 0) {
+            std::erase_if(mPages, [&](auto& page) { return page.mIdleFrames > mDecayFrames; });
+        }
     }
-    void* Require(int size) {
+    void* Require(int size, int alignment = 8) {
         if (size <= 0) return nullptr;
+        assert((alignment & (alignment - 1)) == 0);
         const int DataAlignment = 8;
         size = (size + DataAlignment - 1) & ~(DataAlignment - 1);
         while (mActivePage < (int)mPages.size()) {
-            void* data = mPages[mActivePage].AttemptConsume(size);
+            void* data = mPages[mActivePage].AttemptConsume(size, alignment);
             if (data != nullptr) return data;
             ++mActivePage;
         }
         const int Alignment = 1024;
         const int MinimumPageSize = 1024 * 32;
-        int allocSize = size * 2;
-        allocSize = (allocSize + (Alignment - 1)) & (~Alignment);
+        int allocSize = (size + alignment) * 2;
+        allocSize = (allocSize + (Alignment - 1)) & ~(Alignment - 1);
         if (allocSize < MinimumPageSize) allocSize = MinimumPageSize;
-        mPages.emplace_back(allocSize);
-        void* data = mPages.back().AttemptConsume(size);
+        if (mPool != nullptr) mPages.emplace_back(mPool->Acquire(allocSize));
+        else mPages.emplace_back(allocSize);
+        void* data = mPages.back().AttemptConsume(size, alignment);
         return data;
     }
+    template<class T>
+    std::span<T> Require(int count, int alignment = (int)alignof(T)) {
+        return std::span<T>((T*)Require(count * (int)sizeof(T), std::max(alignment, 8)), count);
+    }
     int SumConsumedMemory() const {
         int mem = 0;
         for (auto& page : mPages) mem += page.mConsumed;
         return mem;
     }
+    int SumReservedMemory() const {
+        int mem = 0;
+        for (auto& page : mPages) mem += page.mSize;
+        return mem;
+    }
+};
+
+struct FrameDataStatistics {
+    int mConsumed;              // Bytes used so far this frame
+    int mLastFrameConsumed;     // Bytes used by the previous frame
+    int mHighWater;             // Most bytes used by any frame
+    int mReserved;              // Bytes held by arenas and the page pool
+};
+
+// Frame allocator which can be used from multiple threads without locking
+// Each thread bumps its own arena; pages come from a shared pool
+// and are all recycled by a single Clear() at frame reset
+// Up to MaxThreads may allocate at once; slots of exited threads are reused
+struct ThreadedMemoryArena {
+    static constexpr int MaxThreads = 64;
+    struct ThreadArena {
+        ExpandableMemoryArena mArena;
+        int mHighWater = 0;
+    };
+    // Slot ownership outlives the arena, as exiting threads release their slot
+    struct ThreadSlots {
+        std::atomic<std::thread::id> mThreads[MaxThreads];
+    };
+    // Releases the calling thread's slots when it exits; the arena data is
+    // kept until the next Clear() and the slot is reused by a later thread
+    struct ThreadSlotRelease {
+        std::vector<std::pair<std::shared_ptr<ThreadSlots>, int>> mSlots;
+        ~ThreadSlotRelease() {
+            for (auto& [slots, slot] : mSlots) slots->mThreads[slot].store(std::thread::id());
+        }
+    };
+    ExpandableMemoryArena::PagePool mPool;
+    std::unique_ptr<ThreadArena[]> mThreads;
+    std::shared_ptr<ThreadSlots> mSlots;
+    std::atomic<int> mThreadCount;
+    int mHighWater;
+    int mLastFrameConsumed;
+    // Pool pages are freed after this many frames unused
+    int mDecayFrames;
+    ThreadedMemoryArena()
+        : mThreads(new ThreadArena[MaxThreads]), mSlots(std::make_shared<ThreadSlots>()), mThreadCount(0), mHighWater(0), mLastFrameConsumed(0), mDecayFrames(60)
+    {
+        for (int i = 0; i < MaxThreads; ++i) mThreads[i].mArena.mPool = &mPool;
+    }
+    // Find (or claim) the arena for the calling thread
+    ThreadArena& RequireThreadArena() {
+        static thread_local const ThreadedMemoryArena* tOwner = nullptr;
+        static thread_local int tSlot = -1;
+        static thread_local ThreadSlotRelease tRelease;
+        auto threadId = std::this_thread::get_id();
+        if (tOwner == this && mSlots->mThreads[tSlot].load(std::memory_order_relaxed) == threadId)
+            return mThreads[tSlot];
+        int count = std::min(mThreadCount.load(), MaxThreads);
+        int slot = 0;
+        for (; slot < count; ++slot) {
+            if (mSlots->mThreads[slot].load() == threadId) break;
+        }
+        if (slot == count) {
+            // Reuse a slot released by a thread which has exited
+            for (slot = 0; slot < count; ++slot) {
+                auto empty = std::thread::id();
+                if (mSlots->mThreads[slot].compare_exchange_strong(empty, threadId)) break;
+            }
+            if (slot == count) {
+                // The new slot is visible to the reuse scan before it is
+                // written, so it must also be claimed; if taken, try the next
+                while (true) {
+                    slot = mThreadCount++;
+                    if (slot >= MaxThreads) throw "Too many threads writing frame data";
+                    auto empty = std::thread::id();
+                    if (mSlots->mThreads[slot].compare_exchange_strong(empty, threadId)) break;
+                }
+            }
+            tRelease.mSlots.push_back(std::make_pair(mSlots, slot));
+        }
+        tOwner = this;
+        tSlot = slot;
+        return mThreads[slot];
+    }
+    void* Require(int size, int alignment = 8) {
+        return RequireThreadArena().mArena.Require(size, alignment);
+    }
+    // Must not be called while other threads are allocating
+    void Clear() {
+        // Anything still in the pool went unused for this frame
+        mPool.Decay(mDecayFrames);
+        int total = 0;
+        int count = std::min(mThreadCount.load(), MaxThreads);
+        for (int i = 0; i < count; ++i) {
+            auto& thread = mThreads[i];
+            int consumed = thread.mArena.SumConsumedMemory();
+            thread.mHighWater = std::max(thread.mHighWater, consumed);
+            total += consumed;
+            thread.mArena.Clear();
+        }
+        mHighWater = std::max(mHighWater, total);
+        mLastFrameConsumed = total;
+    }
+    int SumConsumedMemory() const {
+        int mem = 0;
+        int count = std::min(mThreadCount.load(), MaxThreads);
+        for (int i = 0; i < count; ++i) mem += mThreads[i].mArena.SumConsumedMemory();
+        return mem;
+    }
+    int GetThreadCount() const { return std::min(mThreadCount.load(), MaxThreads); }
+    int GetThreadHighWater(int thread) const { return mThreads[thread].mHighWater; }
+    int GetHighWater() const { return mHighWater; }
+    FrameDataStatistics GetStatistics() {
+        int reserved = mPool.SumReservedMemory();
+        int count = GetThreadCount();
+        for (int i = 0; i < count; ++i) reserved += mThreads[i].mArena.SumReservedMemory();
+        int consumed = SumConsumedMemory();
+        return FrameDataStatistics{
+            .mConsumed = consumed,
+            .mLastFrameConsumed = mLastFrameConsumed,
+            .mHighWater = std::max(mHighWater, consumed),
+            .mReserved = reserved,
+        };
+    }
 };
 
+// Tracks unallocated index ranges
+// Ranges are ordered by start (for merging neighbours) and also
+// bucketed into two-level segregated size classes (TLSF), so that
+// Allocate/Return are O(log n) instead of scanning every range
 struct SparseIndices
 {
-    std::vector<RangeInt> mRanges;
+    struct FreeRange {
+        int mLength;
+        // Start of the previous/next range in the same size class
+        int mPrevFree = -1;
+        int mNextFree = -1;
+    };
+    // Each power-of-two size class is split into 4 linear bins
+    static const int SLBits = 2;
+    static const int SLCount = 1 << SLBits;
+    static const int FLCount = 32;
+
+    std::map<int, FreeRange> mRanges;
+    // Ranges are not merged across multiples of (1 << mBoundaryShift)
+    int mBoundaryShift = 31;
+    uint32_t mFLMask = 0;
+    uint8_t mSLMasks[FLCount] = { };
+    int mBinHeads[FLCount][SLCount];
+
+    SparseIndices() { std::fill(&mBinHeads[0][0], &mBinHeads[0][0] + FLCount * SLCount, -1); }
+
     int Allocate() { return Allocate(1).start; }
     RangeInt Allocate(int count) {
-        for (auto block = mRanges.begin(); block != mRanges.end(); ++block)
-        {
-            if (block->length < count) continue;
-            block->length -= count;
-            block->start += count;
-            RangeInt r(block->start - count, count);
-            if (block->length <= 0) block = mRanges.erase(block);
-            return r;
+        if (count <= 0) return RangeInt(-1, -1);
+        auto block = FindFree(count);
+        if (block == mRanges.end()) return RangeInt(-1, -1);
+        RemoveFree(block);
+        RangeInt r(block->first, count);
+        if (block->second.mLength == count) {
+            mRanges.erase(block);
+        }
+        else {
+            // Move the remainder to its new start and size class
+            auto node = mRanges.extract(block);
+            node.key() += count;
+            node.mapped().mLength -= count;
+            InsertFree(mRanges.insert(std::move(node)).position);
         }
-        return RangeInt(-1, -1);
+        return r;
     }
     void Return(RangeInt& range) {
         Return(range.start, range.length);
         range = RangeInt(0, 0);
     }
     void Return(int start, int count) {
-        if (mRanges.empty()) { mRanges.push_back(RangeInt(start, count)); return; }
-        auto it = std::partition_point(mRanges.begin(), mRanges.end(), [&](auto& item) {
-            return item.start < start;
-            });
-        if (it != mRanges.end()) {
-            if (it->start == start + count) {
-                it->start -= count;
-                it->length += count;
-                if (it != mRanges.begin()) AttemptMerge(it - 1);
-                return;
-            }
-        }
-        if (it != mRanges.begin()) {
-            auto p = it - 1;
-            if (p->end() == start) {
-                p->length += count;
-                if (it != mRanges.end()) AttemptMerge(p);
-                return;
+        if (count <= 0) return;
+        auto next = mRanges.lower_bound(start);
+        assert(next == mRanges.end() || next->first >= start + count);
+        assert((start >> mBoundaryShift) == ((start + count - 1) >> mBoundaryShift));
+        if (next != mRanges.begin()) {
+            auto prev = std::prev(next);
+            assert(prev->first + prev->second.mLength <= start);
+            if (prev->first + prev->second.mLength == start && (prev->first >> mBoundaryShift) == (start >> mBoundaryShift)) {
+                RemoveFree(prev);
+                start = prev->first;
+                count += prev->second.mLength;
+                mRanges.erase(prev);
             }
         }
-        /*int end = start + count;
-        auto block = mRanges.rbegin();
-        for (; block != mRanges.rend(); block++)
-        {
-            // Merge at end of block
-            if (block->end() == start)
-            {
-                block->length += count;
-                if (block + 1 != mRanges.rend()) AttemptMerge(block.base());
-                return;
-            }
-            // Merge at start of block
-            if (block->start == (start + count))
-            {
-                block->start -= count; block->length += count;
-                if (block != mRanges.rbegin()) AttemptMerge((block - 1).base());
-                return;
-            }
-            // Block is prior to new range, insert new range
-            if (block->start <= end) break;
+        if (next != mRanges.end() && next->first == start + count && (next->first >> mBoundaryShift) == (start >> mBoundaryShift)) {
+            RemoveFree(next);
+            count += next->second.mLength;
+            next = mRanges.erase(next);
         }
-        //--block;*/
-        mRanges.insert(it, RangeInt(start, count));
+        InsertFree(mRanges.emplace_hint(next, start, FreeRange{ count }));
+    }
+    // Returns the start of the unallocated range containing index, or -1
+    int Find(int index) const {
+        auto it = mRanges.upper_bound(index);
+        if (it == mRanges.begin()) return -1;
+        --it;
+        return index < it->first + it->second.mLength ? it->first : -1;
     }
-    int Find(int index) {
-        int min = 0, max = (int)mRanges.size() - 1;
-        while (max >= min) {
-            int mid = (min + max) / 2;
-            auto value = mRanges[mid];
-            if (index < value.start) max = mid - 1;
-            else if (index >= value.end()) min = mid + 1;
-            else return mid;
+    // Mark a specific unallocated range as allocated (if it is entirely free)
+    bool Consume(RangeInt range) {
+        if (range.length <= 0) return true;
+        int start = Find(range.start);
+        if (start == -1) return false;
+        auto block = mRanges.find(start);
+        int blockEnd = block->first + block->second.mLength;
+        if (range.end() > blockEnd) return false;
+        RemoveFree(block);
+        if (range.start > start) {
+            block->second.mLength = range.start - start;
+            InsertFree(block);
         }
-        return -1;
+        else {
+            mRanges.erase(block);
+        }
+        if (range.end() < blockEnd) {
+            InsertFree(mRanges.emplace(range.end(), FreeRange{ blockEnd - range.end() }).first);
+        }
+        return true;
     }
     int Compact(int from) {
-        if (mRanges.size() == 0) return 0;
-        auto back = mRanges.back();
-        if (back.end() != from) return 0;
-        mRanges.erase(mRanges.end() - 1);
-        return back.length;
+        if (mRanges.empty()) return 0;
+        auto back = std::prev(mRanges.end());
+        int length = back->second.mLength;
+        if (back->first + length != from) return 0;
+        RemoveFree(back);
+        mRanges.erase(back);
+        return length;
+    }
+    bool Contains(int index) const { return Find(index) != -1; }
+    // Fragmentation metrics
+    int GetFreeRangeCount() const { return (int)mRanges.size(); }
+    int GetLargestFreeRange() const {
+        if (mFLMask == 0) return 0;
+        int fl = 31 - std::countl_zero(mFLMask);
+        int largest = 0;
+        for (int sl = 0; sl < SLCount; ++sl) {
+            for (int start = mBinHeads[fl][sl]; start != -1; ) {
+                auto& block = mRanges.find(start)->second;
+                largest = std::max(largest, block.mLength);
+                start = block.mNextFree;
+            }
+        }
+        return largest;
     }
-    bool Contains(int index) { return Find(index) != -1; }
     struct Iterator {
         SparseIndices& mIndices;
-        int mUnallocIndex;
+        std::map<int, FreeRange>::const_iterator mUnused;
         int mCurrent;
         Iterator(SparseIndices& inds)
             : mIndices(inds)
         {
-            mUnallocIndex = 0;
+            mUnused = mIndices.mRanges.begin();
             mCurrent = -1;
             ++*this;
         }
         Iterator& operator ++() {
             ++mCurrent;
-            if (mUnallocIndex < mIndices.mRanges.size()) {
-                auto unused = mIndices.mRanges[mUnallocIndex];
-                if (mCurrent >= unused.start) {
-                    mCurrent += unused.length;
-                    ++mUnallocIndex;
+            if (mUnused != mIndices.mRanges.end()) {
+                if (mCurrent >= mUnused->first) {
+                    mCurrent += mUnused->second.mLength;
+                    ++mUnused;
                 }
             }
             return *this;
@@ -235,16 +578,68 @@ struct SparseIndices
     };
 
     Iterator begin() { return Iterator(*this); }
-    Iterator end() { Iterator it(*this); it.mCurrent = mRanges.back().end(); return it; }
+    Iterator end() {
+        Iterator it(*this);
+        if (!mRanges.empty()) it.mCurrent = mRanges.rbegin()->first + mRanges.rbegin()->second.mLength;
+        return it;
+    }
 private:
-    bool AttemptMerge(std::vector<RangeInt>::iterator it)
-    {
-        auto p0 = it;
-        auto p1 = it + 1;
-        if (p0->end() != p1->start) return false;
-        p0->length += p1->length;
-        mRanges.erase(p1);
-        return true;
+    // Map a size to its (first level, second level) bin
+    static void GetBin(uint32_t size, int& fl, int& sl) {
+        if (size < SLCount) { fl = 0; sl = (int)size; return; }
+        int log2 = (int)std::bit_width(size) - 1;
+        sl = (int)(size >> (log2 - SLBits)) & (SLCount - 1);
+        fl = log2 - SLBits + 1;
+    }
+    std::map<int, FreeRange>::iterator FindFree(int count) {
+        // Round up so that any range in the found bin is large enough
+        uint32_t size = (uint32_t)count;
+        if (size >= SLCount) size += (1u << (std::bit_width(size) - 1 - SLBits)) - 1;
+        int fl, sl;
+        GetBin(size, fl, sl);
+        if (fl < FLCount) {
+            uint32_t slMask = mSLMasks[fl] & (~0u << sl);
+            if (slMask == 0) {
+                uint32_t flMask = fl + 1 < FLCount ? mFLMask & (~0u << (fl + 1)) : 0;
+                if (flMask != 0) {
+                    fl = std::countr_zero(flMask);
+                    slMask = mSLMasks[fl];
+                }
+            }
+            if (slMask != 0) return mRanges.find(mBinHeads[fl][std::countr_zero(slMask)]);
+        }
+        // Ranges sharing the requested bin might still fit
+        GetBin((uint32_t)count, fl, sl);
+        for (int start = mBinHeads[fl][sl]; start != -1; ) {
+            auto block = mRanges.find(start);
+            if (block->second.mLength >= count) return block;
+            start = block->second.mNextFree;
+        }
+        return mRanges.end();
+    }
+    void InsertFree(std::map<int, FreeRange>::iterator block) {
+        int fl, sl;
+        GetBin((uint32_t)block->second.mLength, fl, sl);
+        int& head = mBinHeads[fl][sl];
+        block->second.mPrevFree = -1;
+        block->second.mNextFree = head;
+        if (head != -1) mRanges.find(head)->second.mPrevFree = block->first;
+        head = block->first;
+        mFLMask |= 1u << fl;
+        mSLMasks[fl] |= 1u << sl;
+    }
+    void RemoveFree(std::map<int, FreeRange>::iterator block) {
+        int fl, sl;
+        GetBin((uint32_t)block->second.mLength, fl, sl);
+        auto& range = block->second;
+        if (range.mPrevFree != -1) mRanges.find(range.mPrevFree)->second.mNextFree = range.mNextFree;
+        else mBinHeads[fl][sl] = range.mNextFree;
+        if (range.mNextFree != -1) mRanges.find(range.mNextFree)->second.mPrevFree = range.mPrevFree;
+        range.mPrevFree = range.mNextFree = -1;
+        if (mBinHeads[fl][sl] == -1) {
+            mSLMasks[fl] &= ~(1u << sl);
+            if (mSLMasks[fl] == 0) mFLMask &= ~(1u << fl);
+        }
     }
 };
 
@@ -312,18 +707,13 @@ struct SparseArray
     {
         if (newCount < range.length)
         {
-            mUnused.Return(RangeInt(range.start + newCount, range.length - newCount));
+            mUnused.Return(range.start + newCount, range.length - newCount);
             range.length = newCount;
             return;
         }
         // Attempt to consume free adjacent blocks if available
-        int nextRangeId = mUnused.Find(range.end());
-        if (nextRangeId >= 0 && range.length + mUnused.mRanges[nextRangeId].length >= newCount)
+        if (mUnused.Consume(RangeInt(range.end(), newCount - range.length)))
         {
-            int takeCount = newCount - range.length;
-            auto& nextRange = mUnused.mRanges[nextRangeId];
-            nextRange.length -= takeCount;
-            nextRange.start += takeCount;
             range.length = newCount;
             return;
         }
@@ -331,11 +721,14 @@ struct SparseArray
         auto ogRange = range;
         mUnused.Return(range);
         range = Allocate(newCount);
-        if (range.start != ogRange.start)
+        if (range.start < ogRange.start)
         {
-            std::memcpy(mItems.begin() + range.start, mItems.begin() + ogRange.start, sizeof(T) * ogRange.length);
+            std::move(mItems.begin() + ogRange.start, mItems.begin() + ogRange.end(), mItems.begin() + range.start);
+        }
+        else if (range.start > ogRange.start)
+        {
+            std::move_backward(mItems.begin() + ogRange.start, mItems.begin() + ogRange.end(), mItems.begin() + range.start + ogRange.length);
         }
-        return range;
     }
 
     struct Iterator
@@ -374,3 +767,160 @@ struct SparseArray
         return it;
     }
 };
+
+// SparseArray variant which stores items in fixed size pages
+// Growing never relocates items (pointers remain stable) and each page
+// tracks occupancy in 64-bit masks so iteration can skip empty regions
+// Ranges never span pages, so PageShift must fit the largest range
+template<class T, int PageShift = 6>
+struct ChunkedSparseArray
+{
+    static const int PageSize = 1 << PageShift;
+    static const int PageMask = PageSize - 1;
+    static const int MaskWords = (PageSize + 63) / 64;
+    struct Page {
+        uint64_t mOccupied[MaskWords] = { };
+        T mItems[PageSize];
+    };
+    SparseIndices mUnused;
+    std::vector<std::unique_ptr<Page>> mPages;
+    ChunkedSparseArray() { mUnused.mBoundaryShift = PageShift; }
+
+    T& operator[](int i) { return mPages[i >> PageShift]->mItems[i & PageMask]; }
+    const T& operator[](int i) const { return mPages[i >> PageShift]->mItems[i & PageMask]; }
+    std::span<T> operator[](RangeInt i) { return std::span<T>(&(*this)[i.start], i.length); }
+    std::span<const T> operator[](RangeInt i) const { return std::span<const T>(&(*this)[i.start], i.length); }
+    int GetCapacity() const { return (int)mPages.size() << PageShift; }
+    bool IsOccupied(int i) const { return (mPages[i >> PageShift]->mOccupied[(i & PageMask) >> 6] & (1ull << (i & 63))) != 0; }
+
+    int Allocate() { return Allocate(1).start; }
+    RangeInt Allocate(int count)
+    {
+        if (count == 0) return { };
+        // A range must fit within one page, so no page could ever satisfy this
+        if (count > PageSize) throw "ChunkedSparseArray allocation is larger than a page";
+        while (true)
+        {
+            auto range = mUnused.Allocate(count);
+            if (range.start >= 0) return SetOccupied(range, true);
+            AppendPage();
+        }
+    }
+    int Add(const T& value) {
+        int id = Allocate();
+        (*this)[id] = value;
+        return id;
+    }
+    int Add(T&& value) {
+        int id = Allocate();
+        (*this)[id] = std::move(value);
+        return id;
+    }
+    template<class O>
+    RangeInt AddRange(const O& arr)
+    {
+        auto range = Allocate((int)arr.size());
+        int i = range.start;
+        for (auto it = arr.begin(); it != arr.end(); ++it) (*this)[i++] = *it;
+        return range;
+    }
+    void Return(int id)
+    {
+        RangeInt range(id, 1);
+        Return(range);
+    }
+    void Return(RangeInt& range)
+    {
+        if (range.length <= 0) return;
+        SetOccupied(range, false);
+        mUnused.Return(range);
+        range = { };
+    }
+    void Reallocate(RangeInt& range, int newCount)
+    {
+        if (newCount > PageSize) throw "ChunkedSparseArray allocation is larger than a page";
+        if (newCount == range.length) return;
+        if (newCount < range.length)
+        {
+            RangeInt tail(range.start + newCount, range.length - newCount);
+            SetOccupied(tail, false);
+            mUnused.Return(tail.start, tail.length);
+            range.length = newCount;
+            return;
+        }
+        // Grow in place if the following items are free and in the same page
+        RangeInt extra(range.end(), newCount - range.length);
+        if (range.length > 0 && (range.start >> PageShift) == ((extra.end() - 1) >> PageShift) && mUnused.Consume(extra))
+        {
+            SetOccupied(extra, true);
+            range.length = newCount;
+            return;
+        }
+        // Otherwise move to a new range (possibly in another page)
+        auto newRange = Allocate(newCount);
+        for (int i = 0; i < range.length; ++i)
+            (*this)[newRange.start + i] = std::move((*this)[range.start + i]);
+        Return(range);
+        range = newRange;
+    }
+
+    struct Iterator
+    {
+        ChunkedSparseArray& mArray;
+        int mPage;
+        int mWord;
+        uint64_t mRemaining;
+        Iterator(ChunkedSparseArray& arr, int page)
+            : mArray(arr), mPage(page), mWord(0), mRemaining(0)
+        {
+            if (mPage < (int)mArray.mPages.size()) mRemaining = mArray.mPages[mPage]->mOccupied[0];
+            SkipEmpty();
+        }
+        void SkipEmpty()
+        {
+            while (mRemaining == 0 && mPage < (int)mArray.mPages.size())
+            {
+                if (++mWord == MaskWords) { mWord = 0; ++mPage; }
+                if (mPage < (int)mArray.mPages.size()) mRemaining = mArray.mPages[mPage]->mOccupied[mWord];
+            }
+        }
+        int GetIndex() const { return (mPage << PageShift) + (mWord << 6) + std::countr_zero(mRemaining); }
+        T& operator *() const
+        {
+            return mArray.mPages[mPage]->mItems[(mWord << 6) + std::countr_zero(mRemaining)];
+        }
+        T* operator ->() const { return &**this; }
+        Iterator& operator ++()
+        {
+            mRemaining &= mRemaining - 1;
+            SkipEmpty();
+            return *this;
+        }
+        bool operator ==(const Iterator& other) const
+        {
+            return mPage == other.mPage && mWord == other.mWord && mRemaining == other.mRemaining;
+        }
+    };
+    Iterator begin() { return Iterator(*this, 0); }
+    Iterator end() { return Iterator(*this, (int)mPages.size()); }
+private:
+    void AppendPage()
+    {
+        int pageStart = GetCapacity();
+        mPages.push_back(std::make_unique<Page>());
+        mUnused.Return(pageStart, PageSize);
+    }
+    RangeInt SetOccupied(RangeInt range, bool occupied)
+    {
+        auto& page = *mPages[range.start >> PageShift];
+        for (int i = range.start & PageMask, end = i + range.length; i < end; ) {
+            int bit = i & 63;
+            int count = std::min(64 - bit, end - i);
+            uint64_t bits = (count >= 64 ? ~0ull : ((1ull << count) - 1)) << bit;
+            if (occupied) page.mOccupied[i >> 6] |= bits;
+            else page.mOccupied[i >> 6] &= ~bits;
+            i += count;
+        }
+        return range;
+    }
+};
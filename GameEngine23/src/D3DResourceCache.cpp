@@ -362,7 +362,8 @@ D3DResourceCache::D3DBinding& D3DResourceCache::RequireBinding(const BufferLayou
 void D3DResourceCache::UpdateBufferData(D3DCommandContext& cmdList, const BufferLayout& binding, std::span<const RangeInt> ranges) {
     auto& d3dBin = RequireBinding(binding);
     bool fullRefresh = false;
-    if (RequireBuffer(binding, d3dBin, cmdList.mLockBits) && binding.mRevision != -1) {
+    bool recreated = RequireBuffer(binding, d3dBin, cmdList.mLockBits);
+    if (recreated && binding.mRevision != -1) {
         fullRefresh = true;
     }
     // Special case - update full buffer if revision mismatch
@@ -370,6 +371,7 @@ void D3DResourceCache::UpdateBufferData(D3DCommandContext& cmdList, const Buffer
         if (d3dBin.mRevision == binding.mRevision) return;
         fullRefresh = true;
     }
+    int previousRevision = d3dBin.mRevision;
     d3dBin.mRevision = binding.mRevision;
     if (fullRefresh) {
         ProcessBindings(binding, d3dBin,
@@ -378,6 +380,9 @@ void D3DResourceCache::UpdateBufferData(D3DCommandContext& cmdList, const Buffer
                 // TODO: Support multiple null elements?
                 if (binding.mElementCount == 1 && binding.mElements->mData == nullptr)
                     return;
+                // Buffer still has older data, only upload what changed
+                if (!recreated && CopyChangedBufferData(cmdList, binding, d3dBin, itemSize, previousRevision))
+                    return;
                 CopyBufferData(cmdList, binding, d3dBin, itemSize, 0, binding.mSize);
             },
             [&](const BufferLayout& binding, D3DBinding& d3dBin, int itemSize) {},
@@ -390,33 +395,50 @@ void D3DResourceCache::UpdateBufferData(D3DCommandContext& cmdList, const Buffer
     if (totalCount == 0) return;
     ProcessBindings(binding, d3dBin,
         [&](const BufferLayout& binding, D3DBinding& d3dBin, int itemSize) {
-            // Map and fill the buffer data (via temporary upload buffer)
-            ID3D12Resource* uploadBuffer = AllocateUploadBuffer(totalCount, cmdList.mLockBits);
-            UINT8* mappedData;
-            CD3DX12_RANGE readRange(0, 0);
-            ThrowIfFailed(uploadBuffer->Map(0, &readRange, (void**)&mappedData));
-            int it = 0;
-            for (auto& range : ranges) {
-                D3D::WriteBufferData(mappedData + it, binding, itemSize, range.start, range.length);
-                it += range.length;
-            }
-            uploadBuffer->Unmap(0, nullptr);
-            RequireState(cmdList, d3dBin, binding, D3D12_RESOURCE_STATE_COPY_DEST);
-            FlushBarriers(cmdList);
-
-            it = 0;
-            for (auto& range : ranges) {
-                cmdList->CopyBufferRegion(d3dBin.mBuffer.Get(), range.start,
-                    uploadBuffer, it, range.length);
-                it += range.length;
-                mStatistics.BufferWrite(ranges.size());
-            }
+            CopyBufferRanges(cmdList, binding, d3dBin, itemSize, ranges);
         },
         [&](const BufferLayout& binding, D3DBinding& d3dBin, int itemSize) {},
         [&](const BufferLayout& binding, const BufferLayout::Element& element, UINT offset, D3D12_INPUT_CLASSIFICATION classification) {},
         [&](const BufferLayout& binding, D3DBinding& d3dBin, int itemSize) {}
     );
 }
+void D3DResourceCache::CopyBufferRanges(D3DCommandContext& cmdList, const BufferLayout& binding, D3DBinding& d3dBin, int itemSize, std::span<const RangeInt> byteRanges) {
+    int totalCount = std::accumulate(byteRanges.begin(), byteRanges.end(), 0, [](int counter, RangeInt range) { return counter + range.length; });
+    if (totalCount == 0) return;
+    // Map and fill the buffer data (via temporary upload buffer)
+    ID3D12Resource* uploadBuffer = AllocateUploadBuffer(totalCount, cmdList.mLockBits);
+    UINT8* mappedData;
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(uploadBuffer->Map(0, &readRange, (void**)&mappedData));
+    auto& copyPlan = d3dBin.mCopyPlan.Require(binding, itemSize);
+    int it = 0;
+    for (auto& range : byteRanges) {
+        D3D::WriteBufferData(mappedData + it, binding, copyPlan, range.start, range.length);
+        it += range.length;
+    }
+    uploadBuffer->Unmap(0, nullptr);
+    RequireState(cmdList, d3dBin, binding, D3D12_RESOURCE_STATE_COPY_DEST);
+    FlushBarriers(cmdList);
+
+    it = 0;
+    for (auto& range : byteRanges) {
+        cmdList->CopyBufferRegion(d3dBin.mBuffer.Get(), range.start,
+            uploadBuffer, it, range.length);
+        it += range.length;
+        mStatistics.BufferWrite(range.length);
+    }
+}
+bool D3DResourceCache::CopyChangedBufferData(D3DCommandContext& cmdList, const BufferLayout& binding, D3DBinding& d3dBin, int itemSize, int sinceRevision) {
+    if (sinceRevision < 0 || itemSize <= 0) return false;
+    GraphicsBufferDelta delta;
+    if (!binding.GetChangesSince(sinceRevision, delta)) return false;
+    // Change log is in items, upload ranges are in bytes
+    auto regions = delta.GetRegions();
+    for (auto& region : regions) region = RangeInt(region.start * itemSize, region.length * itemSize);
+    CopyBufferRanges(cmdList, binding, d3dBin, itemSize, regions);
+    d3dBin.mRevision = binding.mRevision;
+    return true;
+}
 void D3DResourceCache::CopyBufferData(D3DCommandContext& cmdList, const BufferLayout& source, const BufferLayout& dest, int srcOffset, int dstOffset, int length) {
     auto& srcBinding = RequireBinding(source);
     auto& dstBinding = RequireBinding(dest);
@@ -684,26 +706,44 @@ void D3DResourceCache::UpdateTextureData(D3DTexture* d3dTex, const Texture& tex,
         cmdList->ResourceBarrier(1, &beginWrite);
     }
 
-    auto uploadSize = (GetRequiredIntermediateSize(d3dTex->mBuffer.Get(), 0, 1) + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) & ~(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1);
-    auto blockSize = BufferFormatType::GetCompressedBlockSize(tex.GetBufferFormat());
-    if (blockSize < 0) blockSize = 1;
-    auto blockBytes = bitsPerPixel * blockSize * blockSize / 8;
-
-    for (int i = 0; i < tex.GetArrayCount(); ++i) {
-        for (int m = 0; m < tex.GetMipCount(); ++m) {
-            auto res = tex.GetMipResolution(size, tex.GetBufferFormat(), m);
-            auto srcData = tex.GetData(m, i);
-            D3D12_SUBRESOURCE_DATA textureData = {};
-            textureData.pData = reinterpret_cast<const UINT8*>(srcData.data());
-            textureData.RowPitch = blockBytes * res.x / blockSize;
-            textureData.SlicePitch = textureData.RowPitch * res.y / blockSize;
-            auto uploadBuffer = AllocateUploadBuffer(uploadSize, cmdList.mLockBits);
-            UpdateSubresources<1>(cmdList, d3dTex->mBuffer.Get(), uploadBuffer, 0,
-                D3D12CalcSubresource(m, i, 0, tex.GetMipCount(), tex.GetArrayCount()), 1,
-                &textureData);
-            mStatistics.BufferWrite(uploadSize);
+    // Every subresource goes into one upload buffer, placed by the
+    // texture's upload layout (so no footprint queries are needed)
+    auto fmt = tex.GetBufferFormat();
+    auto blockSize = std::max(BufferFormatType::GetCompressedBlockSize(fmt), 1);
+    auto& layout = tex.GetLayout();
+    auto& uploadLayout = tex.GetUploadLayout();
+    auto srcData = tex.GetData(-1, -1);
+    auto uploadBuffer = AllocateUploadBuffer(uploadLayout.mSize, cmdList.mLockBits);
+    D3D::FillBuffer(uploadBuffer, [&](uint8_t* data) {
+        for (size_t s = 0; s < layout.mSubresources.size(); ++s) {
+            auto& src = layout.mSubresources[s];
+            auto& dst = uploadLayout.mSubresources[s];
+            // Rows already meeting the pitch alignment copy in one block
+            if (src.mRowPitch == dst.mRowPitch) {
+                std::memcpy(data + dst.mOffset, srcData.data() + src.mOffset, src.mSize);
+                continue;
+            }
+            for (uint32_t r = 0; r < src.mRowCount * src.mDepth; ++r) {
+                std::memcpy(data + dst.mOffset + r * dst.mRowPitch, srcData.data() + src.mOffset + r * src.mRowPitch, src.mRowPitch);
+            }
         }
+    });
+    // Subresources are ordered as D3D12CalcSubresource
+    for (int s = 0; s < (int)uploadLayout.mSubresources.size(); ++s) {
+        auto& dst = uploadLayout.mSubresources[s];
+        auto res = tex.GetMipResolution(size, fmt, s % tex.GetMipCount());
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = { dst.mOffset, {
+            (DXGI_FORMAT)fmt,
+            // Compressed footprints cover whole blocks
+            (UINT)((res.x + blockSize - 1) / blockSize * blockSize),
+            (UINT)((res.y + blockSize - 1) / blockSize * blockSize),
+            (UINT)res.z, dst.mRowPitch,
+        } };
+        CD3DX12_TEXTURE_COPY_LOCATION srcLocation(uploadBuffer, footprint);
+        CD3DX12_TEXTURE_COPY_LOCATION dstLocation(d3dTex->mBuffer.Get(), (UINT)s);
+        cmdList->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
     }
+    mStatistics.BufferWrite(uploadLayout.mSize);
 
     cmdList.mBarrierStateManager->mDelayedBarriers.push_back(
         CD3DX12_RESOURCE_BARRIER::Transition(d3dTex->mBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
@@ -755,7 +795,8 @@ void D3DResourceCache::CopyBufferData(D3DCommandContext& cmdList, const BufferLa
     int size = (byteSize + BufferAlignment) & ~BufferAlignment;
     // Map and fill the buffer data (via temporary upload buffer)
     ID3D12Resource* uploadBuffer = AllocateUploadBuffer(size, cmdList.mLockBits);
-    D3D::FillBuffer(uploadBuffer, [&](uint8_t* data) { D3D::WriteBufferData(data, binding, itemSize, byteOffset, byteSize); });
+    auto& copyPlan = d3dBin.mCopyPlan.Require(binding, itemSize);
+    D3D::FillBuffer(uploadBuffer, [&](uint8_t* data) { D3D::WriteBufferData(data, binding, copyPlan, byteOffset, byteSize); });
     cmdList->CopyBufferRegion(d3dBin.mBuffer.Get(), byteOffset, uploadBuffer, 0, size);
     mStatistics.BufferWrite(size);
     d3dBin.mRevision = binding.mRevision;
@@ -786,9 +827,10 @@ void D3DResourceCache::ComputeElementData(std::span<const BufferLayout*> binding
     indexCount = -1;
     ProcessBindings(bindings, mBindings,
         [&](const BufferLayout& binding, D3DBinding& d3dBin, int itemSize) {
-            RequireBuffer(binding, d3dBin, cmdList.mLockBits);
+            bool recreated = RequireBuffer(binding, d3dBin, cmdList.mLockBits);
             if (d3dBin.mRevision != binding.mRevision) {
-                CopyBufferData(cmdList, binding, d3dBin, itemSize, 0, binding.mSize);
+                if (recreated || !CopyChangedBufferData(cmdList, binding, d3dBin, itemSize, d3dBin.mRevision))
+                    CopyBufferData(cmdList, binding, d3dBin, itemSize, 0, binding.mSize);
             }
             RequireState(cmdList, d3dBin, binding,
                 binding.mUsage == BufferLayout::Usage::Index ? D3D12_RESOURCE_STATE_INDEX_BUFFER : D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
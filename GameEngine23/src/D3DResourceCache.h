@@ -99,6 +99,7 @@ public:
         int mStride;
         int mCount;     // -1 for Append/Consume (count prefixed within buffer)
         D3D12_RESOURCE_STATES mState;
+        BufferCopyPlan mCopyPlan;   // How to interleave elements when uploading
     };
 
     struct CommandAllocator {
@@ -221,6 +222,9 @@ public:
     void ComputeElementLayout(std::span<const BufferLayout*> bindings,
         std::vector<D3D12_INPUT_ELEMENT_DESC>& inputElements);
     void CopyBufferData(D3DCommandContext& cmdList, const BufferLayout& binding, D3DBinding& d3dBin, int itemSize, int byteOffset, int byteSize);
+    void CopyBufferRanges(D3DCommandContext& cmdList, const BufferLayout& binding, D3DBinding& d3dBin, int itemSize, std::span<const RangeInt> byteRanges);
+    // Upload only the items changed since the last upload (false if a full copy is required)
+    bool CopyChangedBufferData(D3DCommandContext& cmdList, const BufferLayout& binding, D3DBinding& d3dBin, int itemSize, int sinceRevision);
     void ComputeElementData(std::span<const BufferLayout*> bindings,
         D3DCommandContext& cmdList,
         std::vector<D3D12_VERTEX_BUFFER_VIEW>& inputViews,
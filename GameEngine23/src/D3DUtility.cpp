@@ -13,19 +13,14 @@ namespace D3D {
             memcpy(data, (uint8_t*)binding.GetElements()[0].mData + byteOffset, byteSize);
             return;
         }
-        int count = byteSize / itemSize;
-        int toffset = 0;
-        for (auto& element : binding.GetElements()) {
-            auto elItemSize = element.GetItemByteSize();
-            auto* dstData = data + toffset;
-            auto* srcData = (uint8_t*)element.mData + byteOffset;
-            for (int s = 0; s < count; ++s) {
-                memcpy(dstData, srcData, elItemSize);
-                dstData += itemSize;
-                srcData += element.mBufferStride;
-            }
-            toffset += elItemSize;
+        BufferCopyPlan(binding, itemSize).Write(data, binding, byteOffset, byteSize);
+    }
+    void WriteBufferData(uint8_t* data, const BufferLayout& binding, const BufferCopyPlan& plan, int byteOffset, int byteSize) {
+        if (plan.mItemSize <= 0) {
+            memcpy(data, (uint8_t*)binding.GetElements()[0].mData + byteOffset, byteSize);
+            return;
         }
+        plan.Write(data, binding, byteOffset, byteSize);
     }
 
     const BarrierHandle BarrierHandle::Invalid(-1);
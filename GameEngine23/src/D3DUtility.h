@@ -4,6 +4,7 @@
 
 #include "D3DGraphicsDevice.h"
 #include "Buffer.h"
+#include "BufferCopyPlan.h"
 
 #include <vector>
 #include <unordered_map>
@@ -17,6 +18,8 @@ namespace D3D {
     extern D3D12_HEAP_PROPERTIES ReadbackHeap;
 
     void WriteBufferData(uint8_t* data, const BufferLayout& binding, int itemSize, int byteOffset, int byteSize);
+    // Use a cached plan to interleave multi-element layouts
+    void WriteBufferData(uint8_t* data, const BufferLayout& binding, const BufferCopyPlan& plan, int byteOffset, int byteSize);
 
     template<class F2>
     static void FillBuffer(ID3D12Resource* uploadBuffer, const F2& fillBuffer) {
@@ -5,63 +5,50 @@
 
 #include "ResourceLoader.h"
 #include "Material.h"
+#include "MeshSimplifier.h"
 
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <execution>
+#include <numeric>
+#include <map>
+#include <functional>
+#include <limits>
+#include <cmath>
 
-// Load FBX data and convert it to the internal engine representation of a Model
-std::shared_ptr<Model> FBXImport::ImportAsModel(const std::wstring& filename)
-{
-
-	// Read file data
-	std::ifstream file(filename, std::ios::binary);
-	if (!file) throw "Failed to open file";
-	file.seekg(0, std::ios::end);
-	auto filesize = file.tellg();
-	file.seekg(0, std::ios::beg);
-
-	std::vector<ofbx::u8> contents(filesize, '\0');
-	if (!file.read((char*)contents.data(), filesize)) throw "Failed to read file contents";
-
-	// Load FBX contents
-	ofbx::LoadFlags flags =
-		ofbx::LoadFlags::TRIANGULATE |
-		ofbx::LoadFlags::IGNORE_BLEND_SHAPES |
-		ofbx::LoadFlags::IGNORE_CAMERAS |
-		ofbx::LoadFlags::IGNORE_LIGHTS |
-		ofbx::LoadFlags::IGNORE_VIDEOS |
-		ofbx::LoadFlags::IGNORE_LIMBS;
+extern "C" {
+	__declspec(dllimport) void __stdcall OutputDebugStringA(const char* lpOutputString);
+}
 
-	auto fbxScene = ofbx::load(contents.data(), (int)contents.size(), (ofbx::u16)flags);
+namespace {
+	// Lets ofbx parse geometry on worker threads
+	void ParallelJobProcessor(ofbx::JobFunction fn, void*, void* data, ofbx::u32 size, ofbx::u32 count) {
+		std::vector<ofbx::u32> jobs(count);
+		std::iota(jobs.begin(), jobs.end(), 0);
+		std::for_each(std::execution::par, jobs.begin(), jobs.end(), [&](ofbx::u32 job) {
+			fn((ofbx::u8*)data + (size_t)job * size);
+		});
+	}
 
-	for (int i = 0; i < fbxScene->getAnimationStackCount(); ++i)
-	{
-		auto* fbxAnimStack = fbxScene->getAnimationStack(i);
-		auto* fbxLayer = fbxAnimStack->getLayer(0);
-		auto* fbxNode = fbxLayer->getCurveNode(0);
+	Matrix ToMatrix(const ofbx::Matrix& fbxXForm) {
+		Matrix xform;
+		std::transform(fbxXForm.m, fbxXForm.m + 16, (float*)&xform, [](const auto item) { return (float)item; });
+		return xform;
 	}
 
-	// The model that will be returned
-	auto outModel = std::make_shared<Model>();
-	// FBX is in cm; this engine units are meters
-	auto scaleFactor = fbxScene->getGlobalSettings()->UnitScaleFactor / 100.0f;
+	using JointMap = std::map<const ofbx::Object*, int>;
 
-	int meshCount = fbxScene->getMeshCount();
-	for (int i = 0; i < meshCount; ++i) {
-		auto fbxMesh = fbxScene->getMesh(i);
+	// Convert one FBX mesh (without materials) with xform baked into its
+	// vertices; safe to call concurrently
+	std::shared_ptr<Mesh> ConvertMesh(const ofbx::Mesh* fbxMesh, const Matrix& xform, bool flip,
+		const JointMap* jointIds, const FBXImport::ImportSettings& settings) {
 		auto fbxMeshGeo = fbxMesh->getGeometry();
 
 		auto mesh = std::make_shared<Mesh>(fbxMesh->name);
 		auto vertCount = fbxMeshGeo->getVertexCount();
 		auto indCount = fbxMeshGeo->getIndexCount();
 
-		// Grab the mesh transform (TODO: Do not bake into meshes)
-		auto fbxXForm = fbxMesh->getGlobalTransform();
-		Matrix xform;
-		std::transform(fbxXForm.m, fbxXForm.m + 16, (float*)&xform, [](const auto item) { return (float)item; });
-		xform *= Matrix::CreateScale(scaleFactor);
-
 		// Copy vertices
 		mesh->SetVertexCount(vertCount);
 		auto vertices = fbxMeshGeo->getVertices();
@@ -73,7 +60,8 @@ std::shared_ptr<Model> FBXImport::ImportAsModel(const std::wstring& filename)
 		auto normals = fbxMeshGeo->getNormals();
 		if (normals != nullptr)
 		{
-			mesh->RequireVertexNormals(BufferFormat::FORMAT_R8G8B8A8_SNORM);
+			// Keep full precision if they will be quantised later
+			mesh->RequireVertexNormals(settings.mQuantization.mNormals ? BufferFormat::FORMAT_R32G32B32_FLOAT : BufferFormat::FORMAT_R8G8B8A8_SNORM);
 			std::transform(normals, normals + vertCount, mesh->GetNormalsV(true).begin(), [=](const auto item) {
 				auto normal = Vector3::TransformNormal(Vector3((float)item.x, (float)item.y, (float)item.z), xform);
 				normal = normal.Normalize();
@@ -85,7 +73,8 @@ std::shared_ptr<Model> FBXImport::ImportAsModel(const std::wstring& filename)
 		auto uvs = fbxMeshGeo->getUVs();
 		if (uvs != nullptr)
 		{
-			mesh->RequireVertexTexCoords(0, BufferFormat::FORMAT_R8G8_UNORM);
+			// Float so that tiling UVs survive; quantisation may reduce to half
+			mesh->RequireVertexTexCoords(0, BufferFormat::FORMAT_R32G32_FLOAT);
 			std::transform(uvs, uvs + vertCount, mesh->GetTexCoordsV(0, true).begin(), [=](const auto item) {
 				return Vector2((float)item.x, 1.0f - (float)item.y);
 			});
@@ -100,41 +89,47 @@ std::shared_ptr<Model> FBXImport::ImportAsModel(const std::wstring& filename)
 			});
 		}
 
-		// Merge same vertices
-		auto& vbuffer = mesh->GetVertexBuffer();
-		std::vector<int> vertRemap;
-		std::unordered_map<size_t, int> vertHashMap;
-		vertRemap.reserve(vbuffer.mCount);
-		vertHashMap.reserve(vbuffer.mCount / 2);
-		for (int v = 0; v < vbuffer.mCount; ++v) {
-			size_t hash = 0;
-			for (auto& element : vbuffer.GetElements()) {
-				hash = AppendHash((uint8_t*)element.mData + element.mBufferStride * v, BufferFormatType::GetType(element.mFormat).GetByteSize(), hash);
-			}
-			int index = (int)vertHashMap.size();
-			auto match = vertHashMap.find(hash);
-			if (match != vertHashMap.end()) {
-				index = vertRemap[match->second];
-			}
-			else {
-				vertHashMap.insert(std::make_pair(hash, v));
-			}
-			vertRemap.push_back(index);
-			if (index != v) {
-				// Copy vertex to compacted index
-				for (auto& element : vbuffer.GetElements()) {
-					std::memcpy(
-						(uint8_t*)element.mData + element.mBufferStride * index,
-						(uint8_t*)element.mData + element.mBufferStride * v,
-						element.GetItemByteSize());
+		// Copy skin weights, keeping the 4 largest influences per vertex
+		auto skin = fbxMeshGeo->getSkin();
+		if (jointIds != nullptr && skin != nullptr)
+		{
+			std::vector<Int4> blendIndices(vertCount, Int4(0));
+			std::vector<Vector4> blendWeights(vertCount, Vector4::Zero);
+			for (int c = 0; c < skin->getClusterCount(); ++c) {
+				auto cluster = skin->getCluster(c);
+				auto joint = jointIds->find(cluster->getLink());
+				if (joint == jointIds->end()) continue;
+				auto clusterIndices = cluster->getIndices();
+				auto clusterWeights = cluster->getWeights();
+				for (int k = 0; k < cluster->getIndicesCount(); ++k) {
+					int v = clusterIndices[k];
+					if (v < 0 || v >= vertCount) continue;
+					int* ids = &blendIndices[v].x;
+					float* weights = &blendWeights[v].x;
+					int smallest = (int)(std::min_element(weights, weights + 4) - weights);
+					if ((float)clusterWeights[k] <= weights[smallest]) continue;
+					ids[smallest] = joint->second;
+					weights[smallest] = (float)clusterWeights[k];
 				}
 			}
+			for (auto& weights : blendWeights) {
+				float sum = weights.x + weights.y + weights.z + weights.w;
+				if (sum > 0.0f) weights /= sum;
+			}
+			mesh->RequireVertexBlendIndices(jointIds->size() > 256 ? BufferFormat::FORMAT_R16G16B16A16_UINT : BufferFormat::FORMAT_R8G8B8A8_UINT);
+			mesh->GetBlendIndicesV().Set(blendIndices);
+			mesh->RequireVertexBlendWeights();
+			mesh->GetBlendWeightsV().Set(blendWeights);
 		}
-		vbuffer.mCount = (int)vertHashMap.size();
-		vbuffer.CalculateImplicitSize();
+
+		// Merge same vertices
+		std::vector<int> vertRemap(mesh->GetVertexCount());
+		int uniqueCount = MeshOptimizer::GenerateVertexRemap(mesh->GetVertexBuffer(), vertRemap, settings.mWeld);
+		MeshOptimizer::RemapVertices(mesh->GetVertexBuffer(), vertRemap);
+		mesh->SetVertexCount(uniqueCount);
 
 		// Copy indices
-		mesh->SetIndexFormat(false);
+		mesh->SetIndexFormat(Mesh::RequiresIndex32(mesh->GetVertexCount()));
 		mesh->SetIndexCount(indCount);
 		auto indices = fbxMeshGeo->getFaceIndices();
 		std::transform(indices, indices + indCount, mesh->GetIndicesV().begin(), [&](const auto item) {
@@ -146,7 +141,6 @@ std::shared_ptr<Model> FBXImport::ImportAsModel(const std::wstring& filename)
 
 		// If the mesh transform flipped face orientation,
 		// flip them back (via index swizzling)
-		auto flip = xform.Determinant() < 0;
 		if (flip)
 		{
 			auto meshInds = mesh->GetIndicesV();
@@ -159,41 +153,298 @@ std::shared_ptr<Model> FBXImport::ImportAsModel(const std::wstring& filename)
 			}
 		}
 
-		auto TexLoader = [&](const ofbx::Texture* fbxtex)->std::shared_ptr<Texture> {
-			if (fbxtex == nullptr) return nullptr;
-			auto fbxFName = fbxtex->getFileName();
-			std::wstring texPath;
-			std::transform(fbxFName.begin, fbxFName.end, std::back_inserter(texPath), [](auto c) { return (wchar_t)c; });
-			auto& loader = ResourceLoader::GetSingleton();
-			auto tex = loader.LoadTexture(texPath);
-			if (tex == nullptr) {
-				auto end = texPath.find_last_of(L"/\\");
-				if (end >= 0) {
-					texPath = filename.substr(0, filename.find_last_of(L"/\\"))
-						+ texPath.substr(end);
-					tex = loader.LoadTexture(texPath);
-				}
+		// Reorder for post-transform cache and then vertex fetch locality
+		if (settings.mOptimizeMeshes) {
+			auto report = MeshOptimizer::Optimize(*mesh);
+			if (settings.mLogOptimization) {
+				char buffer[256];
+				sprintf_s(buffer, "Optimized %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, Verts %d -> %d\n",
+					mesh->GetName().c_str(),
+					report.mBefore.mACMR, report.mAfter.mACMR,
+					report.mBefore.mATVR, report.mAfter.mATVR,
+					report.mVertexCountBefore, report.mVertexCountAfter);
+				OutputDebugStringA(buffer);
 			}
-			return tex;
-		};
+		}
 
-		auto fbxMatCount = fbxMesh->getMaterialCount();
-		auto fbxMat = fbxMesh->getMaterial(0);
-		auto texDiffuse = TexLoader(fbxMat->getTexture(ofbx::Texture::TextureType::DIFFUSE));
-		if (texDiffuse != nullptr)
+		// Compact vertex encodings
 		{
-			auto material = mesh->GetMaterial(true);
-			material->SetUniformTexture("Texture", texDiffuse);
+			auto report = MeshQuantizer::Quantize(*mesh, settings.mQuantization);
+			if (settings.mLogOptimization) {
+				char buffer[256];
+				sprintf_s(buffer, "Quantized %s: Vertex %d -> %d bytes, Error Pos %g, Normal %g deg, UV %g\n",
+					mesh->GetName().c_str(),
+					report.mVertexSizeBefore, report.mVertexSizeAfter,
+					report.mMaxPositionError, report.mMaxNormalError, report.mMaxTexCoordError);
+				OutputDebugStringA(buffer);
+			}
 		}
 
 		// Notify that this mesh data has changed
 		mesh->MarkChanged();
 		mesh->CalculateBoundingBox();
 
-		// Add to the model to be returned
-		outModel->AppendMesh(mesh);
+		return mesh;
+	}
+
+	// Wait for the queued textures, retrying missing textures from
+	// the directory containing the model. Only the importing thread
+	// touches the loader; its workers do the decoding
+	std::vector<std::shared_ptr<Texture>> ResolveTextures(const std::wstring& filename, const std::vector<std::wstring>& texPaths,
+		const std::vector<ResourceLoader::Handle<Texture>>& handles) {
+		auto& loader = ResourceLoader::GetSingleton();
+		std::vector<std::shared_ptr<Texture>> textures(texPaths.size());
+		for (int t = 0; t < (int)texPaths.size(); ++t) {
+			// A malformed file is retried from the model directory, as a missing one is
+			try { textures[t] = handles[t].Wait(); }
+			catch (...) { }
+		}
+
+		std::vector<std::wstring> fallbackPaths;
+		std::vector<int> fallbackIds;
+		auto directory = filename.substr(0, filename.find_last_of(L"/\\"));
+		for (int t = 0; t < (int)texPaths.size(); ++t) {
+			if (textures[t] != nullptr) continue;
+			auto end = texPaths[t].find_last_of(L"/\\");
+			fallbackPaths.push_back(directory + (end != std::wstring::npos ? texPaths[t].substr(end) : L"/" + texPaths[t]));
+			fallbackIds.push_back(t);
+		}
+		if (fallbackPaths.empty()) return textures;
+		std::vector<std::shared_ptr<Texture>> fallbacks(fallbackPaths.size());
+		loader.LoadTextures(fallbackPaths, fallbacks);
+		for (int f = 0; f < (int)fallbackIds.size(); ++f) textures[fallbackIds[f]] = fallbacks[f];
+		return textures;
+	}
+}
+
+std::shared_ptr<Model> FBXImport::ImportAsModel(const std::wstring& filename)
+{
+	return ImportAsModel(filename, ImportSettings());
+}
+// Load FBX data and convert it to the internal engine representation of a Model
+// Textures are decoded by the loader's workers while meshes are converted in parallel
+std::shared_ptr<Model> FBXImport::ImportAsModel(const std::wstring& filename, const ImportSettings& settings)
+{
+
+	// Read file data
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) throw "Failed to open file";
+	file.seekg(0, std::ios::end);
+	auto filesize = file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	std::vector<ofbx::u8> contents(filesize, '\0');
+	if (!file.read((char*)contents.data(), filesize)) throw "Failed to read file contents";
+
+	// Load FBX contents
+	ofbx::LoadFlags flags =
+		ofbx::LoadFlags::TRIANGULATE |
+		ofbx::LoadFlags::IGNORE_BLEND_SHAPES |
+		ofbx::LoadFlags::IGNORE_CAMERAS |
+		ofbx::LoadFlags::IGNORE_LIGHTS |
+		ofbx::LoadFlags::IGNORE_VIDEOS;
+	// Bones are limb nodes
+	bool importAnimation = settings.mImportAnimation && settings.mPreserveHierarchy;
+	if (!importAnimation) flags |= ofbx::LoadFlags::IGNORE_LIMBS;
+
+	auto fbxScene = ofbx::load(contents.data(), (int)contents.size(), (ofbx::u16)flags,
+		settings.mParallel ? &ParallelJobProcessor : nullptr);
+	if (fbxScene == nullptr) throw "Failed to parse FBX";
+
+	// The model that will be returned
+	auto outModel = std::make_shared<Model>();
+	// FBX is in cm; this engine units are meters
+	auto scaleFactor = fbxScene->getGlobalSettings()->UnitScaleFactor / 100.0f;
+	int meshCount = fbxScene->getMeshCount();
+
+	// Find the unique diffuse textures (many meshes share a material)
+	std::vector<std::wstring> texPaths;
+	std::vector<int> meshTexIds(meshCount, -1);
+	for (int i = 0; i < meshCount; ++i) {
+		auto fbxMesh = fbxScene->getMesh(i);
+		if (fbxMesh->getMaterialCount() == 0) continue;
+		auto fbxTex = fbxMesh->getMaterial(0)->getTexture(ofbx::Texture::TextureType::DIFFUSE);
+		if (fbxTex == nullptr) continue;
+		auto fbxFName = fbxTex->getFileName();
+		std::wstring texPath;
+		std::transform(fbxFName.begin, fbxFName.end, std::back_inserter(texPath), [](auto c) { return (wchar_t)c; });
+		auto it = std::find(texPaths.begin(), texPaths.end(), texPath);
+		meshTexIds[i] = (int)(it - texPaths.begin());
+		if (it == texPaths.end()) texPaths.push_back(std::move(texPath));
+	}
+	// Queued here so that the loader decodes them while meshes convert
+	std::vector<ResourceLoader::Handle<Texture>> texHandles;
+	texHandles.reserve(texPaths.size());
+	for (auto& texPath : texPaths) texHandles.push_back(ResourceLoader::GetSingleton().LoadTextureAsync(texPath, ResourceLoader::Priority::High));
+
+	// Meshes that share geometry, winding and texture are converted
+	// once and instanced, unless transforms are baked into vertices
+	struct GeometryKey {
+		const void* mSource;
+		bool mFlip;
+		int mTexId;
+		auto operator<=>(const GeometryKey& other) const = default;
+	};
+	std::map<GeometryKey, int> geometryIds;
+	std::vector<int> geometrySources;
+	std::vector<int> meshGeometryIds(meshCount);
+	std::vector<Matrix> meshXForms(meshCount);
+	for (int i = 0; i < meshCount; ++i) {
+		auto fbxMesh = fbxScene->getMesh(i);
+		meshXForms[i] = ToMatrix(fbxMesh->getGlobalTransform()) * Matrix::CreateScale(scaleFactor);
+		GeometryKey key = {
+			settings.mPreserveHierarchy ? (const void*)fbxMesh->getGeometry() : (const void*)fbxMesh,
+			meshXForms[i].Determinant() < 0,
+			meshTexIds[i],
+		};
+		auto it = geometryIds.try_emplace(key, (int)geometrySources.size()).first;
+		if (it->second == (int)geometrySources.size()) geometrySources.push_back(i);
+		meshGeometryIds[i] = it->second;
+	}
+
+	// Every skinned geometry shares one set of joints on the model
+	JointMap jointIds;
+	std::vector<const ofbx::Object*> joints;
+	std::vector<Matrix> inverseBindMatrices;
+	if (importAnimation) {
+		for (int i = 0; i < meshCount; ++i) {
+			auto skin = fbxScene->getMesh(i)->getGeometry()->getSkin();
+			if (skin == nullptr) continue;
+			for (int c = 0; c < skin->getClusterCount(); ++c) {
+				auto cluster = skin->getCluster(c);
+				auto link = cluster->getLink();
+				if (link == nullptr || !jointIds.try_emplace(link, (int)joints.size()).second) continue;
+				joints.push_back(link);
+				// Geometry to FBX world, then into the joint at bind time
+				inverseBindMatrices.push_back(ToMatrix(cluster->getTransformMatrix()) * ToMatrix(cluster->getTransformLinkMatrix()).Invert());
+			}
+		}
+	}
+
+	// Convert, weld, optimise and bound each geometry
+	int geometryCount = (int)geometrySources.size();
+	std::vector<std::shared_ptr<Mesh>> meshes(geometryCount);
+	std::vector<int> geometryIdList(geometryCount);
+	std::iota(geometryIdList.begin(), geometryIdList.end(), 0);
+	auto Convert = [&](int g) {
+		int i = geometrySources[g];
+		auto& xform = settings.mPreserveHierarchy ? Matrix::Identity : meshXForms[i];
+		meshes[g] = ConvertMesh(fbxScene->getMesh(i), xform, meshXForms[i].Determinant() < 0,
+			joints.empty() ? nullptr : &jointIds, settings);
+	};
+	if (settings.mParallel) std::for_each(std::execution::par, geometryIdList.begin(), geometryIdList.end(), Convert);
+	else std::for_each(geometryIdList.begin(), geometryIdList.end(), Convert);
+	auto textures = ResolveTextures(filename, texPaths, texHandles);
+
+	std::vector<RangeInt> geometryMeshes(geometryCount);
+	for (int g = 0; g < geometryCount; ++g) {
+		auto& mesh = meshes[g];
+		int texId = meshTexIds[geometrySources[g]];
+		if (texId >= 0 && textures[texId] != nullptr)
+		{
+			auto material = mesh->GetMaterial(true);
+			material->SetUniformTexture("Texture", textures[texId]);
+		}
+
+		// Add to the model to be returned (in file order)
+		if (settings.mSplitFor16BitIndices) geometryMeshes[g] = outModel->AppendMesh16(mesh);
+		else {
+			mesh->RequireNarrowestIndexFormat();
+			geometryMeshes[g] = RangeInt(outModel->AppendMesh(mesh), 1);
+		}
+	}
+
+	// Recreate the nodes leading to each mesh, and instance its geometry there
+	if (settings.mPreserveHierarchy) {
+		Model::Transform rootTransform;
+		// Unit conversion applies to the whole hierarchy
+		rootTransform.mScale = Vector3(scaleFactor);
+		int rootNode = outModel->AppendNode("Root", -1, rootTransform);
+		std::map<const ofbx::Object*, int> nodeIds;
+		std::function<int(const ofbx::Object*)> RequireNode = [&](const ofbx::Object* fbxObject)->int {
+			if (fbxObject == nullptr) return rootNode;
+			auto it = nodeIds.find(fbxObject);
+			if (it != nodeIds.end()) return it->second;
+			int parent = RequireNode(fbxObject->getParent());
+			// Same local transform that getGlobalTransform() accumulates
+			auto local = ToMatrix(fbxObject->evalLocal(fbxObject->getLocalTranslation(), fbxObject->getLocalRotation()));
+			Model::Transform transform;
+			local.Decompose(transform.mScale, transform.mRotation, transform.mPosition);
+			int node = outModel->AppendNode(fbxObject->name, parent, transform);
+			nodeIds.insert({ fbxObject, node, });
+			return node;
+		};
+		for (int i = 0; i < meshCount; ++i) {
+			int node = RequireNode(fbxScene->getMesh(i));
+			auto range = geometryMeshes[meshGeometryIds[i]];
+			for (int m = range.start; m < range.start + range.length; ++m) outModel->AppendInstance(node, m);
+		}
+		auto& skin = outModel->GetSkin();
+		for (auto joint : joints) skin.mJointNodes.push_back(RequireNode(joint));
+		skin.mInverseBindMatrices = std::move(inverseBindMatrices);
+
+		// Sample each animated node's local transform at a fixed rate
+		for (int s = 0; importAnimation && s < fbxScene->getAnimationStackCount(); ++s) {
+			auto fbxStack = fbxScene->getAnimationStack(s);
+			auto fbxLayer = fbxStack->getLayer(0);
+			if (fbxLayer == nullptr) continue;
+			std::vector<const ofbx::Object*> bones;
+			double timeFrom = std::numeric_limits<double>::max(), timeTo = std::numeric_limits<double>::lowest();
+			for (int c = 0; auto fbxCurveNode = fbxLayer->getCurveNode(c); ++c) {
+				auto bone = fbxCurveNode->getBone();
+				if (bone == nullptr) continue;
+				if (std::find(bones.begin(), bones.end(), bone) == bones.end()) bones.push_back(bone);
+				for (int k = 0; k < 3; ++k) {
+					auto curve = fbxCurveNode->getCurve(k);
+					if (curve == nullptr || curve->getKeyCount() == 0) continue;
+					timeFrom = std::min(timeFrom, ofbx::fbxTimeToSeconds(curve->getKeyTime()[0]));
+					timeTo = std::max(timeTo, ofbx::fbxTimeToSeconds(curve->getKeyTime()[curve->getKeyCount() - 1]));
+				}
+			}
+			if (bones.empty()) continue;
+			if (auto takeInfo = fbxScene->getTakeInfo(fbxStack->name)) {
+				timeFrom = takeInfo->local_time_from;
+				timeTo = takeInfo->local_time_to;
+			}
+			if (!(timeTo >= timeFrom)) timeTo = timeFrom = 0.0;
+
+			float sampleRate = settings.mAnimation.mSampleRate;
+			int frameCount = (int)std::ceil((timeTo - timeFrom) * sampleRate) + 1;
+			std::vector<int> nodes;
+			for (auto bone : bones) nodes.push_back(RequireNode(bone));
+			std::vector<Model::Transform> samples((size_t)frameCount * bones.size());
+			std::vector<int> boneIds(bones.size());
+			std::iota(boneIds.begin(), boneIds.end(), 0);
+			auto SampleBone = [&](int b) {
+				auto bone = bones[b];
+				auto translationNode = fbxLayer->getCurveNode(*bone, "Lcl Translation");
+				auto rotationNode = fbxLayer->getCurveNode(*bone, "Lcl Rotation");
+				auto scalingNode = fbxLayer->getCurveNode(*bone, "Lcl Scaling");
+				for (int f = 0; f < frameCount; ++f) {
+					double time = std::min(timeFrom + f / sampleRate, timeTo);
+					auto local = ToMatrix(bone->evalLocal(
+						translationNode != nullptr ? translationNode->getNodeLocalTransform(time) : bone->getLocalTranslation(),
+						rotationNode != nullptr ? rotationNode->getNodeLocalTransform(time) : bone->getLocalRotation(),
+						scalingNode != nullptr ? scalingNode->getNodeLocalTransform(time) : bone->getLocalScaling()));
+					auto& sample = samples[(size_t)f * bones.size() + b];
+					local.Decompose(sample.mScale, sample.mRotation, sample.mPosition);
+				}
+			};
+			if (settings.mParallel) std::for_each(std::execution::par, boneIds.begin(), boneIds.end(), SampleBone);
+			else std::for_each(boneIds.begin(), boneIds.end(), SampleBone);
+
+			auto clip = std::make_shared<AnimationClip>(fbxStack->name);
+			clip->Build(nodes, samples, frameCount, settings.mAnimation);
+			outModel->AppendAnimation(clip);
+		}
+		outModel->UpdateWorldMatrices();
 	}
 	fbxScene->destroy();
 
+	// Meshes are simplified in parallel
+	if (!settings.mLODs.empty()) {
+		MeshSimplifier::GenerateLODs(*outModel, settings.mLODs, settings.mLODMaxError);
+	}
+
 	return outModel;
 }
@@ -2,12 +2,45 @@
 
 #include "Mesh.h"
 #include "Model.h"
+#include "MeshOptimizer.h"
+#include "MeshQuantizer.h"
+#include "Animation.h"
 #include <string>
+#include <vector>
 
 class FBXImport
 {
 public:
+	struct ImportSettings {
+		// Reorder triangles and vertices for GPU cache efficiency
+		bool mOptimizeMeshes = true;
+		// Output vertex cache statistics for each optimised mesh
+		bool mLogOptimization = false;
+		// Split meshes with too many vertices so they can use 16-bit
+		// indices, otherwise large meshes use 32-bit indices
+		bool mSplitFor16BitIndices = true;
+		// Compact vertex encodings; quantised positions and normals
+		// must be decoded by the shader so are opt-in
+		MeshQuantizer::Settings mQuantization = { .mPositions = false, .mNormals = false, };
+		// Generate a simplified LOD per level (empty for none)
+		std::vector<Model::LODLevel> mLODs;
+		// Largest allowed simplification error, relative to mesh size
+		float mLODMaxError = 0.01f;
+		// Tolerances used when merging duplicate vertices
+		MeshOptimizer::WeldSettings mWeld;
+		// Parse and convert meshes on worker threads (textures always
+		// decode on the loader's workers)
+		bool mParallel = true;
+		// Keep the node hierarchy and instance shared geometry, rather
+		// than baking each node transform into a copy of its mesh
+		bool mPreserveHierarchy = true;
+		// Import skins and animation clips (requires mPreserveHierarchy)
+		bool mImportAnimation = true;
+		AnimationClip::Settings mAnimation;
+	};
+
 	static std::shared_ptr<Model> ImportAsModel(const std::wstring& filename);
+	static std::shared_ptr<Model> ImportAsModel(const std::wstring& filename, const ImportSettings& settings);
 
 };
 
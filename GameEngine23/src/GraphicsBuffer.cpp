@@ -2,24 +2,34 @@
 
 #include <algorithm>
 
-void GraphicsBufferDelta::AppendRegion(RangeInt destRegion) {
-	auto it = std::partition_point(mCopyRegions.begin(), mCopyRegions.end(), [&](auto& item) {
-		return item.end() < destRegion.start;
-		});
-	if (it != mCopyRegions.end() && it->start <= destRegion.end()) {
-		*it = RangeInt::FromBeginEnd(
-			std::min(it->start, destRegion.start),
-			std::max(it->end(), destRegion.end())
-		);
-		auto nxt = it + 1;
-		for (; nxt != mCopyRegions.end(); ++nxt) {
-			if (nxt->start > it->end()) break;
-		}
-		if (nxt != it + 1) {
-			it->end(std::max(it->end(), (nxt - 1)->end()));
-			mCopyRegions.erase(it + 1, nxt);
-		}
-		return;
-	}
-	mCopyRegions.insert(it, destRegion);
+GraphicsBufferBase::GraphicsBufferBase(int stride, int count)
+	: mStride(stride), mCount(count),
+	mBinding((size_t)this, 0, BufferLayout::Usage::Uniform, count, 1)
+{
+	mBinding.AppendElement(BufferLayout::Element("Data", BufferFormat::FORMAT_UNKNOWN, stride, nullptr));
+	mData.resize(GetSize());
+	SyncBinding();
+	MarkChanged();
+}
+void GraphicsBufferBase::SyncBinding() {
+	mBinding.GetElements()[0].mData = mData.data();
+	mBinding.mCount = mCount;
+	mBinding.mSize = GetSize();
+}
+int GraphicsBufferBase::SetCount(int count) {
+	int ocount = mCount;
+	mCount = count;
+	mData.resize(GetSize());
+	SyncBinding();
+	MarkChanged();
+	return ocount;
+}
+void GraphicsBufferBase::MarkChanged(RangeInt rangeCount) {
+	mBinding.MarkChanged(rangeCount);
+}
+void GraphicsBufferBase::MarkChanged() {
+	mBinding.MarkChanged();
+}
+bool GraphicsBufferBase::GetChangesSince(int revision, GraphicsBufferDelta& delta) const {
+	return mBinding.GetChangesSince(revision, delta);
 }
@@ -11,32 +11,31 @@ class GraphicsBufferBase
 protected:
 	int mStride;
 	int mCount;
-	int mRevision;
 	std::vector<uint8_t> mData;
+	// Points at mData and owns the revision and change log,
+	// so that uploads only copy the changed items
+	BufferLayoutPersistent mBinding;
+	void SyncBinding();
 public:
-	GraphicsBufferBase(int stride, int count)
-		: mStride(stride), mCount(count)
-	{
-		mData.resize(GetSize());
-		++mRevision;
-	}
+	GraphicsBufferBase(int stride, int count);
+	// mBinding references this object and its data
+	GraphicsBufferBase(const GraphicsBufferBase& other) = delete;
+	GraphicsBufferBase& operator =(const GraphicsBufferBase& other) = delete;
 	const uint8_t* GetRawData() const { return mData.data(); }
 	int GetSize() const { return mCount * mStride; }
 	int GetStride() const { return mStride; }
 	int GetCount() const { return mCount; }
-	int GetRevision() const { return mRevision; }
-	int SetCount(int count)
-	{
-		int ocount = mCount;
-		mCount = count;
-		mData.resize(GetSize());
-		++mRevision;
-		return ocount;
-	}
-	void MarkChanged(RangeInt rangeCount)
-	{
-		mRevision++;
-	}
+	int GetRevision() const { return mBinding.mRevision; }
+	// Upload with CommandBuffer::CopyBufferData(GetBinding(), { RangeInt(-1, 0) }),
+	// only items changed since the last upload are copied
+	const BufferLayoutPersistent& GetBinding() const { return mBinding; }
+	int SetCount(int count);
+	// Items in this range have been written and need to be uploaded
+	void MarkChanged(RangeInt rangeCount);
+	// All data must be uploaded
+	void MarkChanged();
+	// Get the item ranges written since `revision`, or false for a full upload
+	bool GetChangesSince(int revision, GraphicsBufferDelta& delta) const;
 };
 
 template<typename T>
@@ -49,15 +48,22 @@ public:
 	{
 	}
 
-	void SetValue(int index, T& data) {
+	void SetValue(int index, const T& data) {
 		((T*)mData.data())[index] = data;
-		++mRevision;
+		MarkChanged(RangeInt(index, 1));
+	}
+	void SetValues(int index, std::span<const T> data) {
+		std::copy(data.begin(), data.end(), (T*)mData.data() + index);
+		MarkChanged(RangeInt(index, (int)data.size()));
 	}
+	// The range is marked changed, as the caller will write to it. Not
+	// thread-safe: for parallel writes, get one span and split it
 	std::span<T> GetValues(RangeInt range) {
+		MarkChanged(range);
 		return std::span<T>((T*)mData.data() + range.start, range.length);
 	}
 	std::span<const T> GetValues(RangeInt range) const {
-		return std::span<T>((T*)mData.data() + range.start, range.length);
+		return std::span<const T>((const T*)mData.data() + range.start, range.length);
 	}
 
 	Delegate<Int2>::Reference&& RegisterOnDataUpdated(Delegate<Int2>::Function& fn) {
@@ -65,13 +71,3 @@ public:
 	}
 
 };
-
-class GraphicsBufferDelta
-{
-	std::vector<RangeInt> mCopyRegions;
-
-public:
-	void AppendRegion(RangeInt destRegion);
-	std::span<RangeInt> GetRegions() { return mCopyRegions; }
-	void Clear() { mCopyRegions.clear(); }
-};
@@ -264,25 +264,28 @@ public:
 class CommandBuffer {
 protected:
     std::unique_ptr<CommandBufferInteropBase> mInterop;
-    ExpandableMemoryArena mArena;
+    // Frame data may be written from any thread
+    std::unique_ptr<ThreadedMemoryArena> mArena;
     std::vector<const BufferLayout*> tBindingLayout;
-    void* RequireFrameData(int size) { return mArena.Require(size); }
+    void* RequireFrameData(int size, int alignment = 8) { return mArena->Require(size, alignment); }
 public:
     CommandBuffer(CommandBuffer& other) = delete;
     CommandBuffer(CommandBuffer&& other) = default;
-    CommandBuffer(CommandBufferInteropBase* interop) : mInterop(interop) { }
+    CommandBuffer(CommandBufferInteropBase* interop) : mInterop(interop), mArena(std::make_unique<ThreadedMemoryArena>()) { }
     CommandBuffer& operator = (CommandBuffer&& other) = default;
     GraphicsDeviceBase* GetGraphics() const { return mInterop->GetGraphics(); }
     void BeginScope(const std::wstring_view& name) { mInterop->BeginScope(name); }
     void EndScope() { mInterop->EndScope(); }
-    void Reset() { mInterop->Reset(); mArena.Clear(); }
+    void Reset() { mInterop->Reset(); mArena->Clear(); }
     void SetSurface(GraphicsSurface* surface) { mInterop->SetSurface(surface); }
     GraphicsSurface* GetSurface() { return mInterop->GetSurface(); }
     void SetViewport(RectInt viewport) { mInterop->SetViewport(viewport); }
     void SetRenderTargets(std::span<RenderTargetBinding> colorTargets, RenderTargetBinding depthTarget) { mInterop->SetRenderTargets(colorTargets, depthTarget); }
     void ClearRenderTarget(const ClearConfig& config) { mInterop->ClearRenderTarget(config); }
     uint64_t GetGlobalPSOHash() const { return mInterop->GetGlobalPSOHash(); }
-    int GetFrameDataConsumed() const { return mArena.SumConsumedMemory(); }
+    int GetFrameDataConsumed() const { return mArena->SumConsumedMemory(); }
+    FrameDataStatistics GetFrameDataStatistics() const { return mArena->GetStatistics(); }
+    const ThreadedMemoryArena& GetFrameDataArena() const { return *mArena; }
     const PipelineLayout* RequirePipeline(
         const ShaderStages& shaders,
         const MaterialState& materialState, std::span<const BufferLayout*> bindings) {
@@ -294,7 +297,11 @@ public:
     const PipelineLayout* RequireRaytracePSO(const CompiledShader& rayGenShader, const CompiledShader& hitShader, const CompiledShader& missShader) {
         return mInterop->RequireRaytracePSO(rayGenShader, hitShader, missShader);
     }
-    template<class T> std::span<T> RequireFrameData(int count) { return std::span<T>((T*)RequireFrameData(count * sizeof(T)), count); }
+    template<class T> std::span<T> RequireFrameData(int count) { return RequireFrameData<T>(count, (int)alignof(T)); }
+    // Alignment can be raised for SIMD (16/64) or in-place constant buffer (256) data
+    template<class T> std::span<T> RequireFrameData(int count, int alignment) {
+        return std::span<T>((T*)RequireFrameData(count * (int)sizeof(T), std::max(alignment, 8)), count);
+    }
     template<class T> std::span<T> RequireFrameData(std::span<T> data) {
         auto outData = std::span<T>((T*)RequireFrameData((int)(data.size() * sizeof(T))), data.size());
         for (int i = 0; i < outData.size(); ++i) outData[i] = data[i];
@@ -0,0 +1,318 @@
+#include <span>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "GraphicsDeviceNull.h"
+
+// A surface with a back buffer that is never presented
+class NullGraphicsSurface : public GraphicsSurface {
+    std::shared_ptr<RenderTarget2D> mBackBuffer;
+public:
+    NullGraphicsSurface(Int2 resolution)
+        : mBackBuffer(std::make_shared<RenderTarget2D>(resolution)) { }
+    const std::shared_ptr<RenderTarget2D>& GetBackBuffer() const override { return mBackBuffer; }
+    Int2 GetResolution() const override { return mBackBuffer->GetResolution(); }
+    void SetResolution(Int2 res) override { mBackBuffer->SetResolution(res); }
+    int Present() override { return 0; }
+};
+
+// Collects constant buffers and resources required by a pipeline
+static void AppendCBRBs(PipelineLayout& layout, const ShaderBase::ShaderReflection& reflection) {
+    for (auto& cb : reflection.mConstantBuffers) {
+        if (std::any_of(layout.mConstantBuffers.begin(), layout.mConstantBuffers.end(),
+            [&](auto* o) { return *o == cb; })) continue;
+        layout.mConstantBuffers.push_back(&cb);
+    }
+    for (auto& rb : reflection.mResourceBindings) {
+        if (std::any_of(layout.mResources.begin(), layout.mResources.end(),
+            [&](auto* o) { return *o == rb; })) continue;
+        layout.mResources.push_back(&rb);
+    }
+}
+
+// Receives draw calls and runs them through the device caches
+// without recording any GPU commands
+class NullCommandBuffer : public CommandBufferInteropBase {
+    GraphicsDeviceNull* mDevice;
+    GraphicsSurface* mSurface;
+    LockMask mFrameHandle;
+    InplaceVector<BufferFormat, 8> mFrameBufferFormats;
+    BufferFormat mDepthBufferFormat;
+    RectInt mViewportRect;
+public:
+    NullCommandBuffer(GraphicsDeviceNull* device)
+        : mDevice(device)
+        , mSurface(nullptr)
+        , mFrameHandle(0)
+        , mDepthBufferFormat(BufferFormat::FORMAT_UNKNOWN)
+        , mViewportRect(0, 0, 0, 0)
+    { }
+    GraphicsDeviceBase* GetGraphics() const override {
+        return mDevice;
+    }
+    void BeginScope(const std::wstring_view& name) override { }
+    void EndScope() override { }
+    void Reset() override {
+        mFrameHandle = mDevice->BeginFrame();
+        mSurface = nullptr;
+        mFrameBufferFormats.clear();
+        mDepthBufferFormat = BufferFormat::FORMAT_UNKNOWN;
+    }
+    void SetSurface(GraphicsSurface* surface) override {
+        mSurface = surface;
+    }
+    GraphicsSurface* GetSurface() override {
+        return mSurface;
+    }
+    void SetRenderTargets(std::span<RenderTargetBinding> colorTargets, RenderTargetBinding depthTarget) override {
+        mFrameBufferFormats.clear();
+        Int2 resolution(0, 0);
+        for (auto& target : colorTargets) {
+            auto* rt = target.mTarget;
+            if (rt == nullptr && mSurface != nullptr) rt = mSurface->GetBackBuffer().get();
+            if (rt == nullptr) continue;
+            mFrameBufferFormats.push_back(rt->GetFormat());
+            resolution = rt->GetResolution();
+        }
+        mDepthBufferFormat = depthTarget.mTarget != nullptr ? depthTarget.mTarget->GetFormat() : BufferFormat::FORMAT_UNKNOWN;
+        if (depthTarget.mTarget != nullptr) resolution = depthTarget.mTarget->GetResolution();
+        SetViewport(RectInt(0, 0, resolution.x, resolution.y));
+    }
+    void SetViewport(RectInt rect) override {
+        mViewportRect = rect;
+    }
+    void ClearRenderTarget(const ClearConfig& clear) override { }
+    void* RequireConstantBuffer(std::span<const uint8_t> data, size_t hash) override {
+        return mDevice->RequireConstantBuffer(data, hash, mFrameHandle);
+    }
+    void CopyBufferData(const BufferLayout& buffer, std::span<const RangeInt> ranges) override {
+        mDevice->UpdateBufferData(buffer, ranges);
+    }
+    void CopyBufferData(const BufferLayout& source, const BufferLayout& dest, int srcOffset, int dstOffset, int length) override {
+        mDevice->mStatistics.BufferWrite(length);
+    }
+    const PipelineLayout* RequirePipeline(
+        const ShaderStages& shaders,
+        const MaterialState& materialState, std::span<const BufferLayout*> bindings
+    ) override {
+        auto* pipelineState = mDevice->RequirePipelineState(shaders, materialState, bindings,
+            std::span<const BufferFormat>(mFrameBufferFormats.begin(), mFrameBufferFormats.end()), mDepthBufferFormat);
+        if (pipelineState == nullptr) return nullptr;
+        return pipelineState->mLayout.get();
+    }
+    const PipelineLayout* RequireComputePSO(const CompiledShader& computeShader) override {
+        return mDevice->RequireComputePSO(computeShader)->mLayout.get();
+    }
+    const PipelineLayout* RequireRaytracePSO(const CompiledShader& rayGenShader, const CompiledShader& hitShader, const CompiledShader& missShader) override {
+        return mDevice->RequireRaytracePSO(rayGenShader, hitShader, missShader)->mLayout.get();
+    }
+    // Ensure all buffers referenced by a draw have been uploaded
+    void ValidateBindings(std::span<const BufferLayout*> bindings) {
+        for (auto* binding : bindings) {
+            if (binding->mElements == nullptr) continue;
+            assert(mDevice->GetBinding(binding->mIdentifier) != nullptr); // Did you call CopyBufferData on this resource?
+        }
+    }
+    void DrawMesh(std::span<const BufferLayout*> bindings, const PipelineLayout* pso, std::span<const void*> resources, const DrawConfig& config, int instanceCount = 1, const char* name = nullptr) override {
+        if (pso == nullptr || !pso->IsValid()) return;
+        auto* pipelineState = (GraphicsDeviceNull::NullPipelineState*)pso->mPipelineHash;
+
+        static Identifier indirectArgsName("INDIRECTARGS");
+        if (pipelineState->mType == 1) {
+            DispatchMesh(bindings, pso, resources, config, instanceCount, name);
+            return;
+        }
+        else if (!bindings.empty() && bindings[0]->mElements[0].mBindName == indirectArgsName) {
+            const BufferLayout* argsBinding = bindings[0];
+            DrawIndirect(*argsBinding, bindings.subspan(1), pso, resources, config, instanceCount, name);
+            return;
+        }
+        assert(instanceCount > 0);
+        ValidateBindings(bindings);
+        mDevice->mStatistics.DrawInstanced(instanceCount);
+    }
+    void DispatchMesh(std::span<const BufferLayout*> bindings, const PipelineLayout* pso, std::span<const void*> resources, const DrawConfig& config, int instanceCount = 1, const char* name = nullptr) override {
+        if (pso == nullptr || !pso->IsValid()) return;
+        ValidateBindings(bindings);
+        mDevice->mStatistics.DrawInstanced(instanceCount);
+    }
+    void DrawIndirect(const BufferLayout& argsBuffer, std::span<const BufferLayout*> bindings, const PipelineLayout* pso, std::span<const void*> resources, const DrawConfig& config, int instanceCount = 1, const char* name = nullptr) override {
+        if (pso == nullptr || !pso->IsValid()) return;
+        ValidateBindings(bindings);
+        // The real instance count is in the args buffer, record the upper bound
+        mDevice->mStatistics.DrawInstanced(instanceCount);
+    }
+    void DispatchCompute(const PipelineLayout* pso, std::span<const void*> resources, Int3 groupCount) override { }
+    void DispatchRaytrace(const PipelineLayout* pso, std::span<const void*> resources, Int3 size) override { }
+    void Execute() override {
+        SetSurface(nullptr);
+    }
+};
+
+GraphicsDeviceNull::GraphicsDeviceNull()
+    : mFrameId(0)
+{
+    mStatistics = { };
+    mCapabilities.mComputeShaders = true;
+    mCapabilities.mMeshShaders = true;
+    mCapabilities.mMinPrecision = false;
+    mCapabilities.mRaytracingSupported = false;
+}
+GraphicsDeviceNull::~GraphicsDeviceNull() { }
+
+LockMask GraphicsDeviceNull::BeginFrame() {
+    // Frames complete instantly; recycle the oldest slot
+    int frameSlot = (mFrameId++) % FrameCount;
+    LockMask frameHandle = 1ull << frameSlot;
+    mConstantBufferCache.Unlock(frameHandle);
+    return frameHandle;
+}
+
+GraphicsDeviceNull::NullPipelineState* GraphicsDeviceNull::GetOrCreatePipelineState(size_t hash, int type, Identifier name) {
+    std::scoped_lock lock(mPipelineMutex);
+    auto [it, inserted] = mPipelineIds.try_emplace(hash, -1);
+    if (inserted) {
+        it->second = mPipelineStates.Allocate();
+        auto& pipelineState = mPipelineStates[it->second];
+        pipelineState.mHash = hash;
+        pipelineState.mType = type;
+        pipelineState.mLayout = std::make_unique<PipelineLayout>();
+        pipelineState.mLayout->mName = name;
+        pipelineState.mLayout->mRootHash = (size_t)type;
+        pipelineState.mLayout->mPipelineHash = (size_t)&pipelineState;
+    }
+    return &mPipelineStates[it->second];
+}
+GraphicsDeviceNull::NullPipelineState* GraphicsDeviceNull::RequirePipelineState(
+    const ShaderStages& shaders,
+    const MaterialState& materialState, std::span<const BufferLayout*> bindings,
+    std::span<const BufferFormat> frameBufferFormats, BufferFormat depthBufferFormat
+) {
+    // Key the pipeline the same way a real backend would
+    size_t hash = GenericHash({
+        GenericHash(materialState),
+        ArrayHash(frameBufferFormats),
+        GenericHash(depthBufferFormat),
+    });
+    static Identifier indirectArgsName("INDIRECTARGS");
+    auto useBindings = bindings;
+    if (!useBindings.empty() && useBindings[0]->mElements[0].mBindName == indirectArgsName) useBindings = useBindings.subspan(1);
+    for (auto* binding : useBindings) {
+        for (auto& el : binding->GetElements()) {
+            hash = AppendHash(el.mBindName.mId + ((int)el.mBufferStride << 16) + ((int)el.mFormat << 8), hash);
+        }
+    }
+    if (shaders.mMeshShader != nullptr) {
+        hash = AppendHash(shaders.mMeshShader->GetBinaryHash(), hash);
+        if (shaders.mAmplificationShader != nullptr)
+            hash = AppendHash(shaders.mAmplificationShader->GetBinaryHash(), hash);
+    }
+    else if (shaders.mVertexShader != nullptr) {
+        hash = AppendHash(shaders.mVertexShader->GetBinaryHash(), hash);
+    }
+    if (shaders.mPixelShader == nullptr) return nullptr;
+    hash = AppendHash(shaders.mPixelShader->GetBinaryHash(), hash);
+
+    auto* pipelineState = GetOrCreatePipelineState(hash,
+        shaders.mMeshShader != nullptr ? 1 : 0, shaders.mPixelShader->GetName());
+    auto& layout = *pipelineState->mLayout;
+    if (layout.mBindings.empty() && layout.mConstantBuffers.empty() && layout.mResources.empty()) {
+        std::scoped_lock lock(mPipelineMutex);
+        for (auto& b : bindings) layout.mBindings.push_back(b);
+        layout.mMaterialState = materialState;
+        for (auto l : { shaders.mAmplificationShader, shaders.mMeshShader, shaders.mVertexShader, shaders.mPixelShader }) {
+            if (l != nullptr) AppendCBRBs(layout, l->GetReflection());
+        }
+    }
+    return pipelineState;
+}
+GraphicsDeviceNull::NullPipelineState* GraphicsDeviceNull::RequireComputePSO(const CompiledShader& shader) {
+    size_t hash = GenericHash(shader.GetBinaryHash());
+    auto* pipelineState = GetOrCreatePipelineState(hash, 3, shader.GetName());
+    auto& layout = *pipelineState->mLayout;
+    if (layout.mConstantBuffers.empty() && layout.mResources.empty()) {
+        std::scoped_lock lock(mPipelineMutex);
+        AppendCBRBs(layout, shader.GetReflection());
+    }
+    return pipelineState;
+}
+GraphicsDeviceNull::NullPipelineState* GraphicsDeviceNull::RequireRaytracePSO(const CompiledShader& rayGenShader,
+    const CompiledShader& hitShader, const CompiledShader& missShader) {
+    size_t hash = GenericHash({ rayGenShader.GetBinaryHash(), hitShader.GetBinaryHash(), missShader.GetBinaryHash(), });
+    auto* pipelineState = GetOrCreatePipelineState(hash, 2, rayGenShader.GetName());
+    auto& layout = *pipelineState->mLayout;
+    if (layout.mConstantBuffers.empty() && layout.mResources.empty()) {
+        std::scoped_lock lock(mPipelineMutex);
+        for (auto* shader : { &rayGenShader, &hitShader, &missShader }) AppendCBRBs(layout, shader->GetReflection());
+    }
+    return pipelineState;
+}
+
+// Find or allocate a constant buffer matching the data
+GraphicsDeviceNull::NullConstantBuffer* GraphicsDeviceNull::RequireConstantBuffer(std::span<const uint8_t> data, size_t dataHash, LockMask lockBits) {
+    // Match the 256 byte padding of real backends
+    auto allocSize = (int)(data.size() + 255) & ~255;
+    if (dataHash == 0) dataHash = allocSize + GenericHash(data.data(), data.size());
+    auto& item = mConstantBufferCache.RequireItem(dataHash, allocSize, lockBits,
+        [&](auto& item) { // Allocate a new item
+            item.mData.mData.reserve(allocSize);
+            mStatistics.mBufferCreates++;
+        },
+        [&](auto& item) { // Fill an item with data
+            item.mData.mData.assign(data.begin(), data.end());
+            mStatistics.BufferWrite(data.size());
+        },
+        [&](auto& item) { } // An existing item was found to match the data
+    );
+    return &item.mData;
+}
+
+const GraphicsDeviceNull::NullBinding* GraphicsDeviceNull::GetBinding(size_t bindingIdentifier) {
+    std::scoped_lock lock(mBindingMutex);
+    auto binIt = mBindings.find(bindingIdentifier);
+    if (binIt == mBindings.end()) return nullptr;
+    return &binIt->second;
+}
+void GraphicsDeviceNull::UpdateBufferData(const BufferLayout& binding, std::span<const RangeInt> ranges) {
+    std::scoped_lock lock(mBindingMutex);
+    auto& nullBin = mBindings[binding.mIdentifier];
+    bool fullRefresh = false;
+    bool recreated = false;
+    // Buffer would need to be (re)created
+    if (nullBin.mSize < binding.mSize) {
+        nullBin.mSize = binding.mSize;
+        mStatistics.mBufferCreates++;
+        recreated = true;
+        if (binding.mRevision != -1) fullRefresh = true;
+    }
+    // Special case - update full buffer if revision mismatch
+    if (ranges.size() == 1 && ranges[0].start == -1) {
+        if (nullBin.mRevision == binding.mRevision) return;
+        fullRefresh = true;
+    }
+    int previousRevision = nullBin.mRevision;
+    nullBin.mRevision = binding.mRevision;
+    nullBin.mCount = binding.mCount;
+    if (fullRefresh) {
+        if (binding.mElementCount == 1 && binding.mElements->mData == nullptr) return;
+        // Match the D3D path: only changed items are uploaded when possible
+        GraphicsBufferDelta delta;
+        if (!recreated && previousRevision >= 0 && binding.GetChangesSince(previousRevision, delta)) {
+            mStatistics.BufferWrite(delta.GetTotalLength() * binding.CalculateBufferStride());
+            return;
+        }
+        mStatistics.BufferWrite(binding.mSize);
+        return;
+    }
+    for (auto& range : ranges) {
+        if (range.length > 0) mStatistics.BufferWrite(range.length);
+    }
+}
+
+CommandBuffer GraphicsDeviceNull::CreateCommandBuffer() {
+    return CommandBuffer(new NullCommandBuffer(this));
+}
+std::shared_ptr<GraphicsSurface> GraphicsDeviceNull::CreateSurface(WindowBase* window) {
+    return std::make_shared<NullGraphicsSurface>(Int2(1024, 1024));
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "GraphicsDeviceBase.h"
+
+// A graphics device that does not talk to a GPU
+// Performs the same CPU-side bookkeeping as a real backend
+// (pipeline keying, constant buffer dedupe, buffer revisions)
+// so that render code can be profiled or tested headless
+class GraphicsDeviceNull : public GraphicsDeviceBase {
+public:
+    // Frames that can be "in flight" before their locks are released
+    static const int FrameCount = 2;
+
+    struct NullPipelineState {
+        size_t mHash;
+        int mType;          // 0: Graphics, 1: Mesh, 2: Raytrace, 3: Compute
+        std::unique_ptr<PipelineLayout> mLayout;
+    };
+    struct NullConstantBuffer {
+        std::vector<uint8_t> mData;
+    };
+    struct NullBinding {
+        int mRevision = -1;
+        int mSize = 0;
+        int mCount = 0;
+    };
+
+private:
+    std::mutex mPipelineMutex;
+    std::mutex mBindingMutex;
+    // Layouts point back at their state, so storage must not relocate
+    ChunkedSparseArray<NullPipelineState> mPipelineStates;
+    std::unordered_map<size_t, int> mPipelineIds;
+    std::unordered_map<size_t, NullBinding> mBindings;
+    PerFrameItemStore<NullConstantBuffer> mConstantBufferCache;
+    int mFrameId;
+
+    NullPipelineState* GetOrCreatePipelineState(size_t hash, int type, Identifier name);
+
+public:
+    GraphicsDeviceNull();
+    ~GraphicsDeviceNull();
+
+    std::wstring GetDeviceName() const override { return L"Null"; }
+
+    // Move to the next frame slot, releasing anything still locked by it
+    LockMask BeginFrame();
+
+    NullPipelineState* RequirePipelineState(const ShaderStages& shaders,
+        const MaterialState& materialState, std::span<const BufferLayout*> bindings,
+        std::span<const BufferFormat> frameBufferFormats, BufferFormat depthBufferFormat);
+    NullPipelineState* RequireComputePSO(const CompiledShader& shader);
+    NullPipelineState* RequireRaytracePSO(const CompiledShader& rayGenShader,
+        const CompiledShader& hitShader, const CompiledShader& missShader);
+    NullConstantBuffer* RequireConstantBuffer(std::span<const uint8_t> data, size_t hash, LockMask lockBits);
+    const NullBinding* GetBinding(size_t bindingIdentifier);
+    void UpdateBufferData(const BufferLayout& binding, std::span<const RangeInt> ranges);
+
+    CommandBuffer CreateCommandBuffer() override;
+    std::shared_ptr<GraphicsSurface> CreateSurface(WindowBase* window) override;
+};
@@ -15,18 +15,20 @@ class MaterialEvaluator {
 	std::unique_ptr<uint8_t[]> mBuffer = nullptr;
 	int mBufferSize = 0;
 public:
+	// Index into the value array (a stack may observe more than 255 values)
+	typedef uint16_t ParameterId;
 	struct Source {
 		const Material* mMaterial;
 	};
 	struct Value {
 		uint16_t mOutputOffset;	// Offset in the output data array
 		uint16_t mValueOffset;	// Offset within the material
+		uint16_t mSourceId;
 		uint8_t mDataSize;		// How big the data type is
-		int8_t mSourceId;
 	};
-	uint16_t mValueOffset;
-	uint16_t mComputedOffset;
-	uint16_t mParameterOffset;
+	int mValueOffset;
+	int mComputedOffset;
+	int mParameterOffset;
 	uint16_t mDataSize = InvalidSize;
 	bool IsValid() { return mDataSize != InvalidSize; }
 	void RequireBuffer(int size) {
@@ -35,7 +37,7 @@ public:
 	}
 	Source* GetSources() const { return (Source*)mBuffer.get(); }
 	Value* GetValues() const { return (Value*)(mBuffer.get() + mValueOffset); }
-	uint8_t* GetParameters() const { return mBuffer.get() + mParameterOffset; }
+	ParameterId* GetParameters() const { return (ParameterId*)(mBuffer.get() + mParameterOffset); }
 	std::span<Value> GetValueArray() const {
 		Value* begin = (Value*)(mBuffer.get() + mValueOffset);
 		Value* end = (Value*)(mBuffer.get() + mComputedOffset);
@@ -120,14 +122,15 @@ class MaterialCollector {
 	static const uint16_t InvalidOffset = (uint16_t)(-1);
 	struct Value : public MaterialEvaluator::Value {
 		Identifier mName;
-		int8_t mParamOffset;
-		int8_t mParamCount;
+		int mParamOffset;
+		int mParamCount;
 	};
 	typedef MaterialEvaluator::Source Source;
-	HybridVector<Source, 16> mSources;
-	HybridVector<Value, 32> mValues;
-	HybridVector<uint8_t, 16> mParameterIds;
-	InplaceVector<uint8_t> mParameterStack;
+	typedef MaterialEvaluator::ParameterId ParameterId;
+	SmallVector<Source, 2> mSources;
+	SmallVector<Value, 2> mValues;
+	SmallVector<ParameterId, 8> mParameterIds;
+	InplaceVector<int> mParameterStack;
 	std::vector<uint8_t> mOutputData;
 	int mValueCount = 0;
 	int mDataSize = 0;
@@ -141,10 +144,10 @@ public:
 	}
 	std::span<const uint8_t> GetUniformSource(const Material* material, Identifier name, MaterialCollectorContext& context) {
 		auto* valuesData = mValues.data();
-		for (int i = 0; i < mValues.size(); ++i) {
+		for (int i = 0; i < (int)mValues.size(); ++i) {
 			auto& value = valuesData[i];
 			if (value.mName != name) continue;
-			if (!mParameterStack.empty()) mParameterIds.push_back((uint8_t)i);
+			if (!mParameterStack.empty()) mParameterIds.push_back((ParameterId)i);
 			const uint8_t* srcData = value.mParamOffset >= 0
 				? mOutputData.data() + value.mOutputOffset
 				: mSources[value.mSourceId].mMaterial->mParameters.GetDataRaw() + value.mValueOffset;
@@ -234,10 +237,11 @@ public:
 	void BuildEvaluator(MaterialEvaluator& cache) {
 		/*int dataOffset = 0;
 		if (!mValues.empty()) { auto& last = mValues.back(); dataOffset = last.mOutputOffset + last.mDataSize; }*/
-		cache.mValueOffset = (uint16_t)(sizeof(MaterialEvaluator::Source) * mSources.size());
-		cache.mComputedOffset = (uint16_t)(cache.mValueOffset + sizeof(MaterialEvaluator::Value) * mValueCount);
-		cache.mParameterOffset = (uint16_t)(cache.mComputedOffset + sizeof(MaterialEvaluator::Value) * (mValues.size() - mValueCount));
-		int size = (int)(cache.mParameterOffset + mParameterIds.size());
+		assert(mValues.size() <= std::numeric_limits<ParameterId>::max() + 1);
+		cache.mValueOffset = (int)(sizeof(MaterialEvaluator::Source) * mSources.size());
+		cache.mComputedOffset = (int)(cache.mValueOffset + sizeof(MaterialEvaluator::Value) * mValueCount);
+		cache.mParameterOffset = (int)(cache.mComputedOffset + sizeof(MaterialEvaluator::Value) * (mValues.size() - mValueCount));
+		int size = (int)(cache.mParameterOffset + sizeof(ParameterId) * mParameterIds.size());
 		cache.RequireBuffer(size);
 		cache.mDataSize = (uint16_t)mDataSize;
 
@@ -293,12 +297,12 @@ private:
 		v.mOutputOffset = InvalidOffset;
 		v.mValueOffset = (uint16_t)(valueData.data() - material->mParameters.GetDataRaw());
 		v.mDataSize = (uint8_t)(valueData.size());
-		v.mSourceId = RequireSource(material);
+		v.mSourceId = (uint16_t)RequireSource(material);
 		v.mName = name;
 		v.mParamOffset = -1;
 		v.mParamCount = -1;
 		mValues.emplace_back(v);
-		if (!mParameterStack.empty()) mParameterIds.push_back((uint8_t)(mValues.size() - 1));
+		if (!mParameterStack.empty()) mParameterIds.push_back((ParameterId)(mValues.size() - 1));
 	}
 	std::span<uint8_t> ConsumeTempData(int dataSize) {
 		mOutputData.resize(mOutputData.size() + dataSize);
@@ -306,19 +310,19 @@ private:
 	}
 	void BeginComputed(const Material* material, Identifier name) {
 		//if (mParameterIds.capacity() < 8) mParameterIds.reserve(8);
-		mParameterStack.push_back((uint8_t)mParameterIds.size());
+		mParameterStack.push_back((int)mParameterIds.size());
 	}
 	void EndComputed(const Material* material, Material::ComputedParameterCollection::const_iterator parameter, std::span<uint8_t> valueData) {
 		int from = mParameterStack.pop_back();
 		Value v;
-		v.mOutputOffset = (uint8_t)(valueData.data() - mOutputData.data());
+		v.mOutputOffset = (uint16_t)(valueData.data() - mOutputData.data());
 		v.mValueOffset = (uint16_t)(&*parameter - material->mComputedParameters.data());
 		v.mDataSize = parameter->second->GetDataSize();
-		v.mSourceId = RequireSource(material);
+		v.mSourceId = (uint16_t)RequireSource(material);
 		v.mName = parameter->first;
 		v.mParamOffset = from;
 		v.mParamCount = (int)(mParameterIds.size() - from);
 		mValues.emplace_back(v);
-		if (!mParameterStack.empty()) mParameterIds.push_back((uint8_t)(mValues.size() - 1));
+		if (!mParameterStack.empty()) mParameterIds.push_back((ParameterId)(mValues.size() - 1));
 	}
 };
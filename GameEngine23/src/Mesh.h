@@ -7,6 +7,9 @@
 
 #include "Material.h"
 #include "Buffer.h"
+#include "MeshBounds.h"
+
+struct MeshletData;
 
 // Store data related to drawing a mesh
 class Mesh
@@ -31,16 +34,26 @@ class Mesh
 	int mRevision;
 
 	BoundingBox mBoundingBox;
+	// Stored positions are transformed by this to get mesh-space positions
+	// (when quantised relative to the bounding box)
+	Vector3 mPositionScale = Vector3::One;
+	Vector3 mPositionOffset = Vector3::Zero;
 
 	int8_t mVertexPositionId;
 	int8_t mVertexNormalId;
 	int8_t mVertexColorId;
+	int8_t mVertexBlendIndicesId;
+	int8_t mVertexBlendWeightsId;
 	std::array<int8_t, 8> mVertexTexCoordId;
 	mutable BufferLayoutPersistent mVertexBinds;
 	mutable BufferLayoutPersistent mIndexBinds;
 
 	std::string mName;
 
+	// Generated by MeshletBuilder (for mesh shader rendering)
+	// Dropped whenever the vertices or indices change, so must be rebuilt
+	std::shared_ptr<MeshletData> mMeshlets;
+
 	int CreateVertexBind(int8_t& id, const char* name, BufferFormat fmt) {
 		assert(id == -1);
 		auto type = BufferFormatType::GetType(fmt);
@@ -69,10 +82,20 @@ class Mesh
 		if (elId == -1) { CreateVertexBind(elId, name, fmt); return; }
 		auto& el = mVertexBinds.GetElements()[elId];
 		if (el.mFormat == fmt) return;
+		// Existing data is converted to the new format
+		std::vector<Vector4> values;
+		if (el.mData != nullptr) {
+			values.resize(GetVertexCount());
+			BufferView(&el).Get(std::span<Vector4>(values));
+		}
 		el.mFormat = fmt;
 		el.mBufferStride = BufferFormatType::GetType(el.mFormat).GetByteSize();
-		if (el.mData != nullptr) Realloc(el, GetVertexCount());
+		if (el.mData != nullptr) {
+			Realloc(el, GetVertexCount());
+			BufferView(&el).Set(std::span<const Vector4>(values));
+		}
 		mVertexBinds.mSize = -1;
+		MarkChanged();
 	}
 
 public:
@@ -82,7 +105,9 @@ public:
 		mIndexBinds(BufferLayoutPersistent((size_t)this + 1, 0, BufferLayout::Usage::Index, 0, 1)),
 		mVertexPositionId(0),
 		mVertexNormalId(-1),
-		mVertexColorId(-1)
+		mVertexColorId(-1),
+		mVertexBlendIndicesId(-1),
+		mVertexBlendWeightsId(-1)
 		//mVertexTexCoordId(-1)
 	{
 		for (auto i = mVertexTexCoordId.begin(); i != mVertexTexCoordId.end(); ++i) *i = -1;
@@ -102,13 +127,22 @@ public:
 	int GetRevision() const { return mRevision; }
 	const BoundingBox& GetBoundingBox() const { return mBoundingBox; }
 	void CalculateBoundingBox() {
-		mBoundingBox.mMin = std::numeric_limits<float>::max();
-		mBoundingBox.mMax = std::numeric_limits<float>::min();
-		for (auto& vec : GetPositionsV()) {
-			Vector3 pos = vec;
-			mBoundingBox.mMin = Vector3::Min(mBoundingBox.mMin, pos);
-			mBoundingBox.mMax = Vector3::Max(mBoundingBox.mMax, pos);
-		}
+		mBoundingBox = MeshBounds::ComputeAABB(GetPositionElement(), GetVertexCount());
+		// An empty mesh keeps an empty box at the origin
+		if (GetVertexCount() == 0) return;
+		mBoundingBox.mMin = mBoundingBox.mMin * mPositionScale + mPositionOffset;
+		mBoundingBox.mMax = mBoundingBox.mMax * mPositionScale + mPositionOffset;
+		// Negative scales swap the corners
+		auto min = Vector3::Min(mBoundingBox.mMin, mBoundingBox.mMax);
+		mBoundingBox.mMax = Vector3::Max(mBoundingBox.mMin, mBoundingBox.mMax);
+		mBoundingBox.mMin = min;
+	}
+	const Vector3& GetPositionScale() const { return mPositionScale; }
+	const Vector3& GetPositionOffset() const { return mPositionOffset; }
+	// Positions are stored quantised; shaders must apply this transform
+	void SetPositionDequantization(Vector3 scale, Vector3 offset) {
+		mPositionScale = scale;
+		mPositionOffset = offset;
 	}
 
 	int GetVertexCount() const { return mVertexBinds.mCount; }
@@ -126,6 +160,17 @@ public:
 	void RequireVertexColors(BufferFormat fmt = BufferFormat::FORMAT_R8G8B8A8_UNORM) {
 		RequireVertexElementFormat(mVertexColorId, fmt, "COLOR");
 	}
+	// Up to 4 joints per vertex (indices into Model::Skin)
+	void RequireVertexBlendIndices(BufferFormat fmt = BufferFormat::FORMAT_R8G8B8A8_UINT) {
+		RequireVertexElementFormat(mVertexBlendIndicesId, fmt, "BLENDINDICES");
+	}
+	void RequireVertexBlendWeights(BufferFormat fmt = BufferFormat::FORMAT_R8G8B8A8_UNORM) {
+		RequireVertexElementFormat(mVertexBlendWeightsId, fmt, "BLENDWEIGHT");
+	}
+	// 16-bit indices can address up to 65536 vertices
+	static bool RequiresIndex32(int vertexCount) { return vertexCount > 0x10000; }
+	bool GetIndex32() const { return mIndexBinds.GetElements()[0].mFormat == BufferFormat::FORMAT_R32_UINT; }
+	// Note: Clears existing indices
 	void SetIndexFormat(bool _32bit) {
 		SetIndexCount(0);
 		auto& el = mIndexBinds.GetElements()[0];
@@ -134,13 +179,24 @@ public:
 		mIndexBinds.CalculateImplicitSize();
 	}
 
+	// Use the narrowest index format that can address all vertices (keeps indices)
+	void RequireNarrowestIndexFormat() {
+		bool _32bit = RequiresIndex32(GetVertexCount());
+		if (GetIndex32() == _32bit) return;
+		std::vector<int> indices(GetIndexCount());
+		auto indicesV = GetIndicesV();
+		for (int i = 0; i < (int)indices.size(); ++i) indices[i] = indicesV[i];
+		SetIndexFormat(_32bit);
+		SetIndices(indices);
+		MarkChanged();
+	}
+
 	void SetVertexCount(int count)
 	{
 		if (mVertexBinds.mCount == count) return;
 		for (auto& binding : mVertexBinds.GetElements())
 			Realloc(binding, count);
 		mVertexBinds.mCount = count;
-		mVertexBinds.mRevision++;
 		mVertexBinds.CalculateImplicitSize();
 		MarkChanged();
 	}
@@ -150,7 +206,6 @@ public:
 		for (auto& binding : mIndexBinds.GetElements())
 			Realloc(binding, count);
 		mIndexBinds.mCount = count;
-		mIndexBinds.mRevision++;
 		mIndexBinds.CalculateImplicitSize();
 		MarkChanged();
 	}
@@ -159,8 +214,15 @@ public:
 	{
 		SetIndexCount((int)indices.size());
 		GetIndicesV().Set(indices);
+		MarkIndicesChanged(RangeInt(0, (int)indices.size()));
 	}
 
+	const BufferLayout::Element& GetPositionElement() const {
+		return mVertexBinds.GetElements()[mVertexPositionId];
+	}
+	// Writes through these views are not tracked: follow them with
+	// MarkVerticesChanged/MarkIndicesChanged so only the written range
+	// uploads, or MarkChanged() to upload everything
 	TypedBufferView<Vector3> GetPositionsV() {
 		return TypedBufferView<Vector3>(&mVertexBinds.GetElements()[mVertexPositionId], mVertexBinds.mCount);
 	}
@@ -176,10 +238,61 @@ public:
 		if (mVertexColorId == -1) { if (require) RequireVertexColors(); else return { }; }
 		return TypedBufferView<ColorB4>(&mVertexBinds.GetElements()[mVertexColorId], mVertexBinds.mCount);
 	}
+	TypedBufferView<Int4> GetBlendIndicesV(bool require = false) {
+		if (mVertexBlendIndicesId == -1) { if (require) RequireVertexBlendIndices(); else return { }; }
+		return TypedBufferView<Int4>(&mVertexBinds.GetElements()[mVertexBlendIndicesId], mVertexBinds.mCount);
+	}
+	TypedBufferView<Vector4> GetBlendWeightsV(bool require = false) {
+		if (mVertexBlendWeightsId == -1) { if (require) RequireVertexBlendWeights(); else return { }; }
+		return TypedBufferView<Vector4>(&mVertexBinds.GetElements()[mVertexBlendWeightsId], mVertexBinds.mCount);
+	}
 	TypedBufferView<int> GetIndicesV(bool require = false) {
 		return TypedBufferView<int>(&mIndexBinds.GetElements()[0], mIndexBinds.mCount);
 	}
 
+	// Create a mesh with the same vertex elements and material, containing
+	// the specified vertices (vertices[newIndex] = oldIndex) and indices
+	std::shared_ptr<Mesh> CreateSubmesh(const std::string& name, std::span<const int> vertices, std::span<const int> indices) const {
+		auto mesh = std::make_shared<Mesh>(name);
+		auto srcElements = mVertexBinds.GetElements();
+		// Element 0 is always POSITION
+		mesh->mVertexBinds.GetElements()[0].mFormat = srcElements[0].mFormat;
+		mesh->mVertexBinds.GetElements()[0].mBufferStride = srcElements[0].GetItemByteSize();
+		for (int e = 1; e < (int)srcElements.size(); ++e) {
+			auto& src = srcElements[e];
+			mesh->mVertexBinds.AppendElement(BufferLayout::Element(src.mBindName, src.mFormat, src.GetItemByteSize(), nullptr));
+		}
+		mesh->mVertexNormalId = mVertexNormalId;
+		mesh->mVertexColorId = mVertexColorId;
+		mesh->mVertexBlendIndicesId = mVertexBlendIndicesId;
+		mesh->mVertexBlendWeightsId = mVertexBlendWeightsId;
+		mesh->mVertexTexCoordId = mVertexTexCoordId;
+		mesh->SetVertexCount((int)vertices.size());
+		auto dstElements = mesh->mVertexBinds.GetElements();
+		for (int e = 0; e < (int)srcElements.size(); ++e) {
+			auto& src = srcElements[e];
+			auto& dst = dstElements[e];
+			if (src.mData == nullptr || dst.mData == nullptr) continue;
+			for (int v = 0; v < (int)vertices.size(); ++v) {
+				std::memcpy((uint8_t*)dst.mData + v * dst.mBufferStride,
+					(const uint8_t*)src.mData + vertices[v] * src.mBufferStride,
+					dst.mBufferStride);
+			}
+		}
+		mesh->mVertexBinds.CalculateImplicitSize();
+		mesh->SetIndexFormat(RequiresIndex32((int)vertices.size()));
+		mesh->SetIndices(indices);
+		mesh->mMaterial = mMaterial;
+		mesh->SetPositionDequantization(mPositionScale, mPositionOffset);
+		mesh->MarkChanged();
+		mesh->CalculateBoundingBox();
+		return mesh;
+	}
+
+	// nullptr if not built, or if the mesh has changed since
+	const std::shared_ptr<MeshletData>& GetMeshlets() const { return mMeshlets; }
+	void SetMeshlets(const std::shared_ptr<MeshletData>& meshlets) { mMeshlets = meshlets; }
+
 	BufferLayoutPersistent& GetVertexBuffer() const { return mVertexBinds; }
 	BufferLayoutPersistent& GetIndexBuffer() const { return mIndexBinds; }
 
@@ -194,8 +307,20 @@ public:
 	// Notify graphics and other dependents that the mesh data has changed
 	void MarkChanged() {
 		mRevision++;
-		mVertexBinds.mRevision++;
-		mIndexBinds.mRevision++;
+		mMeshlets.reset();
+		mVertexBinds.MarkChanged();
+		mIndexBinds.MarkChanged();
+	}
+	// Only these vertices/indices were written, allowing a partial upload
+	void MarkVerticesChanged(RangeInt vertexRange) {
+		mRevision++;
+		mMeshlets.reset();
+		mVertexBinds.MarkChanged(vertexRange);
+	}
+	void MarkIndicesChanged(RangeInt indexRange) {
+		mRevision++;
+		mMeshlets.reset();
+		mIndexBinds.MarkChanged(indexRange);
 	}
 
 private:
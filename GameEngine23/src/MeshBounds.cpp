@@ -0,0 +1,184 @@
+#include "MeshBounds.h"
+
+#include "Mesh.h"
+#include "BufferConversion.h"
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <limits>
+#include <cmath>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#define SIMD_TARGET(x)
+#else
+#define SIMD_TARGET(x) __attribute__((target(x)))
+#endif
+
+namespace {
+	// Chunk size for threading, and block size for decoded fallbacks
+	const int ChunkSize = 64 * 1024;
+	const int BlockSize = 256;
+
+	struct Range {
+		__m128 mMin, mMax;
+		static Range Empty() {
+			return { _mm_set1_ps(std::numeric_limits<float>::max()), _mm_set1_ps(std::numeric_limits<float>::lowest()), };
+		}
+		// Value first, so that NaN components are ignored
+		void Append(__m128 v) { mMin = _mm_min_ps(v, mMin); mMax = _mm_max_ps(v, mMax); }
+		void Append(const Range& o) { mMin = _mm_min_ps(o.mMin, mMin); mMax = _mm_max_ps(o.mMax, mMax); }
+	};
+
+	// 3 or 4 float components
+	SIMD_TARGET("sse2") Range ReduceFloat(const uint8_t* data, int stride, int count, int components) {
+		Range r0 = Range::Empty(), r1 = Range::Empty();
+		// The final item of a float3 stream cannot be read with a 16 byte load
+		int safeCount = components >= 4 ? count : count - 1;
+		int i = 0;
+		for (; i + 1 < safeCount; i += 2, data += stride * 2) {
+			r0.Append(_mm_loadu_ps((const float*)data));
+			r1.Append(_mm_loadu_ps((const float*)(data + stride)));
+		}
+		for (; i < count; ++i, data += stride) {
+			auto* f = (const float*)data;
+			r0.Append(i < safeCount ? _mm_loadu_ps(f) : _mm_setr_ps(f[0], f[1], f[2], f[0]));
+		}
+		r0.Append(r1);
+		return r0;
+	}
+
+	// 4x 16-bit integers; unsigned values are biased to use signed min/max
+	template<bool Signed>
+	SIMD_TARGET("sse2") Range Reduce16(BufferFormat format, const uint8_t* data, int stride, int count) {
+		const __m128i bias = _mm_set1_epi16(Signed ? 0 : (short)0x8000);
+		__m128i min = _mm_set1_epi16(0x7fff), max = _mm_set1_epi16((short)0x8000);
+		for (int i = 0; i < count; ++i, data += stride) {
+			__m128i v = _mm_xor_si128(_mm_loadl_epi64((const __m128i*)data), bias);
+			min = _mm_min_epi16(min, v);
+			max = _mm_max_epi16(max, v);
+		}
+		// Convert the two results with the same rules as BufferView
+		uint16_t values[8];
+		_mm_storel_epi64((__m128i*)values, _mm_xor_si128(min, bias));
+		_mm_storel_epi64((__m128i*)(values + 4), _mm_xor_si128(max, bias));
+		BufferLayout::Element element(Identifier(), format, 8, values);
+		Vector4 result[2];
+		BufferView(&element).Get(std::span<Vector4>(result));
+		return { _mm_loadu_ps(&result[0].x), _mm_loadu_ps(&result[1].x), };
+	}
+
+	SIMD_TARGET("sse2,f16c") Range ReduceHalf(const uint8_t* data, int stride, int count) {
+		Range r0 = Range::Empty(), r1 = Range::Empty();
+		int i = 0;
+		for (; i + 1 < count; i += 2, data += stride * 2) {
+			r0.Append(_mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)data)));
+			r1.Append(_mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)(data + stride))));
+		}
+		if (i < count) r0.Append(_mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)data)));
+		r0.Append(r1);
+		return r0;
+	}
+
+	// Any other format, decoded a block at a time
+	Range ReduceDecoded(const BufferLayout::Element& element, int offset, int count) {
+		Range range = Range::Empty();
+		Vector4 block[BlockSize];
+		BufferView view(&element);
+		for (int b = 0; b < count; b += BlockSize) {
+			int n = std::min(BlockSize, count - b);
+			view.Get(std::span<Vector4>(block, n), offset + b);
+			range.Append(ReduceFloat((const uint8_t*)block, sizeof(Vector4), n, 4));
+		}
+		return range;
+	}
+
+	Range Reduce(const BufferLayout::Element& element, int offset, int count) {
+		auto* data = (const uint8_t*)element.mData + (size_t)offset * element.mBufferStride;
+		int stride = element.mBufferStride;
+		switch (element.mFormat) {
+		case FORMAT_R32G32B32_FLOAT: return ReduceFloat(data, stride, count, 3);
+		case FORMAT_R32G32B32A32_FLOAT: return ReduceFloat(data, stride, count, 4);
+		case FORMAT_R16G16B16A16_UNORM:
+		case FORMAT_R16G16B16A16_UINT: return Reduce16<false>(element.mFormat, data, stride, count);
+		case FORMAT_R16G16B16A16_SNORM:
+		case FORMAT_R16G16B16A16_SINT: return Reduce16<true>(element.mFormat, data, stride, count);
+		case FORMAT_R16G16B16A16_FLOAT:
+			if (BufferConversion::GetCpuFeatures().mF16C) return ReduceHalf(data, stride, count);
+			break;
+		default: break;
+		}
+		return ReduceDecoded(element, offset, count);
+	}
+
+	template<class Fn>
+	void ForEachChunk(int count, Fn&& fn) {
+		if (count < MeshBounds::ParallelThreshold) { fn(0, 0, count); return; }
+		std::vector<int> chunks((count + ChunkSize - 1) / ChunkSize);
+		std::iota(chunks.begin(), chunks.end(), 0);
+		std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](int c) {
+			fn(c, c * ChunkSize, std::min(ChunkSize, count - c * ChunkSize));
+		});
+	}
+	int GetChunkCount(int count) {
+		return count < MeshBounds::ParallelThreshold ? 1 : (count + ChunkSize - 1) / ChunkSize;
+	}
+}
+
+BoundingBox MeshBounds::ComputeAABB(const BufferLayout::Element& element, int count) {
+	if (count <= 0 || element.mData == nullptr) return BoundingBox();
+	std::vector<Range> ranges(GetChunkCount(count));
+	ForEachChunk(count, [&](int c, int offset, int n) { ranges[c] = Reduce(element, offset, n); });
+	Range range = Range::Empty();
+	for (auto& item : ranges) range.Append(item);
+	alignas(16) float min[4], max[4];
+	_mm_store_ps(min, range.mMin);
+	_mm_store_ps(max, range.mMax);
+	return BoundingBox(Vector3(min[0], min[1], min[2]), Vector3(max[0], max[1], max[2]));
+}
+
+float MeshBounds::ComputeRadius(const BufferLayout::Element& element, int count, Vector3 centre, Vector3 scale) {
+	if (count <= 0 || element.mData == nullptr) return 0.0f;
+	std::vector<float> radii(GetChunkCount(count), 0.0f);
+	ForEachChunk(count, [&](int c, int offset, int n) {
+		const __m128 vcentre = _mm_setr_ps(centre.x, centre.y, centre.z, 0.0f);
+		const __m128 vscale = _mm_setr_ps(scale.x, scale.y, scale.z, 0.0f);
+		__m128 maxDist2 = _mm_setzero_ps();
+		Vector4 block[BlockSize];
+		BufferView view(&element);
+		for (int b = 0; b < n; b += BlockSize) {
+			int bn = std::min(BlockSize, n - b);
+			view.Get(std::span<Vector4>(block, bn), offset + b);
+			for (int i = 0; i < bn; ++i) {
+				__m128 d = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&block[i].x), vcentre), vscale);
+				d = _mm_mul_ps(d, d);
+				// Horizontal sum of xyz (w is scaled by 0)
+				d = _mm_add_ps(d, _mm_movehl_ps(d, d));
+				d = _mm_add_ss(d, _mm_shuffle_ps(d, d, 1));
+				maxDist2 = _mm_max_ss(d, maxDist2);
+			}
+		}
+		radii[c] = std::sqrt(_mm_cvtss_f32(maxDist2));
+	});
+	return *std::max_element(radii.begin(), radii.end());
+}
+
+BoundingSphere MeshBounds::ComputeSphere(const Mesh& mesh) {
+	auto& bounds = mesh.GetBoundingBox();
+	BoundingSphere sphere = { bounds.Centre(), 0.0f, };
+	// Measure in stored units, so quantised positions are not decoded twice
+	auto scale = mesh.GetPositionScale();
+	Vector3 centre = sphere.mCentre - mesh.GetPositionOffset();
+	centre.x = scale.x != 0.0f ? centre.x / scale.x : 0.0f;
+	centre.y = scale.y != 0.0f ? centre.y / scale.y : 0.0f;
+	centre.z = scale.z != 0.0f ? centre.z / scale.z : 0.0f;
+	sphere.mRadius = ComputeRadius(mesh.GetPositionElement(), mesh.GetVertexCount(), centre, scale);
+	return sphere;
+}
+
+void MeshBounds::CalculateBoundingBoxes(std::span<const std::shared_ptr<Mesh>> meshes) {
+	std::for_each(std::execution::par, meshes.begin(), meshes.end(), [](const std::shared_ptr<Mesh>& mesh) {
+		mesh->CalculateBoundingBox();
+	});
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <span>
+#include <memory>
+
+#include "MathTypes.h"
+#include "Buffer.h"
+
+class Mesh;
+
+struct BoundingSphere {
+	Vector3 mCentre;
+	float mRadius;
+};
+
+// Bounding volumes read directly from a position stream
+// Float32 and 16-bit (unorm, snorm, int, half) positions are reduced
+// with SSE; other formats are decoded in blocks first
+class MeshBounds
+{
+public:
+	// Streams larger than this are split across threads
+	static const int ParallelThreshold = 128 * 1024;
+
+	// Bounds of the first `count` items, in stored (possibly quantised)
+	// units. Returns an empty box at the origin if count is 0
+	static BoundingBox ComputeAABB(const BufferLayout::Element& element, int count);
+	// Largest distance from `centre` (in stored units) after each
+	// axis is multiplied by `scale`
+	static float ComputeRadius(const BufferLayout::Element& element, int count, Vector3 centre, Vector3 scale = Vector3::One);
+
+	// Sphere around the mesh bounding box centre, in mesh space
+	// (CalculateBoundingBox must have been called)
+	static BoundingSphere ComputeSphere(const Mesh& mesh);
+	// Update the bounding box of each mesh, in parallel
+	static void CalculateBoundingBoxes(std::span<const std::shared_ptr<Mesh>> meshes);
+};
@@ -0,0 +1,333 @@
+#include "MeshOptimizer.h"
+
+#include "Mesh.h"
+#include "GraphicsUtility.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+// Scoring parameters from "Linear-Speed Vertex Cache Optimisation" (Forsyth)
+namespace {
+	const int ScoreCacheSize = 32;
+	const int MaxValenceScore = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	struct ScoreTables {
+		float mCache[ScoreCacheSize];
+		float mValence[MaxValenceScore];
+		ScoreTables() {
+			for (int i = 0; i < ScoreCacheSize; ++i) {
+				// The most recent triangle gets a fixed score so that
+				// its verts are not immediately reused (favours strips)
+				mCache[i] = i < 3 ? LastTriScore
+					: std::pow(1.0f - (float)(i - 3) / (ScoreCacheSize - 3), CacheDecayPower);
+			}
+			mValence[0] = 0.0f;
+			for (int i = 1; i < MaxValenceScore; ++i) {
+				mValence[i] = ValenceBoostScale * std::pow((float)i, -ValenceBoostPower);
+			}
+		}
+		float GetScore(int cachePosition, int remaining) const {
+			// Vertex is no longer referenced
+			if (remaining == 0) return -1.0f;
+			float score = cachePosition >= 0 ? mCache[cachePosition] : 0.0f;
+			score += remaining < MaxValenceScore ? mValence[remaining]
+				: ValenceBoostScale * std::pow((float)remaining, -ValenceBoostPower);
+			return score;
+		}
+	};
+	const ScoreTables gScoreTables;
+
+	// Rounding also merges -0 and +0. Clamped (NaN to the lower bound)
+	// so that large values or tiny epsilons cannot overflow the cast
+	int64_t QuantiseWeldKey(float value, double scale) {
+		const double Limit = 4.0e18;
+		double scaled = std::round(value * scale);
+		if (!(scaled > -Limit)) return -(int64_t)Limit;
+		if (scaled > Limit) return (int64_t)Limit;
+		return (int64_t)scaled;
+	}
+}
+
+MeshOptimizer::CacheStatistics MeshOptimizer::AnalyzeVertexCache(std::span<const int> indices, int vertexCount, int cacheSize) {
+	CacheStatistics stats;
+	if (indices.size() < 3 || vertexCount == 0) return stats;
+	// A vertex is in the FIFO if it was inserted within the last cacheSize misses
+	std::vector<int> timestamps(vertexCount, 0);
+	int timestamp = cacheSize + 1;
+	int misses = 0;
+	for (auto index : indices) {
+		if (timestamp - timestamps[index] > cacheSize) {
+			timestamps[index] = timestamp++;
+			++misses;
+		}
+	}
+	stats.mACMR = (float)misses / (float)(indices.size() / 3);
+	stats.mATVR = (float)misses / (float)vertexCount;
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::span<int> indices, int vertexCount) {
+	int triCount = (int)indices.size() / 3;
+	if (triCount <= 1) return;
+
+	// Triangles adjacent to each vertex; the first mRemaining[v]
+	// entries of each vertex's range are the not-yet-emitted ones
+	std::vector<int> adjacencyOffsets(vertexCount + 1, 0);
+	std::vector<int> remaining(vertexCount, 0);
+	for (int i = 0; i < triCount * 3; ++i) remaining[indices[i]]++;
+	for (int v = 0; v < vertexCount; ++v) adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+	std::vector<int> adjacency(triCount * 3);
+	{
+		std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (int i = 0; i < triCount * 3; ++i) adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (int v = 0; v < vertexCount; ++v) vertexScores[v] = gScoreTables.GetScore(-1, remaining[v]);
+
+	std::vector<float> triScores(triCount);
+	std::vector<uint8_t> emitted(triCount, 0);
+	int bestTri = 0;
+	for (int t = 0; t < triCount; ++t) {
+		auto* tri = &indices[t * 3];
+		triScores[t] = vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+		if (triScores[t] > triScores[bestTri]) bestTri = t;
+	}
+
+	std::vector<int> output(triCount * 3);
+	// Room for the current cache plus the 3 newly inserted vertices
+	int cache[ScoreCacheSize + 3];
+	int cacheCount = 0;
+	int scanPosition = 0;
+	for (int o = 0; o < triCount; ++o) {
+		// Dead end, no cached vertex has triangles left; take the next in input order
+		if (bestTri < 0) {
+			while (emitted[scanPosition]) ++scanPosition;
+			bestTri = scanPosition;
+		}
+		auto* tri = &indices[bestTri * 3];
+		std::memcpy(&output[o * 3], tri, sizeof(int) * 3);
+		emitted[bestTri] = 1;
+
+		// Remove the triangle from its vertices' adjacency
+		for (int i = 0; i < 3; ++i) {
+			int v = tri[i];
+			auto* adj = &adjacency[adjacencyOffsets[v]];
+			auto* end = adj + remaining[v];
+			auto* it = std::find(adj, end, bestTri);
+			if (it == end) continue;	// Degenerate triangle, already removed
+			std::swap(*it, *(end - 1));
+			remaining[v]--;
+		}
+
+		// Move the triangle's vertices to the front of the LRU cache
+		int newCache[ScoreCacheSize + 3];
+		int newCount = 0;
+		for (int i = 0; i < 3; ++i) {
+			if (std::find(newCache, newCache + newCount, tri[i]) == newCache + newCount)
+				newCache[newCount++] = tri[i];
+		}
+		for (int i = 0; i < cacheCount; ++i) {
+			int v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2]) newCache[newCount++] = v;
+		}
+
+		// Rescore the touched vertices; those pushed out of the cache lose their bonus
+		for (int i = 0; i < newCount; ++i) {
+			int v = newCache[i];
+			cachePosition[v] = i < ScoreCacheSize ? i : -1;
+			vertexScores[v] = gScoreTables.GetScore(cachePosition[v], remaining[v]);
+		}
+
+		// Rescore triangles of the cached vertices and pick the best
+		bestTri = -1;
+		float bestScore = -1.0f;
+		for (int i = 0; i < newCount; ++i) {
+			int v = newCache[i];
+			auto* adj = &adjacency[adjacencyOffsets[v]];
+			for (int a = 0; a < remaining[v]; ++a) {
+				int t = adj[a];
+				auto* ttri = &indices[t * 3];
+				float score = vertexScores[ttri[0]] + vertexScores[ttri[1]] + vertexScores[ttri[2]];
+				triScores[t] = score;
+				if (score > bestScore) { bestScore = score; bestTri = t; }
+			}
+		}
+
+		cacheCount = std::min(newCount, ScoreCacheSize);
+		std::memcpy(cache, newCache, sizeof(int) * cacheCount);
+	}
+	std::copy(output.begin(), output.end(), indices.begin());
+}
+
+int MeshOptimizer::GenerateVertexRemap(const BufferLayout& vbuffer, std::span<int> remap) {
+	return GenerateVertexRemap(vbuffer, remap, WeldSettings());
+}
+int MeshOptimizer::GenerateVertexRemap(const BufferLayout& vbuffer, std::span<int> remap, const WeldSettings& settings) {
+	int count = vbuffer.mCount;
+	assert((int)remap.size() >= count);
+	if (count == 0) return 0;
+
+	// Gather each vertex into a contiguous key; quantised
+	// elements are stored as 4 rounded int64s per vertex
+	struct KeyElement {
+		const BufferLayout::Element* mElement;
+		int mOffset;
+		float mEpsilon;
+	};
+	std::vector<KeyElement> keyElements;
+	int keySize = 0;
+	for (auto& element : vbuffer.GetElements()) {
+		if (element.mData == nullptr) continue;
+		float epsilon =
+			element.mBindName == "POSITION" ? settings.mPositionEpsilon :
+			element.mBindName == "NORMAL" ? settings.mNormalEpsilon :
+			0.0f;
+		keyElements.push_back({ &element, keySize, epsilon, });
+		keySize += epsilon > 0.0f ? sizeof(int64_t) * 4 : element.GetItemByteSize();
+	}
+	std::vector<uint8_t> keys((size_t)keySize * count);
+	std::vector<Vector4> values;
+	for (auto& keyElement : keyElements) {
+		auto* element = keyElement.mElement;
+		auto* dest = keys.data() + keyElement.mOffset;
+		if (keyElement.mEpsilon > 0.0f) {
+			values.resize(count);
+			BufferView(element).Get(std::span<Vector4>(values));
+			double scale = 1.0 / keyElement.mEpsilon;
+			for (int v = 0; v < count; ++v, dest += keySize) {
+				auto& value = values[v];
+				int64_t quantised[4] = {
+					QuantiseWeldKey(value.x, scale), QuantiseWeldKey(value.y, scale),
+					QuantiseWeldKey(value.z, scale), QuantiseWeldKey(value.w, scale),
+				};
+				std::memcpy(dest, quantised, sizeof(quantised));
+			}
+		}
+		else {
+			int itemSize = element->GetItemByteSize();
+			auto* src = (const uint8_t*)element->mData;
+			for (int v = 0; v < count; ++v, dest += keySize, src += element->mBufferStride)
+				std::memcpy(dest, src, itemSize);
+		}
+	}
+
+	// Open addressing with linear probing; a hash match is only
+	// accepted if the full key compares equal
+	int tableSize = 16;
+	while (tableSize < count * 2) tableSize <<= 1;
+	const int tableMask = tableSize - 1;
+	std::vector<int> table(tableSize, -1);
+	int uniqueCount = 0;
+	for (int v = 0; v < count; ++v) {
+		auto* key = keys.data() + (size_t)v * keySize;
+		size_t hash = AppendHash(key, keySize, 0);
+		int slot = (int)(hash ^ (hash >> 29)) & tableMask;
+		for (; table[slot] >= 0; slot = (slot + 1) & tableMask) {
+			if (std::memcmp(keys.data() + (size_t)table[slot] * keySize, key, keySize) == 0) break;
+		}
+		if (table[slot] < 0) {
+			table[slot] = v;
+			remap[v] = uniqueCount++;
+		}
+		else {
+			remap[v] = remap[table[slot]];
+		}
+	}
+	return uniqueCount;
+}
+
+int MeshOptimizer::OptimizeVertexFetchRemap(std::span<int> indices, std::span<int> remap) {
+	std::fill(remap.begin(), remap.end(), -1);
+	int next = 0;
+	for (auto& index : indices) {
+		auto& newIndex = remap[index];
+		if (newIndex < 0) newIndex = next++;
+		index = newIndex;
+	}
+	return next;
+}
+
+void MeshOptimizer::RemapVertices(BufferLayoutPersistent& vbuffer, std::span<const int> remap) {
+	std::vector<uint8_t> source;
+	for (auto& element : vbuffer.GetElements()) {
+		if (element.mData == nullptr) continue;
+		int stride = element.mBufferStride;
+		int itemSize = element.GetItemByteSize();
+		source.resize((size_t)stride * remap.size());
+		std::memcpy(source.data(), element.mData, source.size());
+		auto* dest = (uint8_t*)element.mData;
+		// Backwards so the first of any merged vertices is written last
+		for (int v = (int)remap.size() - 1; v >= 0; --v) {
+			if (remap[v] < 0) continue;
+			std::memcpy(dest + (size_t)remap[v] * stride, source.data() + (size_t)v * stride, itemSize);
+		}
+	}
+}
+
+std::vector<std::shared_ptr<Mesh>> MeshOptimizer::SplitMesh(Mesh& mesh, int maxVertices) {
+	std::vector<std::shared_ptr<Mesh>> parts;
+	auto indicesV = mesh.GetIndicesV();
+	std::vector<int> indices(indicesV.size());
+	for (int i = 0; i < (int)indices.size(); ++i) indices[i] = indicesV[i];
+
+	// Index of each source vertex within the current part
+	std::vector<int> vertexMap(mesh.GetVertexCount(), -1);
+	std::vector<int> partVertices;
+	std::vector<int> partIndices;
+	auto FlushPart = [&]() {
+		if (partIndices.empty()) return;
+		parts.push_back(mesh.CreateSubmesh(mesh.GetName() + "_" + std::to_string(parts.size()), partVertices, partIndices));
+		for (auto v : partVertices) vertexMap[v] = -1;
+		partVertices.clear();
+		partIndices.clear();
+	};
+	for (int t = 0; t + 2 < (int)indices.size(); t += 3) {
+		auto* tri = &indices[t];
+		int newVerts = 0;
+		for (int i = 0; i < 3; ++i) {
+			if (vertexMap[tri[i]] < 0 && (i < 1 || tri[i] != tri[0]) && (i < 2 || tri[i] != tri[1])) ++newVerts;
+		}
+		if ((int)partVertices.size() + newVerts > maxVertices) FlushPart();
+		for (int i = 0; i < 3; ++i) {
+			auto& mapped = vertexMap[tri[i]];
+			if (mapped < 0) {
+				mapped = (int)partVertices.size();
+				partVertices.push_back(tri[i]);
+			}
+			partIndices.push_back(mapped);
+		}
+	}
+	FlushPart();
+	return parts;
+}
+
+MeshOptimizer::Report MeshOptimizer::Optimize(Mesh& mesh) {
+	Report report;
+	int vertexCount = report.mVertexCountBefore = report.mVertexCountAfter = mesh.GetVertexCount();
+	auto indicesV = mesh.GetIndicesV();
+	std::vector<int> indices(indicesV.size());
+	for (int i = 0; i < (int)indices.size(); ++i) indices[i] = indicesV[i];
+	report.mBefore = report.mAfter = AnalyzeVertexCache(indices, vertexCount);
+	if (indices.size() < 3) return report;
+
+	OptimizeVertexCache(indices, vertexCount);
+
+	std::vector<int> remap(vertexCount);
+	int newCount = OptimizeVertexFetchRemap(indices, remap);
+	RemapVertices(mesh.GetVertexBuffer(), remap);
+	mesh.SetVertexCount(newCount);
+	mesh.SetIndices(indices);
+	mesh.MarkChanged();
+
+	report.mVertexCountAfter = newCount;
+	report.mAfter = AnalyzeVertexCache(indices, newCount);
+	return report;
+}
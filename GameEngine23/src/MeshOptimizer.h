@@ -0,0 +1,68 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <memory>
+
+#include "Buffer.h"
+
+class Mesh;
+
+// Reorders mesh triangles and vertices so the GPU caches
+// are used more effectively (for vertex-bound meshes)
+class MeshOptimizer
+{
+public:
+	// Size of the post-transform cache simulated for statistics
+	static const int DefaultCacheSize = 16;
+
+	struct CacheStatistics {
+		// Average vertices transformed per triangle (1.0 is ideal-ish, 3.0 is worst)
+		float mACMR = 0.0f;
+		// Average times each vertex is transformed (1.0 is ideal)
+		float mATVR = 0.0f;
+	};
+	struct Report {
+		CacheStatistics mBefore;
+		CacheStatistics mAfter;
+		int mVertexCountBefore = 0;
+		int mVertexCountAfter = 0;
+	};
+
+	struct WeldSettings {
+		// Quantise POSITION/NORMAL to this grid before comparing (0 = exact).
+		// Values straddling a grid boundary are not merged
+		float mPositionEpsilon = 0.0f;
+		float mNormalEpsilon = 0.0f;
+	};
+
+	// Find identical vertices across all elements of the buffer.
+	// remap[vertex] = index of its unique vertex (in first-occurrence
+	// order), apply with RemapVertices. Returns the unique vertex count
+	static int GenerateVertexRemap(const BufferLayout& vbuffer, std::span<int> remap);
+	static int GenerateVertexRemap(const BufferLayout& vbuffer, std::span<int> remap, const WeldSettings& settings);
+
+	// Simulate a FIFO post-transform cache over the triangle list
+	static CacheStatistics AnalyzeVertexCache(std::span<const int> indices, int vertexCount, int cacheSize = DefaultCacheSize);
+
+	// Reorder triangles for post-transform cache locality (Forsyth's
+	// linear-speed algorithm). Winding of each triangle is preserved
+	static void OptimizeVertexCache(std::span<int> indices, int vertexCount);
+
+	// Number vertices in the order they are first referenced and rewrite
+	// the indices. remap[oldVertex] = newVertex, or -1 if unreferenced.
+	// Returns the number of referenced vertices
+	static int OptimizeVertexFetchRemap(std::span<int> indices, std::span<int> remap);
+
+	// Move every element of the buffer according to the remap table
+	// (must be called before the buffer is shrunk to the new count).
+	// If several vertices map to the same index, the first is kept
+	static void RemapVertices(BufferLayoutPersistent& vbuffer, std::span<const int> remap);
+
+	// Split a mesh into parts of at most maxVertices vertices (so that
+	// each can use 16-bit indices). Triangle order is preserved
+	static std::vector<std::shared_ptr<Mesh>> SplitMesh(Mesh& mesh, int maxVertices = 0x10000);
+
+	// Optimise triangle order and then vertex order of a mesh
+	static Report Optimize(Mesh& mesh);
+};
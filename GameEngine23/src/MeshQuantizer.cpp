@@ -0,0 +1,137 @@
+#include "MeshQuantizer.h"
+
+#include "Mesh.h"
+#include "BufferConversion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static float SignNotZero(float v) { return v >= 0.0f ? 1.0f : -1.0f; }
+
+Vector2 MeshQuantizer::OctEncode(Vector3 normal) {
+	float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (l1 <= 0.0f) return Vector2::Zero;
+	normal /= l1;
+	if (normal.z >= 0.0f) return Vector2(normal.x, normal.y);
+	// Fold the lower hemisphere over the diagonals
+	return Vector2(
+		(1.0f - std::abs(normal.y)) * SignNotZero(normal.x),
+		(1.0f - std::abs(normal.x)) * SignNotZero(normal.y)
+	);
+}
+Vector3 MeshQuantizer::OctDecode(Vector2 encoded) {
+	Vector3 normal(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+	float t = std::max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -t : t;
+	normal.y += normal.y >= 0.0f ? -t : t;
+	return normal.Normalize();
+}
+Int2 MeshQuantizer::OctEncodeSnorm16(Vector3 normal) {
+	const float Max = 32767.0f;
+	auto encoded = OctEncode(normal) * Max;
+	Int2 base((int)std::floor(encoded.x), (int)std::floor(encoded.y));
+	Int2 best = base;
+	float bestDot = -2.0f;
+	// Try each of the 4 surrounding grid points
+	for (int i = 0; i < 4; ++i) {
+		Int2 candidate(
+			std::clamp(base.x + (i & 1), -32767, 32767),
+			std::clamp(base.y + (i >> 1), -32767, 32767)
+		);
+		float dot = OctDecode(Vector2((float)candidate.x, (float)candidate.y) / Max).Dot(normal);
+		if (dot > bestDot) { bestDot = dot; best = candidate; }
+	}
+	return best;
+}
+
+MeshQuantizer::Report MeshQuantizer::Quantize(Mesh& mesh) {
+	return Quantize(mesh, Settings());
+}
+MeshQuantizer::Report MeshQuantizer::Quantize(Mesh& mesh, const Settings& settings) {
+	Report report;
+	report.mVertexSizeBefore = mesh.GetVertexBuffer().CalculateBufferStride();
+	int count = mesh.GetVertexCount();
+
+	auto positionsV = mesh.GetPositionsV();
+	if (settings.mPositions && count > 0 && positionsV.mView.mElement->mFormat != BufferFormat::FORMAT_R16G16B16A16_UNORM) {
+		std::vector<Vector3> positions(count);
+		positionsV.Get(positions);
+		BoundingBox bounds(Vector3(std::numeric_limits<float>::max()), Vector3(std::numeric_limits<float>::lowest()));
+		for (auto& position : positions) {
+			position = position * mesh.GetPositionScale() + mesh.GetPositionOffset();
+			bounds.mMin = Vector3::Min(bounds.mMin, position);
+			bounds.mMax = Vector3::Max(bounds.mMax, position);
+		}
+		// Flat axes would divide by zero
+		auto scale = bounds.mMax - bounds.mMin;
+		for (int c = 0; c < 3; ++c) if (!(((float*)&scale)[c] > 0.0f)) ((float*)&scale)[c] = 1.0f;
+
+		const float Max = 65535.0f;
+		std::vector<Int4> quantized(count);
+		for (int v = 0; v < count; ++v) {
+			auto n = (positions[v] - bounds.mMin) / scale * Max;
+			Int4 q(
+				std::clamp((int)std::round(n.x), 0, 65535),
+				std::clamp((int)std::round(n.y), 0, 65535),
+				std::clamp((int)std::round(n.z), 0, 65535),
+				65535
+			);
+			quantized[v] = q;
+			auto decoded = Vector3((float)q.x, (float)q.y, (float)q.z) / Max * scale + bounds.mMin;
+			report.mMaxPositionError = std::max(report.mMaxPositionError, Vector3::Distance(decoded, positions[v]));
+		}
+		mesh.RequireVertexPositions(BufferFormat::FORMAT_R16G16B16A16_UNORM);
+		mesh.GetPositionsV().Set(std::span<const Int4>(quantized));
+		mesh.SetPositionDequantization(scale, bounds.mMin);
+		auto& material = mesh.GetMaterial(true);
+		material->SetUniform("PositionDequantScale", Vector4(scale.x, scale.y, scale.z, 0.0f));
+		material->SetUniform("PositionDequantOffset", Vector4(bounds.mMin.x, bounds.mMin.y, bounds.mMin.z, 0.0f));
+		report.mPositionsQuantized = true;
+	}
+
+	auto normalsV = mesh.GetNormalsV();
+	if (settings.mNormals && normalsV.size() > 0 && normalsV.mView.mElement->mFormat != BufferFormat::FORMAT_R16G16_SNORM) {
+		std::vector<Vector3> normals(count);
+		normalsV.Get(normals);
+		std::vector<Int2> encoded(count);
+		float minDot = 1.0f;
+		for (int v = 0; v < count; ++v) {
+			auto normal = normals[v];
+			float length = normal.Length();
+			normal = length > 0.0f ? normal / length : Vector3(0.0f, 0.0f, 1.0f);
+			encoded[v] = OctEncodeSnorm16(normal);
+			auto decoded = OctDecode(Vector2((float)encoded[v].x, (float)encoded[v].y) / 32767.0f);
+			minDot = std::min(minDot, decoded.Dot(normal));
+		}
+		report.mMaxNormalError = std::acos(std::clamp(minDot, -1.0f, 1.0f)) * (180.0f / 3.14159265f);
+		mesh.RequireVertexNormals(BufferFormat::FORMAT_R16G16_SNORM);
+		mesh.GetNormalsV().Set(std::span<const Int2>(encoded));
+		report.mNormalsQuantized = true;
+	}
+
+	for (int channel = 0; channel < 8 && settings.mTexCoords; ++channel) {
+		auto uvsV = mesh.GetTexCoordsV(channel);
+		if (uvsV.size() == 0 || uvsV.mView.mElement->mFormat == BufferFormat::FORMAT_R16G16_FLOAT) continue;
+		std::vector<Vector2> uvs(count), decoded(count);
+		std::vector<uint16_t> halfs(count * 2);
+		uvsV.Get(uvs);
+		// Round-trip through half to measure the error (also catches overflow)
+		BufferConversion::WriteFloats(BufferFormat::FORMAT_R16G16_FLOAT, halfs.data(), sizeof(uint16_t) * 2, &uvs.data()->x, 2, count);
+		BufferConversion::ReadFloats(BufferFormat::FORMAT_R16G16_FLOAT, halfs.data(), sizeof(uint16_t) * 2, &decoded.data()->x, 2, count);
+		float error = 0.0f;
+		for (int v = 0; v < count; ++v) {
+			error = std::max(error, std::max(std::abs(decoded[v].x - uvs[v].x), std::abs(decoded[v].y - uvs[v].y)));
+			if (!std::isfinite(decoded[v].x) || !std::isfinite(decoded[v].y)) error = std::numeric_limits<float>::infinity();
+		}
+		report.mMaxTexCoordError = std::max(report.mMaxTexCoordError, error);
+		if (!(error <= settings.mMaxTexCoordError)) continue;
+		mesh.RequireVertexTexCoords(channel, BufferFormat::FORMAT_R16G16_FLOAT);
+		mesh.GetTexCoordsV(channel).Set(std::span<const Vector2>(uvs));
+		report.mTexCoordsQuantized++;
+	}
+
+	mesh.MarkChanged();
+	report.mVertexSizeAfter = mesh.GetVertexBuffer().CalculateBufferStride();
+	return report;
+}
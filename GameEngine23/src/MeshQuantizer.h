@@ -0,0 +1,47 @@
+#pragma once
+
+#include "MathTypes.h"
+
+class Mesh;
+
+// Converts mesh vertex streams to compact encodings:
+// - POSITION: 16-bit UNORM relative to the bounding box (R16G16B16A16_UNORM)
+// - NORMAL: octahedral encoded 2x16-bit SNORM (R16G16_SNORM)
+// - TEXCOORD: half floats (R16G16_FLOAT), if within tolerance
+// Shaders must decode positions and normals; the position transform is
+// set on the mesh material as PositionDequantScale/PositionDequantOffset
+class MeshQuantizer
+{
+public:
+	struct Settings {
+		bool mPositions = true;
+		bool mNormals = true;
+		bool mTexCoords = true;
+		// Texcoords stay as floats if half precision would exceed this
+		// (ie. large tiling values)
+		float mMaxTexCoordError = 1.0f / 4096.0f;
+	};
+	struct Report {
+		// Largest distance of a quantised position from the original
+		float mMaxPositionError = 0.0f;
+		// Largest angle between a decoded and original normal (degrees)
+		float mMaxNormalError = 0.0f;
+		float mMaxTexCoordError = 0.0f;
+		bool mPositionsQuantized = false;
+		bool mNormalsQuantized = false;
+		int mTexCoordsQuantized = 0;
+		// Size of one vertex across all elements
+		int mVertexSizeBefore = 0;
+		int mVertexSizeAfter = 0;
+	};
+
+	static Report Quantize(Mesh& mesh);
+	static Report Quantize(Mesh& mesh, const Settings& settings);
+
+	// Map a unit vector onto the [-1, 1] square
+	static Vector2 OctEncode(Vector3 normal);
+	static Vector3 OctDecode(Vector2 encoded);
+	// Octahedral encoding to SNORM16, choosing the rounding that
+	// decodes closest to the original normal
+	static Int2 OctEncodeSnorm16(Vector3 normal);
+};
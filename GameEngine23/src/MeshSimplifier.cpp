@@ -0,0 +1,244 @@
+#include "MeshSimplifier.h"
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <cmath>
+
+namespace {
+	// Sum of squared distances to a set of planes (weighted by area)
+	struct Quadric {
+		double a2 = 0, b2 = 0, c2 = 0, ab = 0, ac = 0, bc = 0;
+		double ad = 0, bd = 0, cd = 0, d2 = 0;
+		double w = 0;
+		static Quadric FromPlane(Vector3 n, float d, float weight) {
+			Quadric q;
+			q.a2 = n.x * n.x * weight; q.b2 = n.y * n.y * weight; q.c2 = n.z * n.z * weight;
+			q.ab = n.x * n.y * weight; q.ac = n.x * n.z * weight; q.bc = n.y * n.z * weight;
+			q.ad = n.x * d * weight; q.bd = n.y * d * weight; q.cd = n.z * d * weight;
+			q.d2 = d * d * weight;
+			q.w = weight;
+			return q;
+		}
+		void operator +=(const Quadric& o) {
+			a2 += o.a2; b2 += o.b2; c2 += o.c2; ab += o.ab; ac += o.ac; bc += o.bc;
+			ad += o.ad; bd += o.bd; cd += o.cd; d2 += o.d2; w += o.w;
+		}
+		// Mean squared distance of p from the planes
+		float Evaluate(Vector3 p) const {
+			double x = p.x, y = p.y, z = p.z;
+			double r = a2 * x * x + b2 * y * y + c2 * z * z
+				+ 2 * (ab * x * y + ac * x * z + bc * y * z)
+				+ 2 * (ad * x + bd * y + cd * z) + d2;
+			return w > 0 ? (float)std::abs(r / w) : 0.0f;
+		}
+	};
+	struct Collapse {
+		int mFrom;
+		int mTo;
+		float mError;
+	};
+}
+
+int MeshSimplifier::Simplify(std::span<int> dest, std::span<const int> indices, std::span<const Vector3> sourcePositions,
+	int targetIndexCount, float targetError, float* resultError)
+{
+	int vertexCount = (int)sourcePositions.size();
+	std::vector<int> result(indices.begin(), indices.end());
+	float maxError = 0.0f;
+
+	// Normalise positions so that the error is relative to the mesh size
+	Vector3 min(std::numeric_limits<float>::max()), max(std::numeric_limits<float>::lowest());
+	for (auto& p : sourcePositions) { min = Vector3::Min(min, p); max = Vector3::Max(max, p); }
+	float extent = std::max(std::max(max.x - min.x, max.y - min.y), max.z - min.z);
+	float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+	std::vector<Vector3> positions(vertexCount);
+	for (int v = 0; v < vertexCount; ++v) positions[v] = (sourcePositions[v] - min) * scale;
+
+	// Vertices sharing a position (ie. UV/normal seams) map to the lowest index
+	std::vector<int> positionRemap(vertexCount);
+	std::vector<int> wedgeCount(vertexCount, 0);
+	{
+		std::vector<int> order(vertexCount);
+		std::iota(order.begin(), order.end(), 0);
+		auto Less = [&](int a, int b) {
+			auto& pa = sourcePositions[a], &pb = sourcePositions[b];
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			if (pa.z != pb.z) return pa.z < pb.z;
+			return a < b;
+		};
+		std::sort(order.begin(), order.end(), Less);
+		for (int i = 0; i < vertexCount; ) {
+			int j = i + 1;
+			auto& p = sourcePositions[order[i]];
+			while (j < vertexCount && sourcePositions[order[j]] == p) ++j;
+			for (int k = i; k < j; ++k) positionRemap[order[k]] = order[i];
+			wedgeCount[order[i]] = j - i;
+			i = j;
+		}
+	}
+
+	// Lock seams, borders (edges used by one triangle) and non-manifold edges
+	std::vector<uint8_t> locked(vertexCount, 0);
+	{
+		std::vector<uint64_t> edges;
+		edges.reserve(result.size());
+		for (size_t t = 0; t + 2 < result.size(); t += 3) {
+			for (int e = 0; e < 3; ++e) {
+				uint64_t a = positionRemap[result[t + e]], b = positionRemap[result[t + (e + 1) % 3]];
+				if (a == b) continue;
+				edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_t i = 0; i < edges.size(); ) {
+			size_t j = i + 1;
+			while (j < edges.size() && edges[j] == edges[i]) ++j;
+			if (j - i != 2) {
+				locked[(int)(edges[i] >> 32)] = 1;
+				locked[(int)(edges[i] & 0xffffffff)] = 1;
+			}
+			i = j;
+		}
+		for (int v = 0; v < vertexCount; ++v) {
+			int p = positionRemap[v];
+			if (wedgeCount[p] > 1) locked[p] = 1;
+		}
+		for (int v = 0; v < vertexCount; ++v) locked[v] = locked[positionRemap[v]];
+	}
+
+	// Accumulate plane quadrics of adjacent triangles
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t t = 0; t + 2 < result.size(); t += 3) {
+		auto p0 = positions[result[t]], p1 = positions[result[t + 1]], p2 = positions[result[t + 2]];
+		auto normal = (p1 - p0).Cross(p2 - p0);
+		float area = normal.Length();
+		if (!(area > 0.0f)) continue;
+		normal /= area;
+		auto quadric = Quadric::FromPlane(normal, -normal.Dot(p0), area * 0.5f);
+		for (int i = 0; i < 3; ++i) quadrics[positionRemap[result[t + i]]] += quadric;
+	}
+
+	const float errorLimit = targetError * targetError;
+	std::vector<int> adjacencyOffsets(vertexCount + 1);
+	std::vector<int> adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<int> collapseTo(vertexCount);
+	std::vector<uint8_t> touched(vertexCount);
+	while ((int)result.size() > targetIndexCount) {
+		int triCount = (int)result.size() / 3;
+
+		// Triangles around each vertex
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (auto index : result) adjacencyOffsets[index + 1]++;
+		for (int v = 0; v < vertexCount; ++v) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		adjacency.resize(result.size());
+		{
+			std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (int i = 0; i < (int)result.size(); ++i) adjacency[fill[result[i]]++] = i / 3;
+		}
+
+		// Every unlocked vertex can move onto any of its neighbours
+		collapses.clear();
+		for (int t = 0; t < triCount; ++t) {
+			for (int e = 0; e < 3; ++e) {
+				int a = result[t * 3 + e], b = result[t * 3 + (e + 1) % 3];
+				if (a == b) continue;
+				if (!locked[a]) collapses.push_back({ a, b, quadrics[positionRemap[a]].Evaluate(positions[b]) });
+				if (!locked[b]) collapses.push_back({ b, a, quadrics[positionRemap[b]].Evaluate(positions[a]) });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.mError < b.mError; });
+
+		// Apply the cheapest independent collapses
+		std::iota(collapseTo.begin(), collapseTo.end(), 0);
+		std::fill(touched.begin(), touched.end(), 0);
+		int removeTris = (triCount * 3 - targetIndexCount + 2) / 3;
+		int removedTris = 0;
+		int applied = 0;
+		for (auto& collapse : collapses) {
+			if (collapse.mError > errorLimit) break;
+			int a = collapse.mFrom, b = collapse.mTo;
+			if (touched[a] || touched[b]) continue;
+			auto adj = std::span<const int>(adjacency).subspan(adjacencyOffsets[a], adjacencyOffsets[a + 1] - adjacencyOffsets[a]);
+			// Reject collapses which would flip a remaining triangle
+			bool valid = true;
+			int sharedTris = 0;
+			for (auto t : adj) {
+				auto* tri = &result[t * 3];
+				if (tri[0] == b || tri[1] == b || tri[2] == b) { ++sharedTris; continue; }
+				Vector3 p[3];
+				for (int i = 0; i < 3; ++i) p[i] = positions[tri[i]];
+				auto before = (p[1] - p[0]).Cross(p[2] - p[0]);
+				for (int i = 0; i < 3; ++i) if (tri[i] == a) p[i] = positions[b];
+				auto after = (p[1] - p[0]).Cross(p[2] - p[0]);
+				if (before.Dot(after) <= 0.25f * before.Length() * after.Length()) { valid = false; break; }
+			}
+			if (!valid) continue;
+			collapseTo[a] = b;
+			quadrics[positionRemap[b]] += quadrics[positionRemap[a]];
+			// Neighbours must not move this pass, or the flip test is stale
+			for (auto t : adj) for (int i = 0; i < 3; ++i) touched[result[t * 3 + i]] = 1;
+			maxError = std::max(maxError, collapse.mError);
+			removedTris += sharedTris;
+			++applied;
+			if (removedTris >= removeTris) break;
+		}
+		if (applied == 0) break;
+
+		// Rewrite indices and drop collapsed triangles
+		int write = 0;
+		for (int t = 0; t < triCount; ++t) {
+			int i0 = collapseTo[result[t * 3]], i1 = collapseTo[result[t * 3 + 1]], i2 = collapseTo[result[t * 3 + 2]];
+			if (i0 == i1 || i1 == i2 || i0 == i2) continue;
+			result[write++] = i0;
+			result[write++] = i1;
+			result[write++] = i2;
+		}
+		result.resize(write);
+	}
+
+	if (resultError != nullptr) *resultError = std::sqrt(maxError);
+	std::copy(result.begin(), result.end(), dest.begin());
+	return (int)result.size();
+}
+
+std::shared_ptr<Mesh> MeshSimplifier::CreateLOD(Mesh& mesh, float triangleRatio, float targetError) {
+	auto indicesV = mesh.GetIndicesV();
+	std::vector<int> indices(indicesV.size());
+	for (int i = 0; i < (int)indices.size(); ++i) indices[i] = indicesV[i];
+	std::vector<Vector3> positions(mesh.GetVertexCount());
+	mesh.GetPositionsV().Get(positions);
+	for (auto& position : positions) position = position * mesh.GetPositionScale() + mesh.GetPositionOffset();
+
+	int target = (int)(indices.size() / 3 * triangleRatio) * 3;
+	std::vector<int> simplified(indices.size());
+	int count = Simplify(simplified, indices, positions, target, targetError);
+	if (count == 0 || count >= (int)indices.size()) return nullptr;
+	simplified.resize(count);
+
+	// Only keep the referenced vertices
+	std::vector<int> remap(mesh.GetVertexCount());
+	int vertexCount = MeshOptimizer::OptimizeVertexFetchRemap(simplified, remap);
+	std::vector<int> vertices(vertexCount);
+	for (int v = 0; v < (int)remap.size(); ++v) if (remap[v] >= 0) vertices[remap[v]] = v;
+	return mesh.CreateSubmesh(mesh.GetName() + "_LOD", vertices, simplified);
+}
+
+void MeshSimplifier::GenerateLODs(Model& model, std::span<const Model::LODLevel> levels, float targetError) {
+	auto meshes = model.GetMeshes();
+	std::vector<std::vector<std::shared_ptr<Mesh>>> lodMeshes(levels.size(), std::vector<std::shared_ptr<Mesh>>(meshes.size()));
+	std::vector<int> meshIds(meshes.size());
+	std::iota(meshIds.begin(), meshIds.end(), 0);
+	std::for_each(std::execution::par, meshIds.begin(), meshIds.end(), [&](int m) {
+		for (int l = 0; l < (int)levels.size(); ++l) {
+			auto lod = CreateLOD(*meshes[m], levels[l].mTriangleRatio, targetError);
+			// Could not be reduced further; share the previous level
+			lodMeshes[l][m] = lod != nullptr ? lod : l > 0 ? lodMeshes[l - 1][m] : meshes[m];
+		}
+	});
+	for (int l = 0; l < (int)levels.size(); ++l) model.AppendLOD(levels[l], std::move(lodMeshes[l]));
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <memory>
+
+#include "MathTypes.h"
+#include "Model.h"
+
+class Mesh;
+
+// Reduces triangle counts by collapsing edges in order of
+// quadric error (Garland-Heckbert), keeping existing vertices
+class MeshSimplifier
+{
+public:
+	// Simplify a triangle list until it has at most targetIndexCount
+	// indices or no collapse is within targetError (relative to the
+	// mesh extents). Vertices on borders, attribute seams (same position,
+	// different attributes) and non-manifold edges are locked.
+	// Returns the new index count written to dest
+	static int Simplify(std::span<int> dest, std::span<const int> indices, std::span<const Vector3> positions,
+		int targetIndexCount, float targetError, float* resultError = nullptr);
+
+	// Create a simplified copy of a mesh (sharing its material), or
+	// nullptr if it could not be reduced
+	static std::shared_ptr<Mesh> CreateLOD(Mesh& mesh, float triangleRatio, float targetError);
+
+	// Append a LOD for each level to the model, processing meshes in parallel
+	static void GenerateLODs(Model& model, std::span<const Model::LODLevel> levels, float targetError);
+};
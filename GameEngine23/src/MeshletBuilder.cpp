@@ -0,0 +1,129 @@
+#include "MeshletBuilder.h"
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+void MeshletBuilder::Build(Result& result, std::span<const int> indices, std::span<const Vector3> positions, int maxVertices, int maxTriangles) {
+	assert(maxVertices <= 256 && maxTriangles > 0);
+	result.mMeshlets.clear();
+	result.mVertexIndices.clear();
+	result.mPrimitives.clear();
+	result.mBounds.clear();
+
+	// Local index of each mesh vertex within the current meshlet
+	std::vector<int> localIndex(positions.size(), -1);
+	Meshlet meshlet = { };
+	auto FlushMeshlet = [&]() {
+		if (meshlet.mTriangleCount == 0) return;
+		for (uint32_t v = 0; v < meshlet.mVertexCount; ++v)
+			localIndex[result.mVertexIndices[meshlet.mVertexOffset + v]] = -1;
+		result.mMeshlets.push_back(meshlet);
+		meshlet = { (uint32_t)result.mVertexIndices.size(), (uint32_t)result.mPrimitives.size(), 0, 0, };
+	};
+	for (int t = 0; t + 2 < (int)indices.size(); t += 3) {
+		auto* tri = &indices[t];
+		int newVerts = 0;
+		for (int i = 0; i < 3; ++i) {
+			if (localIndex[tri[i]] < 0 && (i < 1 || tri[i] != tri[0]) && (i < 2 || tri[i] != tri[1])) ++newVerts;
+		}
+		if ((int)meshlet.mVertexCount + newVerts > maxVertices || (int)meshlet.mTriangleCount + 1 > maxTriangles)
+			FlushMeshlet();
+		uint32_t packed = 0;
+		for (int i = 0; i < 3; ++i) {
+			auto& local = localIndex[tri[i]];
+			if (local < 0) {
+				local = meshlet.mVertexCount++;
+				result.mVertexIndices.push_back(tri[i]);
+			}
+			packed |= (uint32_t)local << (i * 8);
+		}
+		result.mPrimitives.push_back(packed);
+		meshlet.mTriangleCount++;
+	}
+	FlushMeshlet();
+
+	result.mBounds.reserve(result.mMeshlets.size());
+	for (auto& item : result.mMeshlets) result.mBounds.push_back(ComputeBounds(result, item, positions));
+}
+
+MeshletBounds MeshletBuilder::ComputeBounds(const Result& result, const Meshlet& meshlet, std::span<const Vector3> positions) {
+	MeshletBounds bounds = { };
+	auto vertices = std::span<const uint32_t>(result.mVertexIndices).subspan(meshlet.mVertexOffset, meshlet.mVertexCount);
+	auto primitives = std::span<const uint32_t>(result.mPrimitives).subspan(meshlet.mTriangleOffset, meshlet.mTriangleCount);
+	auto GetCorner = [&](uint32_t primitive, int corner) {
+		return positions[vertices[(primitive >> (corner * 8)) & 0xff]];
+	};
+
+	// Sphere around the bounding box centre
+	Vector3 min = positions[vertices[0]], max = min;
+	for (auto v : vertices) {
+		min = Vector3::Min(min, positions[v]);
+		max = Vector3::Max(max, positions[v]);
+	}
+	bounds.mCentre = (min + max) * 0.5f;
+	for (auto v : vertices) bounds.mRadius = std::max(bounds.mRadius, Vector3::Distance(bounds.mCentre, positions[v]));
+
+	// Normal cone from the average triangle normal
+	struct Plane { Vector3 mPoint, mNormal; };
+	std::vector<Plane> planes;
+	planes.reserve(primitives.size());
+	Vector3 axis = Vector3::Zero;
+	for (auto primitive : primitives) {
+		auto p0 = GetCorner(primitive, 0);
+		auto normal = (GetCorner(primitive, 1) - p0).Cross(GetCorner(primitive, 2) - p0);
+		float length = normal.Length();
+		// Degenerate triangles do not constrain the cone
+		if (!(length > 0.0f)) continue;
+		normal /= length;
+		planes.push_back({ p0, normal, });
+		axis += normal;
+	}
+	bounds.mConeCutoff = 1.0f;
+	bounds.mConeApex = bounds.mCentre;
+	float axisLength = axis.Length();
+	if (planes.empty() || !(axisLength > 0.0f)) return bounds;
+	axis /= axisLength;
+	float minDot = 1.0f;
+	for (auto& plane : planes) minDot = std::min(minDot, plane.mNormal.Dot(axis));
+	bounds.mConeAxis = axis;
+	// Wider than ~84 degrees can rarely be culled; leave disabled
+	if (minDot <= 0.1f) return bounds;
+
+	// Move the apex back along the axis until it is behind every
+	// triangle plane, so the test is valid for any camera position
+	float maxT = 0.0f;
+	for (auto& plane : planes) {
+		float t = (bounds.mCentre - plane.mPoint).Dot(plane.mNormal) / axis.Dot(plane.mNormal);
+		maxT = std::max(maxT, t);
+	}
+	bounds.mConeApex = bounds.mCentre - axis * maxT;
+	bounds.mConeCutoff = std::sqrt(1.0f - minDot * minDot);
+	return bounds;
+}
+
+const std::shared_ptr<MeshletData>& MeshletBuilder::Build(Mesh& mesh, int maxVertices, int maxTriangles) {
+	auto indicesV = mesh.GetIndicesV();
+	std::vector<int> indices(indicesV.size());
+	for (int i = 0; i < (int)indices.size(); ++i) indices[i] = indicesV[i];
+	std::vector<Vector3> positions(mesh.GetVertexCount());
+	mesh.GetPositionsV().Get(positions);
+	// Bounds are in mesh space, even if positions are quantised
+	for (auto& position : positions) position = position * mesh.GetPositionScale() + mesh.GetPositionOffset();
+
+	Result result;
+	Build(result, indices, positions, maxVertices, maxTriangles);
+
+	auto data = std::make_shared<MeshletData>();
+	data->mMeshlets.SetCount((int)result.mMeshlets.size());
+	data->mMeshlets.SetValues(0, result.mMeshlets);
+	data->mVertexIndices.SetCount((int)result.mVertexIndices.size());
+	data->mVertexIndices.SetValues(0, result.mVertexIndices);
+	data->mPrimitives.SetCount((int)result.mPrimitives.size());
+	data->mPrimitives.SetValues(0, result.mPrimitives);
+	data->mBounds.SetCount((int)result.mBounds.size());
+	data->mBounds.SetValues(0, result.mBounds);
+	mesh.SetMeshlets(data);
+	return mesh.GetMeshlets();
+}
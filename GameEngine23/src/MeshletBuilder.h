@@ -0,0 +1,70 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <memory>
+
+#include "MathTypes.h"
+#include "GraphicsBuffer.h"
+
+class Mesh;
+
+// A small cluster of triangles which can be processed by a
+// single mesh shader group
+struct Meshlet {
+	uint32_t mVertexOffset;		// Into MeshletData::mVertexIndices
+	uint32_t mTriangleOffset;	// Into MeshletData::mPrimitives
+	uint32_t mVertexCount;
+	uint32_t mTriangleCount;
+};
+// Culling data for a meshlet. The meshlet is entirely backfacing if
+// dot(normalize(mConeApex - cameraPosition), mConeAxis) >= mConeCutoff
+struct MeshletBounds {
+	Vector3 mCentre;
+	float mRadius;
+	Vector3 mConeApex;
+	float mConeCutoff;		// 1 if the cone is too wide to be useful
+	Vector3 mConeAxis;
+	float mPadding;
+};
+
+// Meshlets generated for a mesh, in GPU ready layouts
+struct MeshletData {
+	GraphicsBuffer<Meshlet> mMeshlets;
+	// Mesh vertex index for each meshlet-local vertex
+	GraphicsBuffer<uint32_t> mVertexIndices;
+	// 3 local (8-bit) vertex indices packed per triangle
+	GraphicsBuffer<uint32_t> mPrimitives;
+	GraphicsBuffer<MeshletBounds> mBounds;
+
+	MeshletData() : mMeshlets(0), mVertexIndices(0), mPrimitives(0), mBounds(0) { }
+	int GetMeshletCount() const { return mMeshlets.GetCount(); }
+	// DispatchMesh launches one group per 128 indices
+	int GetDispatchIndexCount() const { return GetMeshletCount() * 128; }
+};
+
+class MeshletBuilder
+{
+public:
+	// Limits recommended for most hardware (and at most 256 for 8-bit local indices)
+	static const int DefaultMaxVertices = 64;
+	static const int DefaultMaxTriangles = 124;
+
+	struct Result {
+		std::vector<Meshlet> mMeshlets;
+		std::vector<uint32_t> mVertexIndices;
+		std::vector<uint32_t> mPrimitives;
+		std::vector<MeshletBounds> mBounds;
+	};
+
+	// Split the triangle list into meshlets (in triangle order, so run
+	// after vertex cache optimisation for the best locality)
+	static void Build(Result& result, std::span<const int> indices, std::span<const Vector3> positions,
+		int maxVertices = DefaultMaxVertices, int maxTriangles = DefaultMaxTriangles);
+	// Bounding sphere and normal cone of a meshlet
+	static MeshletBounds ComputeBounds(const Result& result, const Meshlet& meshlet, std::span<const Vector3> positions);
+
+	// Build meshlets for a mesh and store them on it (until the mesh next changes)
+	static const std::shared_ptr<MeshletData>& Build(Mesh& mesh,
+		int maxVertices = DefaultMaxVertices, int maxTriangles = DefaultMaxTriangles);
+};
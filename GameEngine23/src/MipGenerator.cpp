@@ -0,0 +1,319 @@
+#include "MipGenerator.h"
+
+#include "Texture.h"
+#include "BufferConversion.h"
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <atomic>
+#include <vector>
+#include <cmath>
+#include <immintrin.h>
+
+namespace {
+	using Filter = MipGenerator::Filter;
+
+	const float Pi = 3.14159265358979f;
+
+	// sRGB decode per byte, and thresholds between each code for encoding
+	// (found from a coarse table then corrected against the thresholds)
+	struct SRGBTables {
+		float mToLinear[256];
+		float mThresholds[255];
+		uint8_t mCoarse[1024];
+		SRGBTables() {
+			auto ToLinear = [](double v) { return v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4); };
+			for (int i = 0; i < 256; ++i) mToLinear[i] = (float)ToLinear(i / 255.0);
+			for (int i = 0; i < 255; ++i) mThresholds[i] = (float)ToLinear((i + 0.5) / 255.0);
+			for (int i = 0, code = 0; i < 1024; ++i) {
+				while (code < 255 && i / 1023.0f >= mThresholds[code]) ++code;
+				mCoarse[i] = (uint8_t)code;
+			}
+		}
+		uint8_t FromLinear(float v) const {
+			if (!(v > 0.0f)) return 0;
+			if (v >= 1.0f) return 255;
+			int code = mCoarse[(int)(v * 1023.0f)];
+			while (code > 0 && v < mThresholds[code - 1]) --code;
+			while (code < 255 && v >= mThresholds[code]) ++code;
+			return (uint8_t)code;
+		}
+	};
+	const SRGBTables& GetSRGBTables() {
+		static SRGBTables tables;
+		return tables;
+	}
+
+	float Sinc(float x) {
+		x *= Pi;
+		return std::abs(x) < 1e-5f ? 1.0f : std::sin(x) / x;
+	}
+	double BesselI0(double x) {
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 32 && term > sum * 1e-12; ++k) {
+			term *= (x * x * 0.25) / (k * k);
+			sum += term;
+		}
+		return sum;
+	}
+	// Support radius and weight at `x` (in destination pixels)
+	float GetFilterRadius(Filter filter) {
+		switch (filter) {
+		case Filter::Kaiser: return 3.0f;
+		case Filter::Lanczos: return 3.0f;
+		default: return 0.5f;
+		}
+	}
+	float EvaluateFilter(Filter filter, float x) {
+		x = std::abs(x);
+		switch (filter) {
+		case Filter::Kaiser: {
+			const float Alpha = 4.0f, Radius = 3.0f;
+			if (x >= Radius) return 0.0f;
+			float t = x / Radius;
+			return Sinc(x) * (float)(BesselI0(Alpha * std::sqrt(1.0f - t * t)) / BesselI0(Alpha));
+		}
+		case Filter::Lanczos: return x < 3.0f ? Sinc(x) * Sinc(x / 3.0f) : 0.0f;
+		default: return x <= 0.5f ? 1.0f : 0.0f;
+		}
+	}
+
+	// Source taps and normalized weights for each destination pixel on one axis
+	struct AxisWeights {
+		int mTapCount;
+		std::vector<int> mIndices;		// [dst * mTapCount + tap]
+		std::vector<float> mWeights;
+	};
+	AxisWeights ComputeAxisWeights(int srcSize, int dstSize, Filter filter, bool wrap) {
+		AxisWeights axis;
+		float scale = (float)srcSize / dstSize;
+		float radius = GetFilterRadius(filter) * scale;
+		axis.mTapCount = srcSize == dstSize ? 1 : (int)std::ceil(radius * 2.0f) + 1;
+		axis.mIndices.resize((size_t)dstSize * axis.mTapCount);
+		axis.mWeights.resize((size_t)dstSize * axis.mTapCount);
+		for (int d = 0; d < dstSize; ++d) {
+			int* indices = &axis.mIndices[(size_t)d * axis.mTapCount];
+			float* weights = &axis.mWeights[(size_t)d * axis.mTapCount];
+			if (srcSize == dstSize) { indices[0] = d; weights[0] = 1.0f; continue; }
+			float centre = (d + 0.5f) * scale - 0.5f;
+			int first = (int)std::ceil(centre - radius);
+			float total = 0.0f;
+			for (int t = 0; t < axis.mTapCount; ++t) {
+				int s = first + t;
+				float w = EvaluateFilter(filter, (s - centre) / scale);
+				indices[t] = wrap ? ((s % srcSize) + srcSize) % srcSize : std::clamp(s, 0, srcSize - 1);
+				weights[t] = w;
+				total += w;
+			}
+			for (int t = 0; t < axis.mTapCount; ++t) weights[t] = total != 0.0f ? weights[t] / total : 0.0f;
+		}
+		return axis;
+	}
+
+	template<class Fn>
+	void ForEachIndex(int count, bool parallel, Fn&& fn) {
+		std::vector<int> items(count);
+		std::iota(items.begin(), items.end(), 0);
+		if (parallel) std::for_each(std::execution::par, items.begin(), items.end(), fn);
+		else std::for_each(items.begin(), items.end(), fn);
+	}
+
+	// How pixels of the texture format map to 4 floats
+	struct PixelFormat {
+		BufferFormat mFormat;
+		int mComponents;
+		int mPixelSize;
+		// Leading channels that are sRGB encoded
+		int mSRGBChannels;
+
+		void Decode(const uint8_t* src, float* dst, int count) const {
+			if (mSRGBChannels == 0) {
+				BufferConversion::ReadFloats(mFormat, src, mPixelSize, dst, 4, count);
+				return;
+			}
+			auto& tables = GetSRGBTables();
+			for (int i = 0; i < count; ++i, src += mPixelSize, dst += 4) {
+				for (int c = 0; c < 4; ++c) {
+					dst[c] = c >= mComponents ? 0.0f : c < mSRGBChannels ? tables.mToLinear[src[c]] : src[c] / 255.0f;
+				}
+			}
+		}
+		void Encode(const float* src, uint8_t* dst, int count) const {
+			if (mSRGBChannels == 0) {
+				BufferConversion::WriteFloats(mFormat, dst, mPixelSize, src, 4, count);
+				return;
+			}
+			auto& tables = GetSRGBTables();
+			for (int i = 0; i < count; ++i, src += 4, dst += mPixelSize) {
+				for (int c = 0; c < mComponents; ++c) {
+					dst[c] = c < mSRGBChannels ? tables.FromLinear(src[c])
+						: (uint8_t)std::clamp((int)(src[c] * 255.0f + 0.5f), 0, 255);
+				}
+			}
+		}
+	};
+
+	// Weighted sum of float4 pixels from `src` for each output pixel
+	void FilterRow(const float* src, const AxisWeights& axis, float* dst, int dstCount) {
+		for (int d = 0; d < dstCount; ++d) {
+			auto* indices = &axis.mIndices[(size_t)d * axis.mTapCount];
+			auto* weights = &axis.mWeights[(size_t)d * axis.mTapCount];
+			__m128 sum = _mm_setzero_ps();
+			for (int t = 0; t < axis.mTapCount; ++t) {
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(src + indices[t] * 4)));
+			}
+			_mm_storeu_ps(dst + d * 4, sum);
+		}
+	}
+	// Weighted sum of whole rows, `rowStride` floats apart, starting at `src`
+	void FilterRows(const float* src, size_t rowStride, const int* indices, const float* weights, int tapCount, float* dst, int floatCount) {
+		for (int i = 0; i < floatCount; i += 4) {
+			__m128 sum = _mm_setzero_ps();
+			for (int t = 0; t < tapCount; ++t) {
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(src + indices[t] * rowStride + i)));
+			}
+			_mm_storeu_ps(dst + i, sum);
+		}
+	}
+
+	// Alpha scale that keeps `coverage` of the pixels above `cutoff`
+	float ComputeAlphaScale(const std::vector<float>& pixels, float coverage, float cutoff) {
+		std::vector<float> alpha(pixels.size() / 4);
+		for (size_t i = 0; i < alpha.size(); ++i) alpha[i] = pixels[i * 4 + 3];
+		int count = (int)alpha.size();
+		int keep = std::clamp((int)std::lround(coverage * count), 0, count);
+		float threshold;
+		if (keep == 0) {
+			threshold = *std::max_element(alpha.begin(), alpha.end()) * 1.001f + 1e-6f;
+		} else if (keep == count) {
+			threshold = *std::min_element(alpha.begin(), alpha.end()) * 0.999f;
+		} else {
+			// Between the smallest kept alpha and the largest dropped alpha
+			std::nth_element(alpha.begin(), alpha.begin() + keep, alpha.end(), std::greater<float>());
+			float dropped = alpha[keep];
+			float kept = *std::min_element(alpha.begin(), alpha.begin() + keep);
+			threshold = (kept + dropped) * 0.5f;
+		}
+		return threshold > 0.0f ? cutoff / threshold : 1.0f;
+	}
+}
+
+bool MipGenerator::IsSupported(BufferFormat fmt) {
+	switch (fmt) {
+	case FORMAT_R8G8B8A8_UNORM:
+	case FORMAT_R8G8B8A8_UNORM_SRGB:
+	case FORMAT_R8G8_UNORM:
+	case FORMAT_R8_UNORM:
+	case FORMAT_R16G16B16A16_FLOAT:
+		return true;
+	default: return false;
+	}
+}
+
+int MipGenerator::CalculateMipCount(Int3 size) {
+	int maxSize = std::max(std::max(size.x, size.y), size.z);
+	int count = 1;
+	while (maxSize > 1) { maxSize >>= 1; ++count; }
+	return count;
+}
+
+void MipGenerator::GenerateMips(Texture& texture, const Settings& settings) {
+	auto fmt = texture.GetBufferFormat();
+	if (!IsSupported(fmt)) throw "Mips can only be generated for RGBA8, RG8, R8 and RGBA16F textures";
+	auto type = BufferFormatType::GetType(fmt);
+	PixelFormat pixelFormat = { fmt, type.GetComponentCount(), type.GetByteSize(), 0, };
+	if (type.size == BufferFormatType::Size8 && (settings.mSRGB || fmt == FORMAT_R8G8B8A8_UNORM_SRGB)) {
+		pixelFormat.mSRGBChannels = std::min(pixelFormat.mComponents, 3);
+	}
+	bool preserveCoverage = settings.mAlphaCutoff > 0.0f && pixelFormat.mComponents == 4;
+
+	auto size = texture.GetSize();
+	texture.SetMipCount(CalculateMipCount(size));
+	// Allocate up front, so that slices can fetch their data concurrently
+	texture.RequireData();
+
+	ForEachIndex(texture.GetArrayCount(), settings.mParallel, [&](int slice) {
+		auto source = texture.GetRawData(0, slice);
+		Int3 srcRes = size;
+		// The previous level, 4 floats per pixel (mip 0 is decoded as it is read)
+		std::vector<float> level;
+
+		float coverage = 0.0f;
+		if (preserveCoverage) {
+			std::atomic<int64_t> covered = 0;
+			ForEachIndex(srcRes.y * srcRes.z, settings.mParallel, [&](int row) {
+				thread_local std::vector<float> decoded;
+				decoded.resize((size_t)srcRes.x * 4);
+				pixelFormat.Decode(source.data() + (size_t)row * srcRes.x * pixelFormat.mPixelSize, decoded.data(), srcRes.x);
+				int count = 0;
+				for (int x = 0; x < srcRes.x; ++x) count += decoded[x * 4 + 3] > settings.mAlphaCutoff;
+				covered += count;
+			});
+			coverage = (float)covered / ((float)srcRes.x * srcRes.y * srcRes.z);
+		}
+
+		for (int mip = 1; mip < texture.GetMipCount(); ++mip) {
+			auto dstRes = Texture::GetMipResolution(size, fmt, mip);
+			auto weightsX = ComputeAxisWeights(srcRes.x, dstRes.x, settings.mFilter, settings.mWrap);
+			auto weightsY = ComputeAxisWeights(srcRes.y, dstRes.y, settings.mFilter, settings.mWrap);
+			auto weightsZ = ComputeAxisWeights(srcRes.z, dstRes.z, settings.mFilter, settings.mWrap);
+			int rowFloats = dstRes.x * 4;
+
+			// Along x, for every source row
+			std::vector<float> filteredX((size_t)rowFloats * srcRes.y * srcRes.z);
+			ForEachIndex(srcRes.y * srcRes.z, settings.mParallel, [&](int row) {
+				const float* src;
+				if (mip == 1) {
+					thread_local std::vector<float> decoded;
+					decoded.resize((size_t)srcRes.x * 4);
+					pixelFormat.Decode(source.data() + (size_t)row * srcRes.x * pixelFormat.mPixelSize, decoded.data(), srcRes.x);
+					src = decoded.data();
+				} else {
+					src = level.data() + (size_t)row * srcRes.x * 4;
+				}
+				FilterRow(src, weightsX, filteredX.data() + (size_t)row * rowFloats, dstRes.x);
+			});
+
+			// Along y, within each source plane
+			std::vector<float> filteredY((size_t)rowFloats * dstRes.y * srcRes.z);
+			ForEachIndex(dstRes.y * srcRes.z, settings.mParallel, [&](int row) {
+				int z = row / dstRes.y, y = row % dstRes.y;
+				FilterRows(filteredX.data() + (size_t)z * srcRes.y * rowFloats, rowFloats,
+					&weightsY.mIndices[(size_t)y * weightsY.mTapCount], &weightsY.mWeights[(size_t)y * weightsY.mTapCount], weightsY.mTapCount,
+					filteredY.data() + (size_t)row * rowFloats, rowFloats);
+			});
+			filteredX = { };
+
+			// Along z, for volumes
+			if (srcRes.z != dstRes.z) {
+				level.resize((size_t)rowFloats * dstRes.y * dstRes.z);
+				size_t planeFloats = (size_t)rowFloats * dstRes.y;
+				ForEachIndex(dstRes.y * dstRes.z, settings.mParallel, [&](int row) {
+					int z = row / dstRes.y, y = row % dstRes.y;
+					FilterRows(filteredY.data() + (size_t)y * rowFloats, planeFloats,
+						&weightsZ.mIndices[(size_t)z * weightsZ.mTapCount], &weightsZ.mWeights[(size_t)z * weightsZ.mTapCount], weightsZ.mTapCount,
+						level.data() + (size_t)row * rowFloats, rowFloats);
+				});
+			} else {
+				level = std::move(filteredY);
+			}
+
+			// Alpha is only scaled in the stored mip, the chain keeps the filtered value
+			float alphaScale = preserveCoverage ? ComputeAlphaScale(level, coverage, settings.mAlphaCutoff) : 1.0f;
+			auto dest = texture.GetRawData(mip, slice);
+			ForEachIndex(dstRes.y * dstRes.z, settings.mParallel, [&](int row) {
+				const float* src = level.data() + (size_t)row * rowFloats;
+				if (alphaScale != 1.0f) {
+					thread_local std::vector<float> scaled;
+					scaled.assign(src, src + rowFloats);
+					for (int x = 0; x < dstRes.x; ++x) scaled[x * 4 + 3] = std::min(scaled[x * 4 + 3] * alphaScale, 1.0f);
+					src = scaled.data();
+				}
+				pixelFormat.Encode(src, dest.data() + (size_t)row * dstRes.x * pixelFormat.mPixelSize, dstRes.x);
+			});
+			srcRes = dstRes;
+		}
+	});
+	texture.MarkChanged();
+}
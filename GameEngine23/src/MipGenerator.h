@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "MathTypes.h"
+#include "Buffer.h"
+
+class Texture;
+
+// Fills the mip chain of a texture from mip 0
+// Each level is filtered from the previous one in linear float (colour
+// is decoded from sRGB first when requested), separably along x, y and z
+// Slices, and the rows of each pass, are processed in parallel
+class MipGenerator
+{
+public:
+	enum class Filter : uint8_t {
+		Box,
+		// Kaiser windowed sinc (width 3, alpha 4)
+		Kaiser,
+		// Lanczos with 3 lobes
+		Lanczos,
+	};
+	struct Settings {
+		Filter mFilter = Filter::Box;
+		// Colour channels hold sRGB values (always true for _SRGB formats)
+		bool mSRGB = false;
+		// Scale alpha in each mip so that the fraction of pixels above this
+		// value matches mip 0 (for alpha tested cutouts); 0 to disable
+		float mAlphaCutoff = 0.0f;
+		// Sample across the edges of the texture rather than clamping
+		bool mWrap = false;
+		bool mParallel = true;
+	};
+
+	// RGBA8 (UNORM or SRGB), RG8, R8 and RGBA16F
+	static bool IsSupported(BufferFormat fmt);
+	// Number of mips down to 1x1x1
+	static int CalculateMipCount(Int3 size);
+	// Set the full mip count and generate every mip below 0, for each slice
+	static void GenerateMips(Texture& texture, const Settings& settings);
+};
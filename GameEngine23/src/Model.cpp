@@ -0,0 +1,44 @@
+#include "Model.h"
+
+#include <immintrin.h>
+
+namespace {
+	// Rows of scale * rotation * translation (row vectors, as SimpleMath)
+	void ComposeTRS(const Model::Transform& local, __m128 rows[4]) {
+		auto& q = local.mRotation;
+		float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		float xw = q.x * q.w, yw = q.y * q.w, zw = q.z * q.w;
+		rows[0] = _mm_mul_ps(_mm_setr_ps(1.0f - 2.0f * (yy + zz), 2.0f * (xy + zw), 2.0f * (xz - yw), 0.0f), _mm_set1_ps(local.mScale.x));
+		rows[1] = _mm_mul_ps(_mm_setr_ps(2.0f * (xy - zw), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + xw), 0.0f), _mm_set1_ps(local.mScale.y));
+		rows[2] = _mm_mul_ps(_mm_setr_ps(2.0f * (xz + yw), 2.0f * (yz - xw), 1.0f - 2.0f * (xx + yy), 0.0f), _mm_set1_ps(local.mScale.z));
+		rows[3] = _mm_setr_ps(local.mPosition.x, local.mPosition.y, local.mPosition.z, 1.0f);
+	}
+	// One row of row * matrix
+	__m128 TransformRow(__m128 row, const __m128 m[4]) {
+		__m128 r = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), m[0]);
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), m[1]));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), m[2]));
+		return _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), m[3]));
+	}
+}
+
+// Parents precede children, so a single forward pass is enough
+void Model::ComputeWorldMatrices(std::span<const int> parents, std::span<const Transform> locals, std::span<Matrix> worlds) {
+	for (int n = 0; n < (int)parents.size(); ++n) {
+		__m128 local[4];
+		ComposeTRS(locals[n], local);
+		float* world = &worlds[n]._11;
+		int parent = parents[n];
+		if (parent < 0) {
+			for (int r = 0; r < 4; ++r) _mm_storeu_ps(world + r * 4, local[r]);
+			continue;
+		}
+		const float* parentWorld = &worlds[parent]._11;
+		__m128 p[4] = {
+			_mm_loadu_ps(parentWorld), _mm_loadu_ps(parentWorld + 4),
+			_mm_loadu_ps(parentWorld + 8), _mm_loadu_ps(parentWorld + 12),
+		};
+		for (int r = 0; r < 4; ++r) _mm_storeu_ps(world + r * 4, TransformRow(local[r], p));
+	}
+}
@@ -2,20 +2,98 @@
 
 #include <vector>
 #include <memory>
+#include <string>
+#include <algorithm>
 
 #include "Mesh.h"
+#include "MeshOptimizer.h"
 #include "GraphicsDeviceBase.h"
 
-// A collection of meshes
-// TODO: Should store animation data
-// TODO: Should store mesh hierarchy
+class AnimationClip;
+
+// A collection of meshes, optionally placed by a node hierarchy,
+// with the skin and animations that deform it
 class Model
 {
+public:
+	struct LODLevel {
+		// Fraction of the original triangles to keep
+		float mTriangleRatio;
+		// Used once the model covers less than this fraction of the screen height
+		float mScreenSize;
+	};
+	struct LOD : public LODLevel {
+		// Matches mMeshes; a mesh that could not be simplified is shared
+		std::vector<std::shared_ptr<Mesh>> mMeshes;
+	};
+	// Node transform relative to its parent
+	struct Transform {
+		Vector3 mPosition = Vector3::Zero;
+		Quaternion mRotation = Quaternion::Identity;
+		Vector3 mScale = Vector3::One;
+	};
+	// A mesh drawn with the world matrix of a node
+	struct MeshInstance {
+		int mNode;
+		int mMesh;		// Into GetMeshes(lod)
+	};
+	// Joints of skinned meshes; vertex BLENDINDICES index these arrays
+	struct Skin {
+		std::vector<int> mJointNodes;
+		// Mesh space to joint space in the bind pose
+		std::vector<Matrix> mInverseBindMatrices;
+	};
+
+private:
 	std::vector<std::shared_ptr<Mesh>> mMeshes;
+	// Lower detail versions of mMeshes, in decreasing screen size
+	std::vector<LOD> mLODs;
+
+	// Nodes are stored flat (one array per field), and parents
+	// always come before their children
+	std::vector<std::string> mNodeNames;
+	std::vector<int> mNodeParents;
+	std::vector<Transform> mNodeLocals;
+	std::vector<Matrix> mNodeWorlds;
+	// If empty, each mesh is drawn once without a transform
+	std::vector<MeshInstance> mInstances;
+	std::shared_ptr<Material> mInstanceMaterial;
+
+	Skin mSkin;
+	std::vector<std::shared_ptr<AnimationClip>> mAnimations;
+
+	void RenderMesh(CommandBuffer& cmdBuffer, Mesh* mesh, const std::shared_ptr<Material>& material) {
+		auto& meshMat = mesh->GetMaterial();
+		if (meshMat != nullptr)
+		{
+			meshMat->InheritProperties(material);
+			cmdBuffer.DrawMesh(mesh, meshMat.get());
+			meshMat->RemoveInheritance(material);
+		}
+		else
+		{
+			cmdBuffer.DrawMesh(mesh, material.get());
+		}
+	}
 
 public:
-	void AppendMesh(std::shared_ptr<Mesh> mesh) {
+	// Returns the index of the mesh
+	int AppendMesh(std::shared_ptr<Mesh> mesh) {
 		mMeshes.push_back(mesh);
+		return (int)mMeshes.size() - 1;
+	}
+
+	// Append a mesh that should use 16-bit indices; if it has too many
+	// vertices, it is split into several meshes which are all rendered
+	// Returns the range of meshes that were appended
+	RangeInt AppendMesh16(const std::shared_ptr<Mesh>& mesh) {
+		if (!Mesh::RequiresIndex32(mesh->GetVertexCount())) {
+			mesh->RequireNarrowestIndexFormat();
+			return RangeInt(AppendMesh(mesh), 1);
+		}
+		RangeInt range((int)mMeshes.size(), 0);
+		for (auto& part : MeshOptimizer::SplitMesh(*mesh)) { AppendMesh(part); ++range.length; }
+		return range;
 	}
 
 	std::span<std::shared_ptr<Mesh>> GetMeshes() {
@@ -25,22 +103,82 @@ public:
 		return mMeshes;
 	}
 
-	void Render(CommandBuffer& cmdBuffer, const std::shared_ptr<Material>& material)
+	// LOD 0 is the full detail meshes
+	int GetLODCount() const { return 1 + (int)mLODs.size(); }
+	std::span<const LOD> GetLODs() const { return mLODs; }
+	std::span<std::shared_ptr<Mesh>> GetMeshes(int lod) {
+		return lod == 0 ? GetMeshes() : std::span<std::shared_ptr<Mesh>>(mLODs[lod - 1].mMeshes);
+	}
+	void AppendLOD(const LODLevel& level, std::vector<std::shared_ptr<Mesh>> meshes) {
+		assert(meshes.size() == mMeshes.size());
+		LOD lod;
+		(LODLevel&)lod = level;
+		lod.mMeshes = std::move(meshes);
+		mLODs.push_back(std::move(lod));
+	}
+	void ClearLODs() { mLODs.clear(); }
+	// Pick the LOD for the fraction of the screen height covered by the model
+	int SelectLOD(float screenSize) const {
+		int lod = 0;
+		while (lod < (int)mLODs.size() && screenSize < mLODs[lod].mScreenSize) ++lod;
+		return lod;
+	}
+
+	// Returns the index of the node; the parent must already exist (or be -1)
+	int AppendNode(const std::string& name, int parent, const Transform& local) {
+		assert(parent < (int)mNodeParents.size());
+		mNodeNames.push_back(name);
+		mNodeParents.push_back(parent);
+		mNodeLocals.push_back(local);
+		mNodeWorlds.push_back(Matrix::Identity);
+		return (int)mNodeParents.size() - 1;
+	}
+	int GetNodeCount() const { return (int)mNodeParents.size(); }
+	int FindNode(const std::string_view& name) const {
+		auto it = std::find(mNodeNames.begin(), mNodeNames.end(), name);
+		return it == mNodeNames.end() ? -1 : (int)(it - mNodeNames.begin());
+	}
+	const std::string& GetNodeName(int node) const { return mNodeNames[node]; }
+	std::span<const int> GetNodeParents() const { return mNodeParents; }
+	// Modify to animate nodes, then call UpdateWorldMatrices
+	std::span<Transform> GetNodeLocals() { return mNodeLocals; }
+	std::span<const Transform> GetNodeLocals() const { return mNodeLocals; }
+	std::span<const Matrix> GetNodeWorlds() const { return mNodeWorlds; }
+	// Recompute world matrices from local transforms (SSE)
+	void UpdateWorldMatrices() { ComputeWorldMatrices(mNodeParents, mNodeLocals, mNodeWorlds); }
+	// Same as UpdateWorldMatrices, for a pose stored outside of a model
+	static void ComputeWorldMatrices(std::span<const int> parents, std::span<const Transform> locals, std::span<Matrix> worlds);
+
+	Skin& GetSkin() { return mSkin; }
+	const Skin& GetSkin() const { return mSkin; }
+	int GetJointCount() const { return (int)mSkin.mJointNodes.size(); }
+
+	void AppendAnimation(const std::shared_ptr<AnimationClip>& clip) { mAnimations.push_back(clip); }
+	std::span<const std::shared_ptr<AnimationClip>> GetAnimations() const { return mAnimations; }
+
+	void AppendInstance(int node, int mesh) { mInstances.push_back({ node, mesh, }); }
+	std::span<const MeshInstance> GetInstances() const { return mInstances; }
+
+	void Render(CommandBuffer& cmdBuffer, const std::shared_ptr<Material>& material, int lod = 0)
 	{
-		for (auto& mesh : GetMeshes())
+		auto meshes = GetMeshes(lod);
+		if (mInstances.empty())
+		{
+			for (auto& mesh : meshes) RenderMesh(cmdBuffer, mesh.get(), material);
+			return;
+		}
+		// Instances are placed relative to the incoming model matrix
+		static Identifier iMMat = "Model";
+		auto modelData = material->GetUniformBinaryData(iMMat);
+		Matrix model = modelData.size() == sizeof(Matrix) ? *(const Matrix*)modelData.data() : Matrix::Identity;
+		if (mInstanceMaterial == nullptr) mInstanceMaterial = std::make_shared<Material>();
+		mInstanceMaterial->InheritProperties(material);
+		for (auto& instance : mInstances)
 		{
-			auto& meshMat = mesh->GetMaterial();
-			if (meshMat != nullptr)
-			{
-				meshMat->InheritProperties(material);
-				cmdBuffer.DrawMesh(mesh.get(), meshMat.get());
-				meshMat->RemoveInheritance(material);
-			}
-			else
-			{
-				cmdBuffer.DrawMesh(mesh.get(), material.get());
-			}
+			mInstanceMaterial->SetUniform(iMMat, mNodeWorlds[instance.mNode] * model);
+			RenderMesh(cmdBuffer, meshes[instance.mMesh].get(), mInstanceMaterial);
 		}
+		mInstanceMaterial->RemoveInheritance(material);
 	}
 
 };
@@ -2,6 +2,8 @@
 
 #include "WindowWin32.h"
 #include "GraphicsDeviceD3D12.h"
+#include "GraphicsDeviceNull.h"
+#include "ResourceLoader.h"
 
 void NativePlatform::Initialize()
 {
@@ -15,6 +17,10 @@ void NativePlatform::Initialize()
     mGraphics = device;
     //mInput = input;
 }
+void NativePlatform::InitializeHeadless()
+{
+    mGraphics = std::make_shared<GraphicsDeviceNull>();
+}
 
 std::shared_ptr<WindowBase> NativePlatform::CreateWindow(const std::wstring_view& name) {
     auto window = std::make_shared<WindowWin32>(name.data());
@@ -24,6 +30,8 @@ std::shared_ptr<WindowBase> NativePlatform::CreateWindow(const std::wstring_view
 
 int NativePlatform::MessagePump()
 {
+    // Notify the main thread of any background loads that finished
+    ResourceLoader::GetSingleton().DispatchCompletions();
     return WindowWin32::MessagePump();
     //return mWindow->MessagePump();
 }
@@ -15,6 +15,8 @@ class NativePlatform
 public:
 	// Load relevant platform systems
 	void Initialize();
+	// Use a device that does not talk to a GPU instead (profiling, tests)
+	void InitializeHeadless();
 
 	// Use to access platform systems
 	std::shared_ptr<WindowBase> CreateWindow(const std::wstring_view& name);
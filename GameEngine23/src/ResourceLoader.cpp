@@ -1,70 +1,267 @@
 #include "ResourceLoader.h"
 
 #include "FBXImport.h"
+#include "TextureImport.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #include <string>
 #include <algorithm>
 #include <iterator>
+#include <cstring>
+
+extern "C" {
+	__declspec(dllimport) void __stdcall OutputDebugStringW(const wchar_t* lpOutputString);
+}
 
 ResourceLoader ResourceLoader::gInstance;
 
-const std::shared_ptr<Model>& ResourceLoader::LoadModel(const std::wstring_view& path)
+ResourceLoader::~ResourceLoader()
 {
-	auto i = mLoadedMeshes.find(path);
-	if (i == mLoadedMeshes.end())
 	{
-		std::wstring pathStr(path);
-		mLoadedMeshes.insert(std::make_pair(pathStr, FBXImport::ImportAsModel(pathStr))).second;
-		i = mLoadedMeshes.find(path);
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
 	}
+	mQueueChanged.notify_all();
+	for (auto& worker : mWorkers) worker.join();
+}
+
+std::shared_ptr<Texture> ResourceLoader::DecodeTexture(const std::wstring_view& path)
+{
+	// GPU ready containers are read straight into the texture
+	if (TextureImport::IsSupported(path)) return TextureImport::Import(std::wstring(path));
+	std::string pathStr;
+	std::transform(path.begin(), path.end(), std::back_inserter(pathStr), [](auto c) { return (char)c; });
+	Int2 size;
+	//auto data = SOIL_load_image(pathStr.c_str(), &size.x, &size.y, 0, SOIL_LOAD_RGBA);
+	//stbi_set_flip_vertically_on_load(true);
+	auto data = stbi_load(pathStr.c_str(), &size.x, &size.y, 0, STBI_rgb_alpha);
+	std::shared_ptr<Texture> tex;
+	if (data != nullptr) {
+		tex = std::make_shared<Texture>();
+		tex->SetSize(size);
+		std::memcpy(tex->GetRawData().data(), data, (size_t)size.x * size.y * 4);
+		tex->MarkChanged();
+		//SOIL_free_image_data(data);
+		stbi_image_free(data);
+	}
+	return tex;
+}
+std::shared_ptr<FontInstance> ResourceLoader::DecodeFont(const std::wstring_view& path)
+{
+	std::lock_guard<std::mutex> lock(mFontMutex);
+	if (mFontRenderer == nullptr) mFontRenderer = FontRenderer::Create();
+	auto instance = mFontRenderer->CreateInstance();
+	std::string pathStr;
+	std::transform(path.begin(), path.end(), std::back_inserter(pathStr), [](auto c) { return (char)c; });
+	instance->Load(pathStr, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789!@#$%^&*()-=_+[]{}\\|;:'\",.<>/?`~ ");
+	return instance;
+}
+
+template<class T, class Decode>
+ResourceLoader::Handle<T> ResourceLoader::RequestLoad(const std::wstring_view& path, Priority priority,
+	ResourceMap<T>& loaded, PendingMap& pending, Decode decode)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto request = std::make_shared<LoadRequest<T>>(priority);
+	if (auto i = loaded.find(path); i != loaded.end()) {
+		request->mResource = i->second;
+		request->mState = LoadRequestBase::State::Complete;
+		return request;
+	}
+	// Join the load already in flight, raising its priority if needed
+	if (auto i = pending.find(path); i != pending.end()) {
+		auto& existing = i->second;
+		++existing->mInterest;
+		if (priority > existing->mPriority) {
+			existing->mPriority = priority;
+			Enqueue(existing, priority);
+		}
+		return std::static_pointer_cast<LoadRequest<T>>(existing);
+	}
+	request->mPath = path;
+	request->mPendingMap = &pending;
+	// Raw pointer, as the request owns this function; TryRun keeps it alive
+	request->mLoad = [this, request = request.get(), &loaded, decode]() {
+		std::shared_ptr<T> resource;
+		std::exception_ptr error;
+		try { resource = decode(request->mPath); }
+		catch (...) { error = std::current_exception(); }
+		std::lock_guard<std::mutex> lock(mMutex);
+		request->mResource = resource;
+		request->mError = error;
+		// Failed loads are cached (as nullptr) unless they threw
+		if (error == nullptr) loaded.insert_or_assign(request->mPath, resource);
+	};
+	pending.insert(std::make_pair(request->mPath, request));
+	Enqueue(request, priority);
+	return request;
+}
+template<class T, class Request>
+const std::shared_ptr<T>& ResourceLoader::LoadSync(const std::wstring_view& path, ResourceMap<T>& loaded, Request request)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto i = loaded.find(path);
+		if (i != loaded.end()) return i->second;
+	}
+	auto handle = request();
+	handle.Wait();
+	std::lock_guard<std::mutex> lock(mMutex);
+	// Also covers the map having been cleared since the load completed
+	auto i = loaded.find(path);
+	if (i == loaded.end()) i = loaded.insert(std::make_pair(std::wstring(path), handle.Get())).first;
 	return i->second;
 }
 
-const std::shared_ptr<Texture>& ResourceLoader::LoadTexture(const std::wstring_view& path)
+void ResourceLoader::Enqueue(const std::shared_ptr<LoadRequestBase>& request, Priority priority)
+{
+	StartWorkers();
+	mQueue.push_back(QueueItem{ (int)priority, mSequence++, request, });
+	std::push_heap(mQueue.begin(), mQueue.end());
+	mQueueChanged.notify_one();
+}
+void ResourceLoader::StartWorkers()
+{
+	if (!mWorkers.empty()) return;
+	// Leave a core for the thread issuing requests
+	int count = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	for (int i = 0; i < count; ++i) mWorkers.emplace_back([this]() { WorkerLoop(); });
+}
+void ResourceLoader::RemovePending(LoadRequestBase* request)
 {
-	auto i = mLoadedTextures.find(path);
-	if (i == mLoadedTextures.end())
+	// The path may have been cancelled and requested again since
+	auto i = request->mPendingMap->find(request->mPath);
+	if (i != request->mPendingMap->end() && i->second.get() == request) request->mPendingMap->erase(i);
+}
+void ResourceLoader::WorkerLoop()
+{
+	while (true) {
+		std::shared_ptr<LoadRequestBase> request;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mQueueChanged.wait(lock, [&]() { return mStopping || !mQueue.empty(); });
+			if (mStopping) return;
+			std::pop_heap(mQueue.begin(), mQueue.end());
+			request = std::move(mQueue.back().mRequest);
+			mQueue.pop_back();
+		}
+		TryRun(request);
+	}
+}
+bool ResourceLoader::TryRun(const std::shared_ptr<LoadRequestBase>& request)
+{
+	auto expected = LoadRequestBase::State::Queued;
+	if (!request->mState.compare_exchange_strong(expected, LoadRequestBase::State::Loading)) return false;
+	request->mLoad();
 	{
-		std::string pathStr;
-		std::transform(path.begin(), path.end(), std::back_inserter(pathStr), [](auto c) { return (char)c; });
-		Int2 size;
-		//auto data = SOIL_load_image(pathStr.c_str(), &size.x, &size.y, 0, SOIL_LOAD_RGBA);
-		//stbi_set_flip_vertically_on_load(true);
-		auto data = stbi_load(pathStr.c_str(), &size.x, &size.y, 0, STBI_rgb_alpha);
-		std::shared_ptr<Texture> tex;
-		if (data != nullptr) {
-			tex = std::make_shared<Texture>();
-			tex->SetSize(size);
-			std::transform((const uint32_t*)data, (const uint32_t*)data + size.x * size.y, (uint32_t*)tex->GetRawData().data(), [](auto p)
-				{
-					return p;
-				}
-			);
-			tex->MarkChanged();
-			//SOIL_free_image_data(data);
-			stbi_image_free(data);
+		std::lock_guard<std::mutex> lock(mMutex);
+		request->mLoad = nullptr;
+		request->mState = LoadRequestBase::State::Complete;
+		RemovePending(request.get());
+		for (auto& callback : request->mCallbacks) mCompleted.push_back(std::move(callback));
+		request->mCallbacks.clear();
+	}
+	mLoadCompleted.notify_all();
+	return true;
+}
+void ResourceLoader::Wait(const std::shared_ptr<LoadRequestBase>& request)
+{
+	// Run it here if no worker has claimed it yet, otherwise wait for the worker
+	if (!TryRun(request)) {
+		std::unique_lock<std::mutex> lock(mMutex);
+		mLoadCompleted.wait(lock, [&]() {
+			auto state = request->mState.load();
+			return state == LoadRequestBase::State::Complete || state == LoadRequestBase::State::Cancelled;
+		});
+	}
+	if (request->mError != nullptr) std::rethrow_exception(request->mError);
+}
+void ResourceLoader::Cancel(const std::shared_ptr<LoadRequestBase>& request)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (--request->mInterest > 0) return;
+		auto expected = LoadRequestBase::State::Queued;
+		if (!request->mState.compare_exchange_strong(expected, LoadRequestBase::State::Cancelled)) return;
+		request->mLoad = nullptr;
+		request->mCallbacks.clear();
+		RemovePending(request.get());
+	}
+	mLoadCompleted.notify_all();
+}
+void ResourceLoader::AddCallback(const std::shared_ptr<LoadRequestBase>& request, std::function<void()> callback)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto state = request->mState.load();
+	if (state == LoadRequestBase::State::Cancelled) return;
+	if (state == LoadRequestBase::State::Complete) mCompleted.push_back(std::move(callback));
+	else request->mCallbacks.push_back(std::move(callback));
+}
+
+ResourceLoader::Handle<Model> ResourceLoader::LoadModelAsync(const std::wstring_view& path, Priority priority)
+{
+	return RequestLoad(path, priority, mLoadedMeshes, mPendingMeshes, [](const std::wstring& path) {
+		return FBXImport::ImportAsModel(path);
+	});
+}
+ResourceLoader::Handle<Texture> ResourceLoader::LoadTextureAsync(const std::wstring_view& path, Priority priority)
+{
+	return RequestLoad(path, priority, mLoadedTextures, mPendingTextures, [](const std::wstring& path) {
+		return DecodeTexture(path);
+	});
+}
+ResourceLoader::Handle<FontInstance> ResourceLoader::LoadFontAsync(const std::wstring_view& path, Priority priority)
+{
+	return RequestLoad(path, priority, mLoadedFonts, mPendingFonts, [this](const std::wstring& path) {
+		return DecodeFont(path);
+	});
+}
+
+const std::shared_ptr<Model>& ResourceLoader::LoadModel(const std::wstring_view& path)
+{
+	return LoadSync(path, mLoadedMeshes, [&]() { return LoadModelAsync(path, Priority::High); });
+}
+const std::shared_ptr<Texture>& ResourceLoader::LoadTexture(const std::wstring_view& path)
+{
+	return LoadSync(path, mLoadedTextures, [&]() { return LoadTextureAsync(path, Priority::High); });
+}
+void ResourceLoader::LoadTextures(std::span<const std::wstring> paths, std::span<std::shared_ptr<Texture>> textures)
+{
+	// Queue everything first so that the workers decode in parallel;
+	// repeated paths share one load
+	std::vector<Handle<Texture>> handles;
+	handles.reserve(paths.size());
+	for (auto& path : paths) handles.push_back(LoadTextureAsync(path, Priority::High));
+	for (int i = 0; i < (int)paths.size(); ++i) {
+		// A malformed file leaves its texture null, as a missing one does
+		try { textures[i] = handles[i].Wait(); }
+		catch (...) {
+			OutputDebugStringW((L"Failed to load texture " + paths[i] + L"\n").c_str());
 		}
-		i = mLoadedTextures.insert(std::make_pair(std::wstring(path), tex)).first;
 	}
-	return i->second;
 }
 const std::shared_ptr<FontInstance>& ResourceLoader::LoadFont(const std::wstring_view& path)
 {
-	if (mFontRenderer == nullptr) mFontRenderer = FontRenderer::Create();
-	auto i = mLoadedFonts.find(path);
-	if (i == mLoadedFonts.end())
+	return LoadSync(path, mLoadedFonts, [&]() { return LoadFontAsync(path, Priority::High); });
+}
+
+void ResourceLoader::DispatchCompletions()
+{
+	std::vector<std::function<void()>> completed;
 	{
-		auto instance = mFontRenderer->CreateInstance();
-		std::string pathStr;
-		std::transform(path.begin(), path.end(), std::back_inserter(pathStr), [](auto c) { return (char)c; });
-		instance->Load(pathStr, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789!@#$%^&*()-=_+[]{}\\|;:'\",.<>/?`~ ");
-		i = mLoadedFonts.insert(std::make_pair(std::wstring(path), instance)).first;
+		std::lock_guard<std::mutex> lock(mMutex);
+		completed.swap(mCompleted);
 	}
-	return i->second;
+	for (auto& callback : completed) callback();
+}
+int ResourceLoader::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return (int)(mPendingMeshes.size() + mPendingTextures.size() + mPendingFonts.size());
 }
 void ResourceLoader::Unload()
 {
+	std::lock_guard<std::mutex> lock(mMutex);
 	mLoadedMeshes.clear();
 	mLoadedTextures.clear();
 }
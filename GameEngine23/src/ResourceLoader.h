@@ -1,6 +1,13 @@
 #pragma once
 
 #include <map>
+#include <span>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <exception>
+#include <condition_variable>
 #include "Resources.h"
 #include "Texture.h"
 #include "Material.h"
@@ -9,17 +16,139 @@
 
 class ResourceLoader
 {
-	std::map<std::wstring, std::shared_ptr<Model>, Identifier::comp> mLoadedMeshes;
-	std::map<std::wstring, std::shared_ptr<Texture>, Identifier::comp> mLoadedTextures;
-	std::map<std::wstring, std::shared_ptr<FontInstance>, Identifier::comp> mLoadedFonts;
+public:
+	enum class Priority : uint8_t { Low, Normal, High, };
+
+	struct LoadRequestBase;
+	using PendingMap = std::map<std::wstring, std::shared_ptr<LoadRequestBase>, Identifier::comp>;
+
+	// Shared between every handle to one in-flight load
+	struct LoadRequestBase {
+		enum class State : uint8_t { Queued, Loading, Complete, Cancelled, };
+		std::atomic<State> mState = State::Queued;
+		std::atomic<Priority> mPriority;
+		std::function<void()> mLoad;
+		// Rethrown by Wait() if the load threw
+		std::exception_ptr mError;
+		// Guarded by the loader mutex
+		std::wstring mPath;
+		PendingMap* mPendingMap = nullptr;
+		int mInterest = 1;
+		std::vector<std::function<void()>> mCallbacks;
+		LoadRequestBase(Priority priority) : mPriority(priority) { }
+	};
+	template<class T>
+	struct LoadRequest : public LoadRequestBase {
+		std::shared_ptr<T> mResource;
+		using LoadRequestBase::LoadRequestBase;
+	};
+
+	// Returned immediately by the async loads; the resource is
+	// available once IsComplete() (or from Wait())
+	template<class T>
+	class Handle {
+		std::shared_ptr<LoadRequest<T>> mRequest;
+	public:
+		Handle() { }
+		Handle(const std::shared_ptr<LoadRequest<T>>& request) : mRequest(request) { }
+		bool IsValid() const { return mRequest != nullptr; }
+		bool IsComplete() const { return mRequest != nullptr && mRequest->mState == LoadRequestBase::State::Complete; }
+		bool IsCancelled() const { return mRequest != nullptr && mRequest->mState == LoadRequestBase::State::Cancelled; }
+		// nullptr until complete (or if the load failed)
+		const std::shared_ptr<T>& Get() const { static const std::shared_ptr<T> null; return IsComplete() ? mRequest->mResource : null; }
+		// Block until loaded, loading on this thread if no worker has started it
+		const std::shared_ptr<T>& Wait() const { if (mRequest != nullptr) gInstance.Wait(mRequest); return Get(); }
+		// Drop this requester's interest; the load is abandoned if nobody
+		// else wants it and it has not started yet
+		void Cancel() { if (mRequest != nullptr) gInstance.Cancel(mRequest); }
+		// Invoked from DispatchCompletions() on the main thread
+		void OnComplete(std::function<void(const std::shared_ptr<T>&)> fn) {
+			if (mRequest == nullptr) return;
+			gInstance.AddCallback(mRequest, [request = mRequest, fn = std::move(fn)]() { fn(request->mResource); });
+		}
+	};
+
+private:
+	template<class T>
+	using ResourceMap = std::map<std::wstring, std::shared_ptr<T>, Identifier::comp>;
+
+	struct QueueItem {
+		int mPriority;
+		uint64_t mSequence;
+		std::shared_ptr<LoadRequestBase> mRequest;
+		// Highest priority first, then oldest first
+		bool operator <(const QueueItem& o) const { return mPriority != o.mPriority ? mPriority < o.mPriority : mSequence > o.mSequence; }
+	};
+
+	// Guards every map and the queue; never held while decoding
+	std::mutex mMutex;
+	ResourceMap<Model> mLoadedMeshes;
+	ResourceMap<Texture> mLoadedTextures;
+	ResourceMap<FontInstance> mLoadedFonts;
+	PendingMap mPendingMeshes;
+	PendingMap mPendingTextures;
+	PendingMap mPendingFonts;
 
+	// Max-heap of queued loads. Raising a priority pushes a second item,
+	// and items whose request is no longer queued are skipped
+	std::vector<QueueItem> mQueue;
+	uint64_t mSequence = 0;
+	std::condition_variable mQueueChanged;
+	std::condition_variable mLoadCompleted;
+	std::vector<std::thread> mWorkers;
+	bool mStopping = false;
+	// Callbacks of finished loads, waiting for DispatchCompletions()
+	std::vector<std::function<void()>> mCompleted;
+
+	// FreeType faces are created from one library, so fonts load one at a time
+	std::mutex mFontMutex;
 	std::shared_ptr<FontRenderer> mFontRenderer;
 
 	static ResourceLoader gInstance;
+
+	// Read an image file into a new texture (nullptr if it failed)
+	// Does not touch the loader state, so may run on any thread
+	static std::shared_ptr<Texture> DecodeTexture(const std::wstring_view& path);
+	std::shared_ptr<FontInstance> DecodeFont(const std::wstring_view& path);
+
+	template<class T, class Decode>
+	Handle<T> RequestLoad(const std::wstring_view& path, Priority priority,
+		ResourceMap<T>& loaded, PendingMap& pending, Decode decode);
+	// Return the cached resource, or make an async request and wait for it
+	template<class T, class Request>
+	const std::shared_ptr<T>& LoadSync(const std::wstring_view& path, ResourceMap<T>& loaded, Request request);
+	// These require mMutex to be held
+	void Enqueue(const std::shared_ptr<LoadRequestBase>& request, Priority priority);
+	void StartWorkers();
+	void RemovePending(LoadRequestBase* request);
+	void WorkerLoop();
+	// Claim and run a queued request; false if it was already started or cancelled
+	bool TryRun(const std::shared_ptr<LoadRequestBase>& request);
+	void Wait(const std::shared_ptr<LoadRequestBase>& request);
+	void Cancel(const std::shared_ptr<LoadRequestBase>& request);
+	void AddCallback(const std::shared_ptr<LoadRequestBase>& request, std::function<void()> callback);
 public:
+	~ResourceLoader();
+
+	// Synchronous loads; join any async load already in flight for the path
 	const std::shared_ptr<Model>& LoadModel(const std::wstring_view& path);
 	const std::shared_ptr<Texture>& LoadTexture(const std::wstring_view& path);
+	// Load several textures, decoding those not already loaded in parallel
+	// Like every load here, safe to call from any thread (mMutex guards the maps)
+	void LoadTextures(std::span<const std::wstring> paths, std::span<std::shared_ptr<Texture>> textures);
 	const std::shared_ptr<FontInstance>& LoadFont(const std::wstring_view& path);
+
+	// Queue a load on the worker pool. Concurrent requests for the
+	// same path share one load (taking the highest priority)
+	Handle<Model> LoadModelAsync(const std::wstring_view& path, Priority priority = Priority::Normal);
+	Handle<Texture> LoadTextureAsync(const std::wstring_view& path, Priority priority = Priority::Normal);
+	Handle<FontInstance> LoadFontAsync(const std::wstring_view& path, Priority priority = Priority::Normal);
+
+	// Run the OnComplete callbacks of finished loads; call on the main thread
+	void DispatchCompletions();
+	// Number of loads queued or running
+	int GetPendingCount();
+
 	void Unload();
 
 	static ResourceLoader& GetSingleton() { return gInstance; }
@@ -1,6 +1,7 @@
 #include "Texture.h"
 
 #include <algorithm>
+#include <cstring>
 
 TextureBase::TextureBase(const std::wstring_view& name)
 	: mName(name), mRevision(0) { }
@@ -14,10 +15,16 @@ bool TextureBase::GetAllowUnorderedAccess() const {
 }
 
 
+void Texture::UpdateLayout() {
+	mLayout = ComputeLayout(mSize.mSize, mSize.mMipCount, mSize.mArrayCount, mFormat);
+	mUploadLayout = ComputeLayout(mSize.mSize, mSize.mMipCount, mSize.mArrayCount, mFormat,
+		UploadRowAlignment, UploadPlacementAlignment);
+}
 void Texture::ResizeData(Sizing oldSize) {
+	UpdateLayout();
 	if (mData.empty()) return;
 	size_t oldDataSize = (int)mData.size();
-	size_t newDataSize = GetSliceSize(mSize.mSize, mSize.mMipCount, mFormat) * mSize.mArrayCount;
+	size_t newDataSize = mLayout.mSize;
 	mData.resize(std::max(newDataSize, oldDataSize));
 	int oldSliceSize = GetSliceSize(oldSize.mSize, oldSize.mMipCount, mFormat);
 	int newSliceSize = GetSliceSize(mSize.mSize, mSize.mMipCount, mFormat);
@@ -29,7 +36,7 @@ void Texture::ResizeData(Sizing oldSize) {
 		int oldOffset = oldSliceSize * s;
 		int newOffset = newSliceSize * s;
 		if (oldOffset != newOffset) {
-			std::memcpy(mData.data() + newOffset, mData.data() + oldOffset, std::min(newSliceSize, oldSliceSize));
+			std::memmove(mData.data() + newOffset, mData.data() + oldOffset, std::min(newSliceSize, oldSliceSize));
 		}
 	}
 	mData.resize(newDataSize);
@@ -67,6 +74,7 @@ int Texture::GetArrayCount() const { return mSize.mArrayCount; }
 void Texture::SetBufferFormat(BufferFormat fmt) {
 	mFormat = fmt;
 	mData.clear();
+	UpdateLayout();
 }
 BufferFormat Texture::GetBufferFormat() const { return mFormat; }
 
@@ -76,33 +84,44 @@ void Texture::SetPixels32Bit(std::span<const uint32_t> colors) {
 }
 void Texture::RequireData() {
 	if (!mData.empty()) return;
-	int dataSize = GetSliceSize(mSize.mSize, mSize.mMipCount, mFormat) * mSize.mArrayCount;
-	mData.resize(dataSize);
+	mData.resize(mLayout.mSize);
 }
 std::span<uint8_t> Texture::GetRawData(int mip, int slice) {
 	RequireData();
 	if (mip < 0 || slice < 0) return std::span<uint8_t>(mData.begin(), mData.end());
-	uint32_t imgOffset = 0;
-	uint32_t imgSize = 0;
-	if (slice > 0) {
-		imgOffset += GetSliceSize(mSize.mSize, mSize.mMipCount, mFormat) * slice;
-	}
-	for (int m = 0; m < mip; ++m) {
-		auto mipSize = GetMipResolution(mSize.mSize, mFormat, m);
-		imgOffset += GetRawImageSize(mipSize, mFormat);
-	}
-	{
-		auto mipSize = GetMipResolution(mSize.mSize, mFormat, mip);
-		imgSize = GetRawImageSize(mipSize, mFormat);
-	}
-	return std::span<uint8_t>(mData.begin() + imgOffset, imgSize);
+	auto& subresource = GetSubresource(mip, slice);
+	return std::span<uint8_t>(mData.begin() + subresource.mOffset, subresource.mSize);
 }
 std::span<const uint8_t> Texture::GetData(int mip, int slice) const {
 	return const_cast<Texture*>(this)->GetRawData(mip, slice);
 }
 
+Texture::Layout Texture::ComputeLayout(Int3 res, int mips, int slices, BufferFormat fmt, int rowAlignment, int placementAlignment) {
+	auto AlignUp = [](size_t value, size_t alignment) { return (value + alignment - 1) / alignment * alignment; };
+	int blockSize = std::max(BufferFormatType::GetCompressedBlockSize(fmt), 1);
+	int blockBytes = std::max(BufferFormatType::GetBitSize(fmt), 0) * blockSize * blockSize / 8;
+	Layout layout;
+	layout.mSubresources.resize(mips * slices);
+	size_t offset = 0;
+	// Slice major, so each slice holds its full mip chain
+	for (int s = 0; s < slices; ++s) {
+		for (int m = 0; m < mips; ++m) {
+			auto mipRes = GetMipResolution(res, fmt, m);
+			auto& subresource = layout.mSubresources[m + s * mips];
+			subresource.mRowPitch = (uint32_t)AlignUp((mipRes.x + blockSize - 1) / blockSize * blockBytes, rowAlignment);
+			subresource.mRowCount = (mipRes.y + blockSize - 1) / blockSize;
+			subresource.mDepth = mipRes.z;
+			subresource.mSize = subresource.mRowPitch * subresource.mRowCount * subresource.mDepth;
+			offset = AlignUp(offset, placementAlignment);
+			subresource.mOffset = (uint32_t)offset;
+			offset += subresource.mSize;
+		}
+	}
+	layout.mSize = offset;
+	return layout;
+}
 int Texture::GetSliceSize(Int3 res, int mips, BufferFormat fmt) {
-	uint32_t sliceSize = GetRawImageSize(res, fmt);
+	uint32_t sliceSize = 0;
 	for (int m = 0; m < mips; ++m) {
 		auto mipSize = GetMipResolution(res, fmt, m);
 		sliceSize += GetRawImageSize(mipSize, fmt);
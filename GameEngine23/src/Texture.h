@@ -32,6 +32,27 @@ public:
 };
 
 class Texture : public TextureBase {
+public:
+	// Where one mip of one slice lives in the texture data
+	struct Subresource {
+		uint32_t mOffset;
+		uint32_t mSize;
+		// Bytes per row and rows per depth slice; for compressed
+		// formats a row is one row of blocks
+		uint32_t mRowPitch;
+		uint32_t mRowCount;
+		uint32_t mDepth;
+	};
+	// Indexed by mip + slice * mipCount (as D3D12CalcSubresource)
+	struct Layout {
+		std::vector<Subresource> mSubresources;
+		size_t mSize = 0;
+	};
+	// Placement required when copying from an upload buffer
+	static const int UploadRowAlignment = 256;
+	static const int UploadPlacementAlignment = 512;
+
+private:
 	struct Sizing {
 		Int3 mSize;
 		int mMipCount = 1;
@@ -40,13 +61,18 @@ class Texture : public TextureBase {
 	Sizing mSize;
 	BufferFormat mFormat = BufferFormat::FORMAT_R8G8B8A8_UNORM;
 	std::vector<uint8_t> mData;
+	// Rebuilt whenever the size, mips, slices or format change
+	Layout mLayout;
+	Layout mUploadLayout;
 
+	void UpdateLayout();
 	void ResizeData(Sizing oldSize);
 
 public:
-	using TextureBase::TextureBase;
+	Texture() : Texture(L"Texture") { }
+	Texture(const std::wstring_view& name) : TextureBase(name) { UpdateLayout(); }
 	Texture(Texture&& other) = default;
-	Texture(Int3 size, BufferFormat fmt = BufferFormat::FORMAT_R8G8B8A8_UNORM) {
+	Texture(Int3 size, BufferFormat fmt = BufferFormat::FORMAT_R8G8B8A8_UNORM) : Texture() {
 		SetSize3D(size); SetBufferFormat(fmt);
 	}
 	Texture& operator=(Texture&& other) = default;
@@ -69,6 +95,14 @@ public:
 	std::span<uint8_t> GetRawData(int mip = 0, int slice = 0);
 	std::span<const uint8_t> GetData(int mip = 0, int slice = 0) const;
 
+	// Tightly packed, as stored in the texture data
+	const Layout& GetLayout() const { return mLayout; }
+	const Subresource& GetSubresource(int mip, int slice) const { return mLayout.mSubresources[mip + slice * mSize.mMipCount]; }
+	// The same subresources with rows and offsets aligned for upload
+	// buffers, so a backend can place each one without querying the device
+	const Layout& GetUploadLayout() const { return mUploadLayout; }
+
+	static Layout ComputeLayout(Int3 res, int mips, int slices, BufferFormat fmt, int rowAlignment = 1, int placementAlignment = 1);
 	static int GetSliceSize(Int3 res, int mips, BufferFormat fmt);
 	static Int3 GetMipResolution(Int3 res, BufferFormat fmt, int mip);
 	static uint32_t GetRawImageSize(Int3 res, BufferFormat fmt);
@@ -1,65 +1,756 @@
-//#include "../externals/nvtt/nvtt.h"
-#include "MathTypes.h"
 #include "TextureCompression.h"
-#include <stdint.h>
+
+#include "Texture.h"
+
+#include <algorithm>
+#include <execution>
+#include <limits>
 #include <vector>
-/*
-void CompressTextureData(InputData* img, nvtt::Format format, void* outData) {
-	auto& size = img->size;
-	auto& data = img->data;
-	nvtt::InputOptions inputOptions;
-	inputOptions.setTextureLayout(nvtt::TextureType_2D, size.x, size.y, size.z);
-	inputOptions.setMipmapGeneration(false, -1);
-	inputOptions.setMipmapData(data, size.x, size.y, size.z);
-	inputOptions.setGamma(1.0f, 1.0f);
-	inputOptions.setWrapMode(nvtt::WrapMode_Repeat);
-	inputOptions.setFormat(nvtt::InputFormat_BGRA_8UB);
-
-	nvtt::CompressionOptions compressionOptions;
-	compressionOptions.setQuality(nvtt::Quality_Normal);
-	compressionOptions.setFormat(format);
-	compressionOptions.setColorWeights(1, 1, 1);
-
-	nvtt::Compressor compressor;
-	compressor.enableCudaAcceleration(true);
-
-	struct : public nvtt::OutputHandler {
-		std::vector<uint8_t> buffer;
-		virtual void beginImage(int size, int width, int height, int depth, int face, int miplevel) { }
-		virtual void endImage() { }
-		virtual bool writeData(const void* data, int size) {
-			int oldSize = (int)buffer.size();
-			buffer.resize(buffer.size() + size);
-			std::memcpy(buffer.data() + oldSize, data, size);
-			return true;
-		}
-	} outputHandler;
-	outputHandler.buffer.reserve(compressor.estimateSize(inputOptions, compressionOptions));
-
-	nvtt::OutputOptions outputOptions;
-	outputOptions.setOutputHeader(false);
-	outputOptions.setOutputHandler(&outputHandler);
-
-	compressor.process(inputOptions, compressionOptions, outputOptions);
-	std::memcpy(outData, outputHandler.buffer.data(), outputHandler.buffer.size());
-}
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include <immintrin.h>
+
+namespace {
+	using Quality = TextureCompression::Quality;
+
+	const float MaxError = std::numeric_limits<float>::max();
+
+	// 4x4 RGBA8 pixels, row major
+	struct Block {
+		alignas(16) uint8_t mPixels[16][4];
+	};
+	// The same pixels as floats, 4 pixels per register
+	struct BlockSoA {
+		__m128 mC[4][4];		// [channel][pixel group]
+	};
+	struct Endpoints {
+		float mE[2][4];
+	};
+	struct Palette {
+		float mColors[16][4];
+		int mCount;
+	};
+
+	float HSum(__m128 v) {
+		v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, 1)));
+	}
+	float HMin(__m128 v) {
+		v = _mm_min_ps(v, _mm_movehl_ps(v, v));
+		return _mm_cvtss_f32(_mm_min_ss(v, _mm_shuffle_ps(v, v, 1)));
+	}
+	float HMax(__m128 v) {
+		v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+		return _mm_cvtss_f32(_mm_max_ss(v, _mm_shuffle_ps(v, v, 1)));
+	}
+	__m128 Select(__m128 mask, __m128 a, __m128 b) {
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+	// All bits set in lanes whose bit is set in the low 4 bits of `bits`
+	__m128 LaneMask(int bits) {
+		return _mm_castsi128_ps(_mm_setr_epi32(-(bits & 1), -((bits >> 1) & 1), -((bits >> 2) & 1), -((bits >> 3) & 1)));
+	}
+
+	void LoadBlock(const uint8_t* source, Int2 size, int rowPitch, int bx, int by, Block& block) {
+		for (int y = 0; y < 4; ++y) {
+			auto* row = source + (size_t)std::min(by * 4 + y, size.y - 1) * rowPitch;
+			if (bx * 4 + 4 <= size.x) {
+				std::memcpy(block.mPixels[y * 4], row + bx * 16, 16);
+				continue;
+			}
+			// Replicate the edge into partial blocks
+			for (int x = 0; x < 4; ++x) {
+				std::memcpy(block.mPixels[y * 4 + x], row + std::min(bx * 4 + x, size.x - 1) * 4, 4);
+			}
+		}
+	}
+	BlockSoA ToSoA(const Block& block) {
+		BlockSoA soa;
+		const __m128i zero = _mm_setzero_si128();
+		for (int g = 0; g < 4; ++g) {
+			__m128i p = _mm_load_si128((const __m128i*)block.mPixels[g * 4]);
+			__m128i lo = _mm_unpacklo_epi8(p, zero), hi = _mm_unpackhi_epi8(p, zero);
+			__m128 p0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+			__m128 p1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+			__m128 p2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+			__m128 p3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+			_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+			soa.mC[0][g] = p0;
+			soa.mC[1][g] = p1;
+			soa.mC[2][g] = p2;
+			soa.mC[3][g] = p3;
+		}
+		return soa;
+	}
+
+	// Initial endpoints over channels [first, first + count), ignoring
+	// pixels set in `skip`: the bounding box (Fast) or the extent of the
+	// pixels along their principal axis
+	Endpoints FitEndpoints(const BlockSoA& soa, int first, int count, Quality quality, uint16_t skip) {
+		Endpoints ep = { };
+		__m128 include[4];
+		for (int g = 0; g < 4; ++g) include[g] = _mm_andnot_ps(LaneMask(skip >> (g * 4)), LaneMask(0xf));
+		int pixelCount = 16;
+		for (int i = 0; i < 16; ++i) pixelCount -= (skip >> i) & 1;
+		if (pixelCount == 0) return ep;
+
+		const __m128 maxV = _mm_set1_ps(MaxError), minV = _mm_set1_ps(-MaxError);
+		float mean[4] = { }, min[4] = { }, max[4] = { };
+		for (int c = first; c < first + count; ++c) {
+			__m128 sum = _mm_setzero_ps(), vmin = maxV, vmax = minV;
+			for (int g = 0; g < 4; ++g) {
+				sum = _mm_add_ps(sum, _mm_and_ps(include[g], soa.mC[c][g]));
+				vmin = _mm_min_ps(vmin, Select(include[g], soa.mC[c][g], maxV));
+				vmax = _mm_max_ps(vmax, Select(include[g], soa.mC[c][g], minV));
+			}
+			mean[c] = HSum(sum) / pixelCount;
+			min[c] = HMin(vmin);
+			max[c] = HMax(vmax);
+		}
+		float cov[4][4] = { };
+		for (int i = first; i < first + count; ++i) {
+			for (int j = i; j < first + count; ++j) {
+				__m128 sum = _mm_setzero_ps();
+				for (int g = 0; g < 4; ++g) {
+					__m128 di = _mm_sub_ps(soa.mC[i][g], _mm_set1_ps(mean[i]));
+					__m128 dj = _mm_sub_ps(soa.mC[j][g], _mm_set1_ps(mean[j]));
+					sum = _mm_add_ps(sum, _mm_and_ps(include[g], _mm_mul_ps(di, dj)));
+				}
+				cov[i][j] = cov[j][i] = HSum(sum);
+			}
+		}
+
+		// Orient each channel of the box by its covariance with the widest channel
+		int widest = first;
+		for (int c = first; c < first + count; ++c) if (max[c] - min[c] > max[widest] - min[widest]) widest = c;
+		float axis[4] = { };
+		for (int c = first; c < first + count; ++c) {
+			bool flip = cov[widest][c] < 0.0f;
+			ep.mE[0][c] = flip ? max[c] : min[c];
+			ep.mE[1][c] = flip ? min[c] : max[c];
+			axis[c] = ep.mE[1][c] - ep.mE[0][c];
+		}
+		if (quality == Quality::Fast || count == 1) return ep;
+
+		// Principal axis by power iteration, starting from the box diagonal
+		for (int it = 0; it < 8; ++it) {
+			float next[4] = { };
+			float length2 = 0.0f;
+			for (int i = first; i < first + count; ++i) {
+				for (int j = first; j < first + count; ++j) next[i] += cov[i][j] * axis[j];
+				length2 += next[i] * next[i];
+			}
+			if (!(length2 > 1e-12f)) break;
+			float scale = 1.0f / std::sqrt(length2);
+			for (int c = first; c < first + count; ++c) axis[c] = next[c] * scale;
+		}
+		float axisLength2 = 0.0f;
+		for (int c = first; c < first + count; ++c) axisLength2 += axis[c] * axis[c];
+		if (!(axisLength2 > 1e-12f)) return ep;
+
+		// Extent of the pixels along the axis
+		__m128 tmin = maxV, tmax = minV;
+		for (int g = 0; g < 4; ++g) {
+			__m128 t = _mm_setzero_ps();
+			for (int c = first; c < first + count; ++c) {
+				t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(soa.mC[c][g], _mm_set1_ps(mean[c])), _mm_set1_ps(axis[c])));
+			}
+			tmin = _mm_min_ps(tmin, Select(include[g], t, maxV));
+			tmax = _mm_max_ps(tmax, Select(include[g], t, minV));
+		}
+		float t0 = HMin(tmin) / axisLength2, t1 = HMax(tmax) / axisLength2;
+		for (int c = first; c < first + count; ++c) {
+			ep.mE[0][c] = std::clamp(mean[c] + axis[c] * t0, 0.0f, 255.0f);
+			ep.mE[1][c] = std::clamp(mean[c] + axis[c] * t1, 0.0f, 255.0f);
+		}
+		return ep;
+	}
+
+	// Least squares endpoints for the interpolation weight (towards the
+	// second endpoint) of each pixel; pixels with a negative weight are ignored
+	bool RefineEndpoints(const BlockSoA& soa, int first, int count, const float weights[16], Endpoints& ep) {
+		__m128 aa = _mm_setzero_ps(), ab = _mm_setzero_ps(), bb = _mm_setzero_ps();
+		__m128 xa[4], xb[4];
+		for (int c = first; c < first + count; ++c) xa[c] = xb[c] = _mm_setzero_ps();
+		for (int g = 0; g < 4; ++g) {
+			__m128 w = _mm_loadu_ps(weights + g * 4);
+			__m128 include = _mm_cmpge_ps(w, _mm_setzero_ps());
+			__m128 b = _mm_and_ps(include, w);
+			__m128 a = _mm_and_ps(include, _mm_sub_ps(_mm_set1_ps(1.0f), w));
+			aa = _mm_add_ps(aa, _mm_mul_ps(a, a));
+			ab = _mm_add_ps(ab, _mm_mul_ps(a, b));
+			bb = _mm_add_ps(bb, _mm_mul_ps(b, b));
+			for (int c = first; c < first + count; ++c) {
+				xa[c] = _mm_add_ps(xa[c], _mm_mul_ps(a, soa.mC[c][g]));
+				xb[c] = _mm_add_ps(xb[c], _mm_mul_ps(b, soa.mC[c][g]));
+			}
+		}
+		float A = HSum(aa), B = HSum(ab), C = HSum(bb);
+		float det = A * C - B * B;
+		if (!(std::abs(det) > 1e-6f)) return false;
+		float invDet = 1.0f / det;
+		for (int c = first; c < first + count; ++c) {
+			float X = HSum(xa[c]), Y = HSum(xb[c]);
+			ep.mE[0][c] = std::clamp((C * X - B * Y) * invDet, 0.0f, 255.0f);
+			ep.mE[1][c] = std::clamp((A * Y - B * X) * invDet, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	// Nearest palette entry for each pixel over channels [first, first + count)
+	// Returns the summed squared error, excluding pixels set in `skip`
+	float SelectIndices(const BlockSoA& soa, int first, int count, const Palette& palette, uint8_t indices[16], uint16_t skip = 0) {
+		__m128 total = _mm_setzero_ps();
+		for (int g = 0; g < 4; ++g) {
+			__m128 bestError = _mm_set1_ps(MaxError), bestIndex = _mm_setzero_ps();
+			for (int e = 0; e < palette.mCount; ++e) {
+				__m128 error = _mm_setzero_ps();
+				for (int c = first; c < first + count; ++c) {
+					__m128 d = _mm_sub_ps(soa.mC[c][g], _mm_set1_ps(palette.mColors[e][c]));
+					error = _mm_add_ps(error, _mm_mul_ps(d, d));
+				}
+				__m128 better = _mm_cmplt_ps(error, bestError);
+				bestError = _mm_min_ps(error, bestError);
+				bestIndex = Select(better, _mm_set1_ps((float)e), bestIndex);
+			}
+			total = _mm_add_ps(total, _mm_andnot_ps(LaneMask(skip >> (g * 4)), bestError));
+			alignas(16) int32_t index[4];
+			_mm_store_si128((__m128i*)index, _mm_cvttps_epi32(bestIndex));
+			for (int i = 0; i < 4; ++i) indices[g * 4 + i] = (uint8_t)index[i];
+		}
+		return HSum(total);
+	}
 
-namespace NVTTCompress {
+	// Fit endpoints, then alternate between evaluating them and a least
+	// squares refit from the resulting weights. `evaluate(ep, weights)`
+	// quantizes and encodes the endpoints (keeping its best result), and
+	// returns the error along with the weight of each pixel
+	template<class Evaluate>
+	void OptimizeEndpoints(const BlockSoA& soa, int first, int count, Quality quality, uint16_t skip, Evaluate&& evaluate) {
+		auto ep = FitEndpoints(soa, first, count, quality, skip);
+		float weights[16];
+		float error = evaluate(ep, weights);
+		int iterations = quality == Quality::Fast ? 0 : quality == Quality::Normal ? 1 : 3;
+		for (int i = 0; i < iterations && error > 0.0f; ++i) {
+			if (!RefineEndpoints(soa, first, count, weights, ep)) break;
+			float newError = evaluate(ep, weights);
+			if (newError >= error) break;
+			error = newError;
+		}
+	}
+
+	int Quantize(float v, int maxValue) {
+		return std::clamp((int)std::lround(v * maxValue / 255.0f), 0, maxValue);
+	}
 
-	void CompressTextureBC1(InputData* img, void* outData) {
-		return CompressTextureData(img, nvtt::Format_BC1, outData);
+	// BC1: two RGB565 endpoints and 2-bit indices
+	uint16_t To565(const float c[4]) {
+		return (uint16_t)((Quantize(c[0], 31) << 11) | (Quantize(c[1], 63) << 5) | Quantize(c[2], 31));
+	}
+	// Colors of a BC1 block; BC2/BC3 blocks always use the 4 color mode
+	void BC1Palette(uint16_t c0, uint16_t c1, bool fourColorOnly, int palette[4][4]) {
+		for (int i = 0; i < 2; ++i) {
+			uint16_t c = i == 0 ? c0 : c1;
+			int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+			palette[i][0] = (r << 3) | (r >> 2);
+			palette[i][1] = (g << 2) | (g >> 4);
+			palette[i][2] = (b << 3) | (b >> 2);
+			palette[i][3] = 255;
+		}
+		for (int c = 0; c < 4; ++c) {
+			int a = palette[0][c], b = palette[1][c];
+			if (c0 > c1 || fourColorOnly) {
+				palette[2][c] = (2 * a + b) / 3;
+				palette[3][c] = (a + 2 * b) / 3;
+			} else {
+				palette[2][c] = (a + b) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		if (!(c0 > c1 || fourColorOnly)) palette[2][3] = 255;
 	}
-	void CompressTextureBC2(InputData* img, void* outData) {
-		return CompressTextureData(img, nvtt::Format_BC2, outData);
+	// Transparent pixels (alpha < 128) use the 3 color mode when `punchThrough`
+	void EncodeBC1(const BlockSoA& soa, Quality quality, bool punchThrough, uint8_t* out) {
+		uint16_t transparent = 0;
+		if (punchThrough) {
+			for (int g = 0; g < 4; ++g) {
+				transparent |= _mm_movemask_ps(_mm_cmplt_ps(soa.mC[3][g], _mm_set1_ps(128.0f))) << (g * 4);
+			}
+		}
+		bool threeColor = transparent != 0;
+		uint16_t bestColors[2] = { 0, 0 };
+		uint32_t bestBits = 0xffffffff;
+		float bestError = MaxError;
+		if (transparent != 0xffff) {
+			OptimizeEndpoints(soa, 0, 3, quality, transparent, [&](const Endpoints& ep, float weights[16]) {
+				uint16_t c0 = To565(ep.mE[0]), c1 = To565(ep.mE[1]);
+				// The mode is chosen by endpoint order
+				bool swap = threeColor ? c0 > c1 : c0 < c1;
+				if (swap) std::swap(c0, c1);
+				int colors[4][4];
+				BC1Palette(c0, c1, false, colors);
+				Palette palette;
+				palette.mCount = threeColor || c0 == c1 ? 3 : 4;
+				for (int e = 0; e < palette.mCount; ++e) for (int c = 0; c < 4; ++c) palette.mColors[e][c] = (float)colors[e][c];
+				uint8_t indices[16];
+				float error = SelectIndices(soa, 0, 3, palette, indices, transparent);
+				static const float Weights4[] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f, };
+				static const float Weights3[] = { 0.0f, 1.0f, 0.5f, -1.0f, };
+				uint32_t bits = 0;
+				for (int i = 0; i < 16; ++i) {
+					if (transparent & (1 << i)) indices[i] = 3;
+					bits |= (uint32_t)indices[i] << (i * 2);
+					float w = (threeColor ? Weights3 : Weights4)[indices[i]];
+					weights[i] = w >= 0.0f && swap ? 1.0f - w : w;
+				}
+				if (error < bestError) {
+					bestError = error;
+					bestColors[0] = c0;
+					bestColors[1] = c1;
+					bestBits = bits;
+				}
+				return error;
+			});
+		}
+		std::memcpy(out, bestColors, 4);
+		std::memcpy(out + 4, &bestBits, 4);
 	}
-	void CompressTextureBC3(InputData* img, void* outData) {
-		return CompressTextureData(img, nvtt::Format_BC3, outData);
+
+	// BC4: two 8-bit endpoints and 3-bit indices; a0 > a1 selects 8
+	// interpolated values, otherwise 6 values plus 0 and 255
+	void BC4Palette(int a0, int a1, int palette[8]) {
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1) {
+			for (int j = 1; j < 7; ++j) palette[j + 1] = ((7 - j) * a0 + j * a1 + 3) / 7;
+		} else {
+			for (int j = 1; j < 5; ++j) palette[j + 1] = ((5 - j) * a0 + j * a1 + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
 	}
-	void CompressTextureBC4(InputData* img, void* outData) {
-		return CompressTextureData(img, nvtt::Format_BC4, outData);
+	void EncodeBC4(const BlockSoA& soa, int channel, Quality quality, uint8_t* out) {
+		int bestEndpoints[2] = { 0, 0 };
+		uint64_t bestBits = 0;
+		float bestError = MaxError;
+		auto EncodeMode = [&](bool sixValues, uint16_t skip) {
+			OptimizeEndpoints(soa, channel, 1, quality, skip, [&](const Endpoints& ep, float weights[16]) {
+				int a0 = (int)std::lround(ep.mE[0][channel]), a1 = (int)std::lround(ep.mE[1][channel]);
+				bool swap = sixValues ? a0 > a1 : a0 < a1;
+				if (swap) std::swap(a0, a1);
+				int values[8];
+				BC4Palette(a0, a1, values);
+				Palette palette;
+				// Equal endpoints fall back to the 6 value mode
+				palette.mCount = !sixValues && a0 == a1 ? 1 : 8;
+				for (int e = 0; e < palette.mCount; ++e) palette.mColors[e][channel] = (float)values[e];
+				uint8_t indices[16];
+				float error = SelectIndices(soa, channel, 1, palette, indices);
+				uint64_t bits = 0;
+				for (int i = 0; i < 16; ++i) {
+					bits |= (uint64_t)indices[i] << (i * 3);
+					int index = indices[i];
+					float w = index < 2 ? (float)index : sixValues ? (index < 6 ? (index - 1) / 5.0f : -1.0f) : (index - 1) / 7.0f;
+					weights[i] = w >= 0.0f && swap ? 1.0f - w : w;
+				}
+				if (error < bestError) {
+					bestError = error;
+					bestEndpoints[0] = a0;
+					bestEndpoints[1] = a1;
+					bestBits = bits;
+				}
+				return error;
+			});
+		};
+		EncodeMode(false, 0);
+		if (quality == Quality::High && bestError > 0.0f) {
+			// Let the explicit 0 and 255 cover the extremes
+			uint16_t extremes = 0;
+			for (int g = 0; g < 4; ++g) {
+				__m128 v = soa.mC[channel][g];
+				extremes |= _mm_movemask_ps(_mm_or_ps(_mm_cmple_ps(v, _mm_setzero_ps()), _mm_cmpge_ps(v, _mm_set1_ps(255.0f)))) << (g * 4);
+			}
+			if (extremes != 0) EncodeMode(true, extremes == 0xffff ? 0 : extremes);
+		}
+		out[0] = (uint8_t)bestEndpoints[0];
+		out[1] = (uint8_t)bestEndpoints[1];
+		for (int i = 0; i < 6; ++i) out[2 + i] = (uint8_t)(bestBits >> (i * 8));
 	}
-	void CompressTextureBC5(InputData* img, void* outData) {
-		return CompressTextureData(img, nvtt::Format_BC5, outData);
+
+	// BC7 blocks are a little endian stream of 128 bits
+	struct BitWriter {
+		uint64_t mBits[2] = { };
+		int mPosition = 0;
+		void Write(uint32_t value, int count) {
+			uint64_t v = value & ((1ull << count) - 1);
+			int word = mPosition >> 6, shift = mPosition & 63;
+			mBits[word] |= v << shift;
+			if (shift + count > 64) mBits[word + 1] |= v >> (64 - shift);
+			mPosition += count;
+		}
+	};
+	struct BitReader {
+		uint64_t mBits[2];
+		int mPosition = 0;
+		uint32_t Read(int count) {
+			int word = mPosition >> 6, shift = mPosition & 63;
+			uint64_t v = mBits[word] >> shift;
+			if (shift + count > 64) v |= mBits[word + 1] << (64 - shift);
+			mPosition += count;
+			return (uint32_t)(v & ((1ull << count) - 1));
+		}
+	};
+	const int BC7Weights2[] = { 0, 21, 43, 64, };
+	const int BC7Weights4[] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64, };
+	int BC7Interpolate(int a, int b, int w) { return ((64 - w) * a + w * b + 32) >> 6; }
+
+	// Mode 6: one RGBA subset, 7-bit endpoints with a p-bit each, 4-bit indices
+	struct BC7Mode6 {
+		int mEndpoints[2][4];		// 8-bit, including the p-bit
+		uint8_t mIndices[16];
+		float mError = MaxError;
+	};
+	BC7Mode6 EncodeBC7Mode6(const BlockSoA& soa, Quality quality) {
+		BC7Mode6 best;
+		OptimizeEndpoints(soa, 0, 4, quality, 0, [&](const Endpoints& ep, float weights[16]) {
+			auto QuantizeEndpoint = [&](const float e[4], int p, int out[4]) {
+				float error = 0.0f;
+				for (int c = 0; c < 4; ++c) {
+					out[c] = std::clamp((int)std::lround((e[c] - p) * 0.5f), 0, 127) * 2 + p;
+					error += (out[c] - e[c]) * (out[c] - e[c]);
+				}
+				return error;
+			};
+			// Each endpoint takes its nearest p-bit, or High tries every pair
+			int fixedP[2];
+			for (int i = 0; i < 2; ++i) {
+				int q0[4], q1[4];
+				fixedP[i] = QuantizeEndpoint(ep.mE[i], 0, q0) <= QuantizeEndpoint(ep.mE[i], 1, q1) ? 0 : 1;
+			}
+			float bestError = MaxError;
+			for (int pair = 0; pair < (quality == Quality::High ? 4 : 1); ++pair) {
+				BC7Mode6 mode;
+				int p0 = quality == Quality::High ? pair & 1 : fixedP[0];
+				int p1 = quality == Quality::High ? pair >> 1 : fixedP[1];
+				QuantizeEndpoint(ep.mE[0], p0, mode.mEndpoints[0]);
+				QuantizeEndpoint(ep.mE[1], p1, mode.mEndpoints[1]);
+				Palette palette;
+				palette.mCount = 16;
+				for (int e = 0; e < 16; ++e) for (int c = 0; c < 4; ++c) {
+					palette.mColors[e][c] = (float)BC7Interpolate(mode.mEndpoints[0][c], mode.mEndpoints[1][c], BC7Weights4[e]);
+				}
+				mode.mError = SelectIndices(soa, 0, 4, palette, mode.mIndices);
+				if (mode.mError < bestError) {
+					bestError = mode.mError;
+					for (int i = 0; i < 16; ++i) weights[i] = BC7Weights4[mode.mIndices[i]] / 64.0f;
+				}
+				if (mode.mError < best.mError) best = mode;
+			}
+			return bestError;
+		});
+		return best;
+	}
+	void WriteBC7Mode6(BC7Mode6 mode, uint8_t* out) {
+		// The first index has an implicit zero high bit
+		if (mode.mIndices[0] >= 8) {
+			std::swap(mode.mEndpoints[0], mode.mEndpoints[1]);
+			for (auto& index : mode.mIndices) index = 15 - index;
+		}
+		BitWriter writer;
+		writer.Write(1 << 6, 7);
+		for (int c = 0; c < 4; ++c) {
+			writer.Write(mode.mEndpoints[0][c] >> 1, 7);
+			writer.Write(mode.mEndpoints[1][c] >> 1, 7);
+		}
+		writer.Write(mode.mEndpoints[0][0] & 1, 1);
+		writer.Write(mode.mEndpoints[1][0] & 1, 1);
+		for (int i = 0; i < 16; ++i) writer.Write(mode.mIndices[i], i == 0 ? 3 : 4);
+		std::memcpy(out, writer.mBits, 16);
+	}
+
+	// Mode 5: RGB with 7-bit endpoints and a separate 8-bit scalar, each
+	// with 2-bit indices. The scalar replaces the channel chosen by mRotation
+	struct BC7Mode5 {
+		int mRotation = 0;
+		int mColor[2][3];			// 7-bit
+		int mAlpha[2];
+		uint8_t mColorIndices[16];
+		uint8_t mAlphaIndices[16];
+		float mError = MaxError;
+	};
+	BC7Mode5 EncodeBC7Mode5(const BlockSoA& source, int rotation, Quality quality) {
+		BlockSoA soa = source;
+		if (rotation > 0) std::swap(soa.mC[3], soa.mC[rotation - 1]);
+		BC7Mode5 mode;
+		mode.mRotation = rotation;
+		float colorError = MaxError, alphaError = MaxError;
+		OptimizeEndpoints(soa, 0, 3, quality, 0, [&](const Endpoints& ep, float weights[16]) {
+			int color[2][3];
+			Palette palette;
+			palette.mCount = 4;
+			for (int i = 0; i < 2; ++i) for (int c = 0; c < 3; ++c) color[i][c] = Quantize(ep.mE[i][c], 127);
+			for (int e = 0; e < 4; ++e) for (int c = 0; c < 3; ++c) {
+				int a = (color[0][c] << 1) | (color[0][c] >> 6), b = (color[1][c] << 1) | (color[1][c] >> 6);
+				palette.mColors[e][c] = (float)BC7Interpolate(a, b, BC7Weights2[e]);
+			}
+			uint8_t indices[16];
+			float error = SelectIndices(soa, 0, 3, palette, indices);
+			for (int i = 0; i < 16; ++i) weights[i] = BC7Weights2[indices[i]] / 64.0f;
+			if (error < colorError) {
+				colorError = error;
+				std::memcpy(mode.mColor, color, sizeof(color));
+				std::memcpy(mode.mColorIndices, indices, 16);
+			}
+			return error;
+		});
+		OptimizeEndpoints(soa, 3, 1, quality, 0, [&](const Endpoints& ep, float weights[16]) {
+			int alpha[2] = { (int)std::lround(ep.mE[0][3]), (int)std::lround(ep.mE[1][3]), };
+			Palette palette;
+			palette.mCount = 4;
+			for (int e = 0; e < 4; ++e) palette.mColors[e][3] = (float)BC7Interpolate(alpha[0], alpha[1], BC7Weights2[e]);
+			uint8_t indices[16];
+			float error = SelectIndices(soa, 3, 1, palette, indices);
+			for (int i = 0; i < 16; ++i) weights[i] = BC7Weights2[indices[i]] / 64.0f;
+			if (error < alphaError) {
+				alphaError = error;
+				std::memcpy(mode.mAlpha, alpha, sizeof(alpha));
+				std::memcpy(mode.mAlphaIndices, indices, 16);
+			}
+			return error;
+		});
+		mode.mError = colorError + alphaError;
+		return mode;
+	}
+	void WriteBC7Mode5(BC7Mode5 mode, uint8_t* out) {
+		if (mode.mColorIndices[0] >= 2) {
+			std::swap(mode.mColor[0], mode.mColor[1]);
+			for (auto& index : mode.mColorIndices) index = 3 - index;
+		}
+		if (mode.mAlphaIndices[0] >= 2) {
+			std::swap(mode.mAlpha[0], mode.mAlpha[1]);
+			for (auto& index : mode.mAlphaIndices) index = 3 - index;
+		}
+		BitWriter writer;
+		writer.Write(1 << 5, 6);
+		writer.Write(mode.mRotation, 2);
+		for (int c = 0; c < 3; ++c) {
+			writer.Write(mode.mColor[0][c], 7);
+			writer.Write(mode.mColor[1][c], 7);
+		}
+		writer.Write(mode.mAlpha[0], 8);
+		writer.Write(mode.mAlpha[1], 8);
+		for (int i = 0; i < 16; ++i) writer.Write(mode.mColorIndices[i], i == 0 ? 1 : 2);
+		for (int i = 0; i < 16; ++i) writer.Write(mode.mAlphaIndices[i], i == 0 ? 1 : 2);
+		std::memcpy(out, writer.mBits, 16);
+	}
+	void EncodeBC7(const BlockSoA& soa, Quality quality, uint8_t* out) {
+		auto mode6 = EncodeBC7Mode6(soa, quality);
+		BC7Mode5 mode5;
+		if (quality == Quality::High && mode6.mError > 0.0f) {
+			for (int rotation = 0; rotation < 4; ++rotation) {
+				auto mode = EncodeBC7Mode5(soa, rotation, quality);
+				if (mode.mError < mode5.mError) mode5 = mode;
+			}
+		}
+		if (mode5.mError < mode6.mError) WriteBC7Mode5(mode5, out);
+		else WriteBC7Mode6(mode6, out);
+	}
+
+	void EncodeBlock(BufferFormat fmt, const Block& block, Quality quality, uint8_t* out) {
+		auto soa = ToSoA(block);
+		switch (fmt) {
+		case FORMAT_BC1_UNORM:
+		case FORMAT_BC1_UNORM_SRGB: EncodeBC1(soa, quality, true, out); break;
+		case FORMAT_BC3_UNORM:
+		case FORMAT_BC3_UNORM_SRGB: EncodeBC4(soa, 3, quality, out); EncodeBC1(soa, quality, false, out + 8); break;
+		case FORMAT_BC4_UNORM: EncodeBC4(soa, 0, quality, out); break;
+		case FORMAT_BC5_UNORM: EncodeBC4(soa, 0, quality, out); EncodeBC4(soa, 1, quality, out + 8); break;
+		case FORMAT_BC7_UNORM:
+		case FORMAT_BC7_UNORM_SRGB: EncodeBC7(soa, quality, out); break;
+		default: break;
+		}
+	}
+
+	void DecodeBC1(const uint8_t* in, bool fourColorOnly, uint8_t out[16][4]) {
+		uint16_t c0, c1;
+		uint32_t bits;
+		std::memcpy(&c0, in, 2);
+		std::memcpy(&c1, in + 2, 2);
+		std::memcpy(&bits, in + 4, 4);
+		int palette[4][4];
+		BC1Palette(c0, c1, fourColorOnly, palette);
+		for (int i = 0; i < 16; ++i) {
+			auto& color = palette[(bits >> (i * 2)) & 3];
+			for (int c = 0; c < 4; ++c) out[i][c] = (uint8_t)color[c];
+		}
+	}
+	void DecodeBC4(const uint8_t* in, int channel, uint8_t out[16][4]) {
+		int palette[8];
+		BC4Palette(in[0], in[1], palette);
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; ++i) bits |= (uint64_t)in[2 + i] << (i * 8);
+		for (int i = 0; i < 16; ++i) out[i][channel] = (uint8_t)palette[(bits >> (i * 3)) & 7];
+	}
+	void DecodeBC7(const uint8_t* in, uint8_t out[16][4]) {
+		BitReader reader;
+		std::memcpy(reader.mBits, in, 16);
+		std::memset(out, 0, 64);
+		if (in[0] & (1 << 6) && (in[0] & 0x3f) == 0) {
+			reader.Read(7);
+			int endpoints[2][4];
+			for (int c = 0; c < 4; ++c) for (int i = 0; i < 2; ++i) endpoints[i][c] = reader.Read(7) << 1;
+			int p0 = reader.Read(1), p1 = reader.Read(1);
+			for (int c = 0; c < 4; ++c) { endpoints[0][c] |= p0; endpoints[1][c] |= p1; }
+			for (int i = 0; i < 16; ++i) {
+				int w = BC7Weights4[reader.Read(i == 0 ? 3 : 4)];
+				for (int c = 0; c < 4; ++c) out[i][c] = (uint8_t)BC7Interpolate(endpoints[0][c], endpoints[1][c], w);
+			}
+		} else if (in[0] & (1 << 5) && (in[0] & 0x1f) == 0) {
+			reader.Read(6);
+			int rotation = reader.Read(2);
+			int color[2][3], alpha[2];
+			for (int c = 0; c < 3; ++c) for (int i = 0; i < 2; ++i) {
+				int v = reader.Read(7);
+				color[i][c] = (v << 1) | (v >> 6);
+			}
+			for (int i = 0; i < 2; ++i) alpha[i] = reader.Read(8);
+			for (int i = 0; i < 16; ++i) {
+				int w = BC7Weights2[reader.Read(i == 0 ? 1 : 2)];
+				for (int c = 0; c < 3; ++c) out[i][c] = (uint8_t)BC7Interpolate(color[0][c], color[1][c], w);
+			}
+			for (int i = 0; i < 16; ++i) {
+				out[i][3] = (uint8_t)BC7Interpolate(alpha[0], alpha[1], BC7Weights2[reader.Read(i == 0 ? 1 : 2)]);
+				if (rotation > 0) std::swap(out[i][3], out[i][rotation - 1]);
+			}
+		}
+	}
+	void DecodeBlock(BufferFormat fmt, const uint8_t* in, uint8_t out[16][4]) {
+		switch (fmt) {
+		case FORMAT_BC1_UNORM:
+		case FORMAT_BC1_UNORM_SRGB: DecodeBC1(in, false, out); break;
+		case FORMAT_BC3_UNORM:
+		case FORMAT_BC3_UNORM_SRGB: DecodeBC1(in + 8, true, out); DecodeBC4(in, 3, out); break;
+		case FORMAT_BC4_UNORM:
+		case FORMAT_BC5_UNORM:
+			for (int i = 0; i < 16; ++i) { out[i][0] = out[i][1] = out[i][2] = 0; out[i][3] = 255; }
+			DecodeBC4(in, 0, out);
+			if (fmt == FORMAT_BC5_UNORM) DecodeBC4(in + 8, 1, out);
+			break;
+		case FORMAT_BC7_UNORM:
+		case FORMAT_BC7_UNORM_SRGB: DecodeBC7(in, out); break;
+		default: std::memset(out, 0, 64); break;
+		}
+	}
+
+	bool IsRGBA8(BufferFormat fmt) {
+		return fmt == FORMAT_R8G8B8A8_TYPELESS || fmt == FORMAT_R8G8B8A8_UNORM || fmt == FORMAT_R8G8B8A8_UNORM_SRGB;
+	}
+	int GetBlockBytes(BufferFormat fmt) {
+		return BufferFormatType::GetBitSize(fmt) * 16 / 8;
+	}
+
+	// A row of blocks from one image
+	struct RowJob {
+		const uint8_t* mSource;
+		int mRowPitch;
+		Int2 mSize;
+		uint8_t* mDest;
+		int mRow;
+	};
+	void AppendRowJobs(std::vector<RowJob>& jobs, const uint8_t* source, Int2 size, int rowPitch, uint8_t* dest) {
+		for (int by = 0; by < (size.y + 3) / 4; ++by) jobs.push_back({ source, rowPitch, size, dest, by, });
+	}
+	void EncodeRows(BufferFormat fmt, std::span<const RowJob> jobs, const TextureCompression::Settings& settings) {
+		int blockBytes = GetBlockBytes(fmt);
+		auto EncodeRow = [&](const RowJob& job) {
+			int blocksX = (job.mSize.x + 3) / 4;
+			uint8_t* out = job.mDest + (size_t)job.mRow * blocksX * blockBytes;
+			Block block;
+			for (int bx = 0; bx < blocksX; ++bx, out += blockBytes) {
+				LoadBlock(job.mSource, job.mSize, job.mRowPitch, bx, job.mRow, block);
+				EncodeBlock(fmt, block, settings.mQuality, out);
+			}
+		};
+		if (settings.mParallel) std::for_each(std::execution::par, jobs.begin(), jobs.end(), EncodeRow);
+		else std::for_each(jobs.begin(), jobs.end(), EncodeRow);
+	}
+}
+
+bool TextureCompression::IsSupported(BufferFormat fmt) {
+	switch (fmt) {
+	case FORMAT_BC1_UNORM: case FORMAT_BC1_UNORM_SRGB:
+	case FORMAT_BC3_UNORM: case FORMAT_BC3_UNORM_SRGB:
+	case FORMAT_BC4_UNORM:
+	case FORMAT_BC5_UNORM:
+	case FORMAT_BC7_UNORM: case FORMAT_BC7_UNORM_SRGB:
+		return true;
+	default: return false;
+	}
+}
+
+void TextureCompression::CompressImage(BufferFormat fmt, std::span<const uint8_t> source, Int2 size, int rowPitch,
+	std::span<uint8_t> dest, const Settings& settings)
+{
+	if (!IsSupported(fmt)) throw "Unsupported compressed format";
+	if (size.x <= 0 || size.y <= 0) return;
+	assert(dest.size() >= Texture::GetRawImageSize(Int3(size, 1), fmt));
+	std::vector<RowJob> jobs;
+	AppendRowJobs(jobs, source.data(), size, rowPitch, dest.data());
+	EncodeRows(fmt, jobs, settings);
+}
+
+void TextureCompression::Compress(const Texture& source, Texture& dest, const Settings& settings) {
+	auto fmt = dest.GetBufferFormat();
+	if (!IsSupported(fmt)) throw "Unsupported compressed format";
+	if (!IsRGBA8(source.GetBufferFormat())) throw "Compression requires an RGBA8 source";
+	if (source.GetSize() != dest.GetSize() || source.GetMipCount() != dest.GetMipCount() || source.GetArrayCount() != dest.GetArrayCount())
+		throw "Source and destination textures must have the same size";
+	// Jobs for every plane of every mip and slice are run together
+	std::vector<RowJob> jobs;
+	for (int s = 0; s < source.GetArrayCount(); ++s) {
+		for (int m = 0; m < source.GetMipCount(); ++m) {
+			auto res = Texture::GetMipResolution(source.GetSize(), fmt, m);
+			auto src = source.GetData(m, s);
+			auto dst = dest.GetRawData(m, s);
+			size_t srcPlane = (size_t)res.x * res.y * 4;
+			size_t dstPlane = Texture::GetRawImageSize(Int3(res.xy(), 1), fmt);
+			for (int z = 0; z < res.z; ++z) {
+				AppendRowJobs(jobs, src.data() + z * srcPlane, res.xy(), res.x * 4, dst.data() + z * dstPlane);
+			}
+		}
+	}
+	EncodeRows(fmt, jobs, settings);
+	dest.MarkChanged();
+}
+
+void TextureCompression::Compress(Texture& texture, BufferFormat fmt, const Settings& settings) {
+	if (!IsSupported(fmt)) throw "Unsupported compressed format";
+	if (!IsRGBA8(texture.GetBufferFormat())) throw "Compression requires an RGBA8 source";
+	Texture source(texture.GetSize(), texture.GetBufferFormat());
+	source.SetMipCount(texture.GetMipCount());
+	source.SetArrayCount(texture.GetArrayCount());
+	auto data = texture.GetRawData(-1, -1);
+	std::copy(data.begin(), data.end(), source.GetRawData(-1, -1).begin());
+	// Clears the existing data
+	texture.SetBufferFormat(fmt);
+	Compress(source, texture, settings);
+}
+
+void TextureCompression::DecompressImage(BufferFormat fmt, std::span<const uint8_t> source, Int2 size,
+	std::span<uint8_t> dest, int rowPitch)
+{
+	int blockBytes = GetBlockBytes(fmt);
+	int blocksX = (size.x + 3) / 4, blocksY = (size.y + 3) / 4;
+	uint8_t pixels[16][4];
+	for (int by = 0; by < blocksY; ++by) {
+		for (int bx = 0; bx < blocksX; ++bx) {
+			DecodeBlock(fmt, source.data() + ((size_t)by * blocksX + bx) * blockBytes, pixels);
+			for (int y = 0; y < 4 && by * 4 + y < size.y; ++y) {
+				for (int x = 0; x < 4 && bx * 4 + x < size.x; ++x) {
+					std::memcpy(dest.data() + (size_t)(by * 4 + y) * rowPitch + (bx * 4 + x) * 4, pixels[y * 4 + x], 4);
+				}
+			}
+		}
 	}
 }
-*/
\ No newline at end of file
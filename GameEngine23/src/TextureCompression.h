@@ -1,18 +1,48 @@
 #pragma once
 
+#include <span>
+#include <stdint.h>
+
 #include "MathTypes.h"
-#include <vector>
+#include "Buffer.h"
+
+class Texture;
+
+// CPU block encoder for BC1, BC3, BC4, BC5 and BC7 from RGBA8 pixels
+// Endpoints are fit with SSE, and blocks are encoded in parallel
+// with one job per row of blocks (across every mip and slice)
+class TextureCompression
+{
+public:
+	enum class Quality : uint8_t {
+		// Bounding box endpoints
+		Fast,
+		// Principal axis endpoints, with one least squares refinement
+		Normal,
+		// Further refinement; BC4 tries both modes, BC7 tries mode 5
+		// rotations and every p-bit pair
+		High,
+	};
+	struct Settings {
+		Quality mQuality = Quality::Normal;
+		bool mParallel = true;
+	};
+
+	// BC1, BC3 and BC7 (UNORM or SRGB), BC4 and BC5 (UNORM)
+	static bool IsSupported(BufferFormat fmt);
+
+	// Encode one RGBA8 image (with rowPitch bytes per row) into `dest`,
+	// which must hold Texture::GetRawImageSize(size, fmt) bytes
+	static void CompressImage(BufferFormat fmt, std::span<const uint8_t> source, Int2 size, int rowPitch,
+		std::span<uint8_t> dest, const Settings& settings);
+	// Encode every mip and slice of an RGBA8 texture into `dest`, which
+	// must already have a compressed format and the same size, mips and slices
+	static void Compress(const Texture& source, Texture& dest, const Settings& settings);
+	// Replace the contents of an RGBA8 texture with their compressed form
+	static void Compress(Texture& texture, BufferFormat fmt, const Settings& settings);
 
-struct InputData {
-	Int3 size;
-	unsigned char* data;
+	// Decode blocks to RGBA8. BC7 only supports modes 5 and 6 (those
+	// written by this encoder); other modes decode as zero
+	static void DecompressImage(BufferFormat fmt, std::span<const uint8_t> source, Int2 size,
+		std::span<uint8_t> dest, int rowPitch);
 };
-/*
-namespace NVTTCompress {
-	extern "C" void __declspec(dllexport) CompressTextureBC1(InputData * img, void* outData);
-	extern "C" void __declspec(dllexport) CompressTextureBC2(InputData * img, void* outData);
-	extern "C" void __declspec(dllexport) CompressTextureBC3(InputData * img, void* outData);
-	extern "C" void __declspec(dllexport) CompressTextureBC4(InputData * img, void* outData);
-	extern "C" void __declspec(dllexport) CompressTextureBC5(InputData * img, void* outData);
-}
-*/
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "TextureImport.h"
+
+#include <algorithm>
+#include <bit>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+	constexpr uint32_t MakeFourCC(char a, char b, char c, char d) {
+		return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+	}
+
+	// As laid out on disk (after the "DDS " magic)
+	struct DDSPixelFormat {
+		enum Flags : uint32_t { AlphaPixels = 0x1, FourCC = 0x4, RGB = 0x40, };
+		uint32_t mSize, mFlags, mFourCC, mRGBBitCount;
+		uint32_t mRMask, mGMask, mBMask, mAMask;
+	};
+	struct DDSHeader {
+		enum Caps2 : uint32_t { Cubemap = 0x200, Volume = 0x200000, };
+		uint32_t mSize, mFlags, mHeight, mWidth, mPitchOrLinearSize, mDepth, mMipMapCount;
+		uint32_t mReserved1[11];
+		DDSPixelFormat mPixelFormat;
+		uint32_t mCaps, mCaps2, mCaps3, mCaps4, mReserved2;
+	};
+	struct DDSHeaderDX10 {
+		enum Dimension : uint32_t { Texture1D = 2, Texture2D = 3, Texture3D = 4, };
+		enum MiscFlags : uint32_t { TextureCube = 0x4, };
+		uint32_t mFormat, mDimension, mMiscFlag, mArraySize, mMiscFlags2;
+	};
+	static_assert(sizeof(DDSHeader) == 124 && sizeof(DDSHeaderDX10) == 20);
+
+	// The 64-bit fields are only 4 byte aligned in the file
+#pragma pack(push, 4)
+	struct KTX2Header {
+		uint32_t mVkFormat, mTypeSize;
+		uint32_t mPixelWidth, mPixelHeight, mPixelDepth;
+		uint32_t mLayerCount, mFaceCount, mLevelCount;
+		uint32_t mSupercompressionScheme;
+		uint32_t mDFDByteOffset, mDFDByteLength, mKVDByteOffset, mKVDByteLength;
+		uint64_t mSGDByteOffset, mSGDByteLength;
+	};
+#pragma pack(pop)
+	struct KTX2Level {
+		uint64_t mByteOffset, mByteLength, mUncompressedByteLength;
+	};
+	static_assert(sizeof(KTX2Header) == 68 && sizeof(KTX2Level) == 24);
+	const uint8_t KTX2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n', };
+
+	BufferFormat GetLegacyDDSFormat(const DDSPixelFormat& pf) {
+		if (pf.mFlags & DDSPixelFormat::FourCC) {
+			switch (pf.mFourCC) {
+			case MakeFourCC('D', 'X', 'T', '1'): return FORMAT_BC1_UNORM;
+			case MakeFourCC('D', 'X', 'T', '2'):
+			case MakeFourCC('D', 'X', 'T', '3'): return FORMAT_BC2_UNORM;
+			case MakeFourCC('D', 'X', 'T', '4'):
+			case MakeFourCC('D', 'X', 'T', '5'): return FORMAT_BC3_UNORM;
+			case MakeFourCC('A', 'T', 'I', '1'):
+			case MakeFourCC('B', 'C', '4', 'U'): return FORMAT_BC4_UNORM;
+			case MakeFourCC('B', 'C', '4', 'S'): return FORMAT_BC4_SNORM;
+			case MakeFourCC('A', 'T', 'I', '2'):
+			case MakeFourCC('B', 'C', '5', 'U'): return FORMAT_BC5_UNORM;
+			case MakeFourCC('B', 'C', '5', 'S'): return FORMAT_BC5_SNORM;
+			// D3DFORMAT values written in place of a FourCC
+			case 113: return FORMAT_R16G16B16A16_FLOAT;
+			case 116: return FORMAT_R32G32B32A32_FLOAT;
+			}
+			return FORMAT_UNKNOWN;
+		}
+		if ((pf.mFlags & DDSPixelFormat::RGB) && pf.mRGBBitCount == 32) {
+			uint32_t alpha = (pf.mFlags & DDSPixelFormat::AlphaPixels) ? pf.mAMask : 0xff000000;
+			if (pf.mRMask == 0x000000ff && pf.mGMask == 0x0000ff00 && pf.mBMask == 0x00ff0000 && alpha == 0xff000000) return FORMAT_R8G8B8A8_UNORM;
+			if (pf.mRMask == 0x00ff0000 && pf.mGMask == 0x0000ff00 && pf.mBMask == 0x000000ff && alpha == 0xff000000) return FORMAT_B8G8R8A8_UNORM;
+		}
+		return FORMAT_UNKNOWN;
+	}
+
+	BufferFormat GetKTX2Format(uint32_t vkFormat) {
+		switch (vkFormat) {
+		case 9: return FORMAT_R8_UNORM;
+		case 16: return FORMAT_R8G8_UNORM;
+		case 37: return FORMAT_R8G8B8A8_UNORM;
+		case 43: return FORMAT_R8G8B8A8_UNORM_SRGB;
+		case 44: return FORMAT_B8G8R8A8_UNORM;
+		case 50: return FORMAT_B8G8R8A8_UNORM_SRGB;
+		case 64: return FORMAT_R10G10B10A2_UNORM;
+		case 76: return FORMAT_R16_FLOAT;
+		case 83: return FORMAT_R16G16_FLOAT;
+		case 97: return FORMAT_R16G16B16A16_FLOAT;
+		case 100: return FORMAT_R32_FLOAT;
+		case 103: return FORMAT_R32G32_FLOAT;
+		case 109: return FORMAT_R32G32B32A32_FLOAT;
+		case 122: return FORMAT_R11G11B10_FLOAT;
+		// BC1 RGB and RGBA share a block layout
+		case 131: case 133: return FORMAT_BC1_UNORM;
+		case 132: case 134: return FORMAT_BC1_UNORM_SRGB;
+		case 135: return FORMAT_BC2_UNORM;
+		case 136: return FORMAT_BC2_UNORM_SRGB;
+		case 137: return FORMAT_BC3_UNORM;
+		case 138: return FORMAT_BC3_UNORM_SRGB;
+		case 139: return FORMAT_BC4_UNORM;
+		case 140: return FORMAT_BC4_SNORM;
+		case 141: return FORMAT_BC5_UNORM;
+		case 142: return FORMAT_BC5_SNORM;
+		case 143: return FORMAT_BC6H_UF16;
+		case 144: return FORMAT_BC6H_SF16;
+		case 145: return FORMAT_BC7_UNORM;
+		case 146: return FORMAT_BC7_UNORM_SRGB;
+		}
+		return FORMAT_UNKNOWN;
+	}
+
+	// Only formats whose image size the Texture can compute
+	bool IsLoadableFormat(BufferFormat fmt) {
+		return fmt != FORMAT_UNKNOWN && BufferFormatType::GetBitSize(fmt) > 0;
+	}
+
+	template<class T>
+	void ReadStruct(std::ifstream& file, T& value, const char* error) {
+		if (!file.read((char*)&value, sizeof(value))) throw error;
+	}
+
+	// Allocate the texture, after checking the header values are sane
+	std::shared_ptr<Texture> CreateTexture(const std::wstring& path, BufferFormat fmt, Int3 size, int mipCount, int arrayCount) {
+		if (size.x <= 0 || size.y <= 0 || size.z <= 0 || arrayCount <= 0) throw "Texture file has an invalid size";
+		int maxMips = std::bit_width((uint32_t)std::max(std::max(size.x, size.y), size.z));
+		if (mipCount <= 0 || mipCount > maxMips) throw "Texture file has an invalid mip count";
+		auto tex = std::make_shared<Texture>(path);
+		tex->SetBufferFormat(fmt);
+		tex->SetSize3D(size);
+		tex->SetMipCount(mipCount);
+		tex->SetArrayCount(arrayCount);
+		return tex;
+	}
+	size_t GetRemainingSize(std::ifstream& file) {
+		auto position = file.tellg();
+		file.seekg(0, std::ios::end);
+		auto end = file.tellg();
+		file.seekg(position);
+		return (size_t)(end - position);
+	}
+	// Bytes in every mip of one slice
+	size_t GetMipChainSize(Int3 size, int mipCount, BufferFormat fmt) {
+		size_t total = 0;
+		for (int m = 0; m < mipCount; ++m) total += Texture::GetRawImageSize(Texture::GetMipResolution(size, fmt, m), fmt);
+		return total;
+	}
+}
+
+bool TextureImport::IsSupported(const std::wstring_view& path) {
+	auto ext = std::filesystem::path(path).extension().wstring();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](wchar_t c) { return (wchar_t)std::towlower(c); });
+	return ext == L".dds" || ext == L".ktx2";
+}
+
+std::shared_ptr<Texture> TextureImport::Import(const std::wstring& path) {
+	auto ext = std::filesystem::path(path).extension().wstring();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](wchar_t c) { return (wchar_t)std::towlower(c); });
+	if (ext == L".ktx2") return ImportKTX2(path);
+	return ImportDDS(path);
+}
+
+std::shared_ptr<Texture> TextureImport::ImportDDS(const std::wstring& path) {
+	std::ifstream file(std::filesystem::path(path), std::ios::binary);
+	if (!file) return nullptr;
+	uint32_t magic;
+	DDSHeader header;
+	ReadStruct(file, magic, "DDS file is truncated");
+	if (magic != MakeFourCC('D', 'D', 'S', ' ')) throw "File is not a DDS";
+	ReadStruct(file, header, "DDS file is truncated");
+	if (header.mSize != sizeof(DDSHeader)) throw "DDS header is invalid";
+
+	BufferFormat fmt;
+	Int3 size((int)header.mWidth, std::max((int)header.mHeight, 1), 1);
+	int arrayCount = 1;
+	if ((header.mPixelFormat.mFlags & DDSPixelFormat::FourCC) && header.mPixelFormat.mFourCC == MakeFourCC('D', 'X', '1', '0')) {
+		DDSHeaderDX10 dx10;
+		ReadStruct(file, dx10, "DDS file is truncated");
+		fmt = dx10.mFormat <= FORMAT_BC7_UNORM_SRGB ? (BufferFormat)dx10.mFormat : FORMAT_UNKNOWN;
+		arrayCount = (int)std::max(dx10.mArraySize, 1u);
+		if (dx10.mDimension == DDSHeaderDX10::Texture3D) size.z = std::max((int)header.mDepth, 1);
+		if (dx10.mMiscFlag & DDSHeaderDX10::TextureCube) arrayCount *= 6;
+	}
+	else {
+		fmt = GetLegacyDDSFormat(header.mPixelFormat);
+		if (header.mCaps2 & DDSHeader::Volume) size.z = std::max((int)header.mDepth, 1);
+		if (header.mCaps2 & DDSHeader::Cubemap) arrayCount = 6;
+	}
+	if (!IsLoadableFormat(fmt)) throw "DDS pixel format is not supported";
+	int mipCount = (int)std::max(header.mMipMapCount, 1u);
+	auto tex = CreateTexture(path, fmt, size, mipCount, arrayCount);
+
+	// DDS stores each slice with its full mip chain, tightly packed as
+	// Texture does, so the whole payload is a single read into place
+	size_t dataSize = GetMipChainSize(size, mipCount, fmt) * arrayCount;
+	if (dataSize != tex->GetLayout().mSize) throw "DDS layout does not match the texture";
+	if (dataSize > GetRemainingSize(file)) throw "DDS file is truncated";
+	if (!file.read((char*)tex->GetRawData(-1, -1).data(), dataSize)) throw "DDS file is truncated";
+	tex->MarkChanged();
+	return tex;
+}
+
+std::shared_ptr<Texture> TextureImport::ImportKTX2(const std::wstring& path) {
+	std::ifstream file(std::filesystem::path(path), std::ios::binary);
+	if (!file) return nullptr;
+	uint8_t identifier[sizeof(KTX2Identifier)];
+	KTX2Header header;
+	ReadStruct(file, identifier, "KTX2 file is truncated");
+	if (!std::equal(std::begin(identifier), std::end(identifier), std::begin(KTX2Identifier))) throw "File is not a KTX2";
+	ReadStruct(file, header, "KTX2 file is truncated");
+	if (header.mSupercompressionScheme != 0) throw "Supercompressed KTX2 files are not supported";
+	auto fmt = GetKTX2Format(header.mVkFormat);
+	if (!IsLoadableFormat(fmt)) throw "KTX2 pixel format is not supported";
+
+	// Zero counts mean "not an array", and levelCount 0 asks the loader
+	// to generate mips, which is left to import time instead
+	Int3 size((int)header.mPixelWidth, (int)std::max(header.mPixelHeight, 1u), (int)std::max(header.mPixelDepth, 1u));
+	int mipCount = (int)std::max(header.mLevelCount, 1u);
+	int arrayCount = (int)(std::max(header.mLayerCount, 1u) * std::max(header.mFaceCount, 1u));
+	auto tex = CreateTexture(path, fmt, size, mipCount, arrayCount);
+
+	std::vector<KTX2Level> levels(mipCount);
+	if (!file.read((char*)levels.data(), levels.size() * sizeof(KTX2Level))) throw "KTX2 file is truncated";
+	// Validate before the texture data is allocated
+	uint64_t fileSize = (uint64_t)file.tellg() + GetRemainingSize(file);
+	for (int m = 0; m < mipCount; ++m) {
+		auto imageSize = Texture::GetRawImageSize(Texture::GetMipResolution(size, fmt, m), fmt);
+		if (levels[m].mByteLength < (uint64_t)imageSize * arrayCount) throw "KTX2 level is smaller than its images";
+		if (levels[m].mByteOffset > fileSize || levels[m].mByteLength > fileSize - levels[m].mByteOffset) throw "KTX2 file is truncated";
+	}
+
+	// Each level holds every layer and face; levels are stored smallest
+	// first, so read in reverse to walk the file forwards
+	for (int m = mipCount - 1; m >= 0; --m) {
+		auto& level = levels[m];
+		auto imageSize = tex->GetRawData(m, 0).size();
+		file.seekg((std::streamoff)level.mByteOffset);
+		for (int s = 0; s < arrayCount; ++s) {
+			if (!file.read((char*)tex->GetRawData(m, s).data(), imageSize)) throw "KTX2 file is truncated";
+		}
+	}
+	tex->MarkChanged();
+	return tex;
+}
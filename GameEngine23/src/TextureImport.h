@@ -0,0 +1,24 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "Texture.h"
+
+// Loads textures stored in their GPU format (DDS and KTX2), so that
+// mips and block compression are taken from the file as-is
+// The payload is read straight into the texture data, without decoding
+class TextureImport
+{
+public:
+	// True if the path has a .dds or .ktx2 extension
+	static bool IsSupported(const std::wstring_view& path);
+
+	// Returns nullptr if the file could not be opened, and throws
+	// if its contents are malformed or use an unsupported format
+	static std::shared_ptr<Texture> Import(const std::wstring& path);
+	// DDS with legacy (DXTn, ATIn, RGBA8) or DX10 headers
+	static std::shared_ptr<Texture> ImportDDS(const std::wstring& path);
+	// KTX2 without supercompression
+	static std::shared_ptr<Texture> ImportKTX2(const std::wstring& path);
+};